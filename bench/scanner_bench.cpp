@@ -0,0 +1,102 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ *
+ * Scanner microbenchmark over a synthetic input/ready/ backlog.
+ * Usage: scanner_bench [jobs...]   (default: 100000 1000000)
+ */
+
+#include "nrvna/contract.hpp"
+#include "nrvna/logger.hpp"
+#include "nrvna/scanner.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace nrvna;
+namespace fs = std::filesystem;
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::string jobName(std::size_t i) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%020zu_1_%06zu", i, i % 1000000);
+    return name;
+}
+
+bool makeJob(const fs::path& ready, const std::string& id) {
+    std::error_code ec;
+    fs::create_directory(ready / id, ec);
+    std::ofstream prompt(ready / id / contract::kPromptFile, std::ios::binary);
+    prompt << "hello";
+    return static_cast<bool>(prompt);
+}
+
+template <typename F>
+void report(const char* label, F&& run) {
+    auto start = std::chrono::steady_clock::now();
+    const std::size_t seen = run();
+    std::printf("  %-28s %10.3f ms  (%zu jobs)\n", label, secondsSince(start) * 1000.0, seen);
+}
+
+void bench(const fs::path& root, std::size_t jobs) {
+    const fs::path ws = root / ("ws_" + std::to_string(jobs));
+    const fs::path ready = ws / contract::kReadyDir;
+    fs::create_directories(ready);
+
+    std::printf("%zu ready jobs\n", jobs);
+    auto setup = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < jobs; ++i) {
+        if (!makeJob(ready, jobName(i))) {
+            std::fprintf(stderr, "cannot create job %zu under %s\n", i, ready.c_str());
+            return;
+        }
+    }
+    std::printf("  %-28s %10.3f ms\n", "setup", secondsSince(setup) * 1000.0);
+
+    Scanner scanner(ws);
+    report("cold scan (validates all)", [&] { return scanner.scan().size(); });
+    report("rescan, unchanged", [&] { return scanner.scanDelta().added.size(); });
+
+    // One arrival and one claim, as a running daemon sees them.
+    makeJob(ready, jobName(jobs));
+    fs::rename(ready / jobName(0), ws / jobName(0));
+    report("rescan, one in one out", [&] {
+        auto delta = scanner.scanDelta();
+        return delta.added.size() + delta.removed.size();
+    });
+    report("readyJobCount, cached", [&] { return scanner.readyJobCount(); });
+    report("readyJobCount, fresh", [&] { return Scanner(ws).readyJobCount(); });
+
+    fs::remove_all(ws);
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    Logger::setLevel(LogLevel::WARN);
+    std::vector<std::size_t> sizes;
+    for (int i = 1; i < argc; ++i) {
+        sizes.push_back(static_cast<std::size_t>(std::strtoull(argv[i], nullptr, 10)));
+    }
+    if (sizes.empty()) {
+        sizes = {100000, 1000000};
+    }
+
+    const fs::path root = fs::temp_directory_path() / "nrvna_scanner_bench";
+    fs::remove_all(root);
+    for (std::size_t jobs : sizes) {
+        bench(root, jobs);
+    }
+    fs::remove_all(root);
+    return 0;
+}
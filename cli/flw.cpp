@@ -11,7 +11,6 @@
 #include "nrvna/logger.hpp"
 #include <algorithm>
 #include <fstream>
-#include <map>
 #include <iostream>
 #include <sstream>
 #include <thread>
@@ -29,10 +28,13 @@ void printUsage() {
     std::cout << "  flw <workspace> [job_id] [options]\n\n";
     std::cout << "Options:\n";
     std::cout << "  -w, --wait        Wait for the positional job ID (or read it from stdin)\n";
+    std::cout << "  -f, --follow      Wait like -w, printing text as the job streams it\n";
     std::cout << "  -W, --wait-idle   Wait for the workspace or selected set to become idle\n";
+    std::cout << "      --cancel      Stop a queued or running job; it fails with its partial output\n";
     std::cout << "      --json        Print JSON for status/results; waits print no selected results\n";
     std::cout << "      --tag <t>     Select all jobs with tag (ids; with --json, NDJSON)\n";
     std::cout << "      --children <id> Select all jobs with parent <id>\n";
+    std::cout << "      --queue       Show queued and running jobs per tag, with the longest wait\n";
     std::cout << "  -h, --help        Show help\n";
     std::cout << "  -v, --version     Show version\n";
     std::cout << "\n";
@@ -40,10 +42,13 @@ void printUsage() {
     std::cout << "  flw ./ws                          workspace status\n";
     std::cout << "  flw ./ws <job-id> -w              wait for and print one result\n";
     std::cout << "  wrk ./ws \"prompt\" | flw ./ws -w   submit and wait in one pipe\n";
+    std::cout << "  wrk ./ws \"prompt\" | flw ./ws -f   submit and watch the text arrive\n";
     std::cout << "  Wait requires a positional or piped job ID.\n";
+    std::cout << "  flw ./ws <job-id> --cancel -w     stop a job and print its failure\n";
     std::cout << "  flw ./ws -W                       block until all jobs finish\n";
     std::cout << "  flw ./ws -W --tag nightly         wait for this batch (no result output)\n";
     std::cout << "  flw ./ws --tag nightly --json     then collect the batch as NDJSON\n";
+    std::cout << "  flw ./ws --queue                  see which tenants are waiting\n";
     std::cout << "\n";
     std::cout << "Exit codes:\n";
     std::cout << "  Job result: 0 done, 1 failed/missing/error, 2 queued or running\n";
@@ -51,12 +56,6 @@ void printUsage() {
     std::cout << "  Workspace status and plain ID selection: 0 unless the command errors\n";
 }
 
-std::string readFileRaw(const std::filesystem::path& path) {
-    std::ifstream file(path, std::ios::binary);
-    return std::string((std::istreambuf_iterator<char>(file)),
-                       std::istreambuf_iterator<char>());
-}
-
 const char* statusToString(Status status) {
     switch (status) {
         case Status::Queued: return "QUEUED";
@@ -72,47 +71,10 @@ const char* statusToJsonString(Status status) {
     return contract::toString(status);
 }
 
-// A job selected by --tag or --children, wherever it currently lives.
-struct SetMatch {
-    JobId id;
-    Status status;
-};
-
-std::vector<SetMatch> selectSet(const std::filesystem::path& ws,
-                                const std::string& tag, const std::string& parent) {
-    // Scan upstream states first (queued → running → done → failed): jobs
-    // move downstream between scans, so a mid-scan transition is re-observed
-    // in a later directory instead of slipping through. Later sightings win.
-    std::map<JobId, Status> found;
-    for (Status s : {Status::Queued, Status::Running, Status::Done, Status::Failed}) {
-        auto dir = contract::stateDir(ws, s);
-        std::error_code ec;
-        if (!std::filesystem::exists(dir, ec) || ec) continue;
-        for (const auto& entry : std::filesystem::directory_iterator(dir)) {
-            if (!entry.is_directory()) continue;
-            auto id = entry.path().filename().string();
-            if (!contract::isValidJobId(id)) continue;
-            auto meta = readMetaJson(entry.path());
-            if (!meta) continue;
-            bool hit = false;
-            if (!tag.empty())
-                hit = std::find(meta->tags.begin(), meta->tags.end(), tag) != meta->tags.end();
-            if (!parent.empty())
-                hit = hit || meta->parent == parent;
-            if (hit) found[id] = s;
-        }
-    }
-    std::vector<SetMatch> matches;
-    matches.reserve(found.size());
-    for (const auto& [id, s] : found) matches.push_back({id, s});
-    return matches;  // std::map iterates id-sorted
-}
-
 // Use the single-job JSON object for each selected job.
 // NDJSON line for sets. Returns the exit code the single-job path uses.
-int printJobJson(Flow& flow, const std::filesystem::path& wsPath, const Job& job) {
+int printJobJson(Flow& flow, const Job& job) {
     auto meta = flow.meta(job.id);
-    auto outputDir = contract::jobDir(wsPath, Status::Done, job.id);
     std::ostringstream out;
     out << "{";
     out << "\"id\":\"" << escapeJson(job.id) << "\"";
@@ -124,6 +86,8 @@ int printJobJson(Flow& flow, const std::filesystem::path& wsPath, const Job& job
         if (meta->duration_s >= 0.0) out << ",\"duration_s\":" << meta->duration_s;
         if (!meta->parent.empty()) out << ",\"parent\":\"" << escapeJson(meta->parent) << "\"";
         if (!meta->output_format.empty()) out << ",\"output_format\":\"" << escapeJson(meta->output_format) << "\"";
+        if (!meta->cached_from.empty()) out << ",\"cached_from\":\"" << escapeJson(meta->cached_from) << "\"";
+        out << ",\"priority\":\"" << contract::toString(contract::parsePriority(meta->priority)) << "\"";
         if (!meta->tags.empty()) {
             out << ",\"tags\":[";
             for (size_t i = 0; i < meta->tags.size(); ++i) {
@@ -143,9 +107,12 @@ int printJobJson(Flow& flow, const std::filesystem::path& wsPath, const Job& job
     }
 
     if (job.status == Status::Done) {
-        if (auto artifact = contract::findOutputArtifact(outputDir)) {
+        if (auto artifact = flow.artifact(job.id)) {
             out << ",\"artifact_kind\":\"" << contract::toString(artifact->kind) << "\"";
-            out << ",\"artifact_path\":\"" << escapeJson(std::filesystem::absolute(artifact->path).string()) << "\"";
+            // An archived job's artifact lives inside a segment, not at a path.
+            if (!artifact->path.empty()) {
+                out << ",\"artifact_path\":\"" << escapeJson(std::filesystem::absolute(artifact->path).string()) << "\"";
+            }
             switch (artifact->kind) {
                 case contract::ArtifactKind::Result:
                     out << ",\"result\":\"" << escapeJson(job.content) << "\"";
@@ -159,7 +126,7 @@ int printJobJson(Flow& flow, const std::filesystem::path& wsPath, const Job& job
                 case contract::ArtifactKind::Embedding: {
                     // Compact: embedding.json is pretty-printed on disk, but
                     // NDJSON requires one object per line.
-                    auto raw = readFileRaw(artifact->path);
+                    auto raw = job.content;
                     raw.erase(std::remove(raw.begin(), raw.end(), '\n'), raw.end());
                     out << ",\"embedding\":" << raw;
                     break;
@@ -171,6 +138,8 @@ int printJobJson(Flow& flow, const std::filesystem::path& wsPath, const Job& job
         if (job.partial.has_value()) {
             out << ",\"partial\":\"" << escapeJson(*job.partial) << "\"";
         }
+    } else if (job.status == Status::Running && job.partial.has_value()) {
+        out << ",\"partial\":\"" << escapeJson(*job.partial) << "\"";
     }
     out << "}\n";
     std::cout << out.str();
@@ -206,18 +175,28 @@ int main(int argc, char* argv[]) {
     std::string jobId = "";
     std::string selectTag, selectParent;
     bool wait = false;
+    bool follow = false;
+    bool cancel = false;
     bool waitIdle = false;
     bool json = false;
+    bool queues = false;
 
     // Parse args
     for (int i = 2; i < argc; i++) {
         std::string arg = argv[i];
         if (arg == "-w" || arg == "--wait") {
             wait = true;
+        } else if (arg == "-f" || arg == "--follow") {
+            wait = true;
+            follow = true;
+        } else if (arg == "--cancel") {
+            cancel = true;
         } else if (arg == "--wait-idle" || arg == "-W") {
             waitIdle = true;
         } else if (arg == "--json") {
             json = true;
+        } else if (arg == "--queue") {
+            queues = true;
         } else if (arg == "--tag") {
             if (i + 1 >= argc) { std::cerr << "Error: --tag requires a value\n"; return 1; }
             selectTag = argv[++i];
@@ -244,9 +223,17 @@ int main(int argc, char* argv[]) {
         std::cerr << "Error: use -W, not -w, when waiting for a selected set\n";
         return 1;
     }
+    if (queues && (!jobId.empty() || wait || cancel || waitIdle || !selectTag.empty() || !selectParent.empty())) {
+        std::cerr << "Error: --queue takes no job ID or selection\n";
+        return 1;
+    }
+    if (cancel && (waitIdle || !selectTag.empty() || !selectParent.empty())) {
+        std::cerr << "Error: --cancel takes one job ID\n";
+        return 1;
+    }
 
     // Check piped input for JobID if not provided
-    if (wait && jobId.empty() && !isatty(fileno(stdin))) {
+    if ((wait || cancel) && jobId.empty() && !isatty(fileno(stdin))) {
         if (!(std::cin >> jobId)) {
             std::cerr << "No job ID received on stdin" << std::endl;
             return 1;
@@ -256,6 +243,10 @@ int main(int argc, char* argv[]) {
         std::cerr << "Error: -w requires a positional or piped job ID\n";
         return 1;
     }
+    if (cancel && jobId.empty()) {
+        std::cerr << "Error: --cancel requires a positional or piped job ID\n";
+        return 1;
+    }
 
     // Validate job ID format
     if (!jobId.empty() && !contract::isValidJobId(jobId)) {
@@ -275,16 +266,65 @@ int main(int argc, char* argv[]) {
         Flow flow(workspace);
         std::filesystem::path wsPath(workspace);
 
+        // The daemon stops the job at its next check and moves it to failed/.
+        if (cancel) {
+            Status s = Work(wsPath, false).cancel(jobId);
+            if (s == Status::Done || s == Status::Failed) {
+                std::cerr << "Job already finished: " << jobId << " (" << statusToJsonString(s) << ")\n";
+                return 1;
+            }
+            if (s == Status::Missing) {
+                std::cerr << "Job not found: " << jobId << std::endl;
+                return 1;
+            }
+            std::cerr << "Cancel requested: " << jobId << " (" << statusToJsonString(s) << ")\n";
+            if (!wait) {
+                return 0;
+            }
+        }
+
+        // Fair-share groups: a job's first tag, else its parent.
+        if (queues) {
+            auto groups = flow.groups();
+            if (json) {
+                for (const auto& g : groups) {
+                    std::cout << "{\"group\":\"" << escapeJson(g.group) << "\""
+                              << ",\"queued\":" << g.queued
+                              << ",\"running\":" << g.running
+                              << ",\"oldest_wait_s\":" << g.oldest_wait_s << "}\n";
+                }
+                return 0;
+            }
+            if (groups.empty()) {
+                std::cout << "no queued or running jobs\n";
+                return 0;
+            }
+            std::cout << "group                              queued  running  oldest wait\n";
+            for (const auto& g : groups) {
+                char line[128];
+                const std::string name = g.group.empty() ? "(untagged)" : g.group;
+                if (g.queued > 0) {
+                    std::snprintf(line, sizeof(line), "%-32s %8zu %8zu %11.1fs", name.c_str(),
+                                  g.queued, g.running, g.oldest_wait_s);
+                } else {
+                    std::snprintf(line, sizeof(line), "%-32s %8zu %8zu %12s", name.c_str(),
+                                  g.queued, g.running, "-");
+                }
+                std::cout << line << "\n";
+            }
+            return 0;
+        }
+
         // Set output: all jobs matching --tag / --children. JSON collection
         // aggregates failure: exit 1 if any job in the set failed or could
         // not be retrieved, so batch scripts can trust the exit code.
         if ((!selectTag.empty() || !selectParent.empty()) && !waitIdle) {
-            auto matches = selectSet(wsPath, selectTag, selectParent);
+            auto matches = flow.select(selectTag, selectParent);
             int rc = 0;
             for (const auto& m : matches) {
                 if (json) {
                     auto job = flow.get(m.id);
-                    if (!job || printJobJson(flow, wsPath, *job) != 0) rc = 1;
+                    if (!job || printJobJson(flow, *job) != 0) rc = 1;
                 } else {
                     std::cout << m.id << "\n";
                 }
@@ -296,7 +336,7 @@ int main(int argc, char* argv[]) {
         // fail if the set contains failures. Bare -W keeps global-idle semantics.
         if (waitIdle && (!selectTag.empty() || !selectParent.empty())) {
             while (true) {
-                auto set = selectSet(wsPath, selectTag, selectParent);
+                auto set = flow.select(selectTag, selectParent);
                 bool pending = false, failed = false;
                 for (const auto& m : set) {
                     if (m.status == Status::Queued || m.status == Status::Running) pending = true;
@@ -330,11 +370,19 @@ int main(int argc, char* argv[]) {
         // No job ID and no pipe: show workspace status
         if (jobId.empty() && !wait) {
             auto c = flow.counts();
+            auto reclaimed = flow.reclaimed();
             if (json) {
                 std::cout << "{\"queued\":" << c.queued
                           << ",\"running\":" << c.running
                           << ",\"done\":" << c.done
-                          << ",\"failed\":" << c.failed << "}\n";
+                          << ",\"failed\":" << c.failed;
+                if (reclaimed) {
+                    std::cout << ",\"reclaimed\":{\"jobs\":" << reclaimed->jobs
+                              << ",\"bytes\":" << reclaimed->bytes
+                              << ",\"inodes\":" << reclaimed->inodes
+                              << ",\"last_run\":\"" << reclaimed->last_run << "\"}";
+                }
+                std::cout << "}\n";
                 return 0;
             }
 
@@ -342,6 +390,10 @@ int main(int argc, char* argv[]) {
                       << "running:    " << c.running << "\n"
                       << "done:       " << c.done << "\n"
                       << "failed:     " << c.failed << "\n";
+            if (reclaimed) {
+                std::cout << "reclaimed:  " << reclaimed->jobs << " jobs, " << reclaimed->bytes / (1024 * 1024)
+                          << " MB, " << reclaimed->inodes << " inodes\n";
+            }
 
             if (c.queued + c.running + c.done + c.failed == 0) {
                 std::cout << "\nno jobs yet. Submit one:  wrk " << workspace << " \"your prompt\"\n";
@@ -355,23 +407,34 @@ int main(int argc, char* argv[]) {
                 for (const auto& job : recentJobs) {
                     const char* tag = statusToJsonString(job.status);
                     auto m = flow.meta(job.id);
+                    const Priority lane = contract::parsePriority(m ? m->priority : "");
                     if (m && m->duration_s >= 0.0) {
                         char dur[16];
                         std::snprintf(dur, sizeof(dur), "%5.1fs", m->duration_s);
-                        std::cout << "  [" << tag << "] " << dur << "  " << job.id << "\n";
+                        std::cout << "  [" << tag << "] " << dur << "  " << job.id;
                     } else {
-                        std::cout << "  [" << tag << "]        " << job.id << "\n";
+                        std::cout << "  [" << tag << "]        " << job.id;
                     }
+                    if (lane != Priority::Normal) std::cout << "  (" << contract::toString(lane) << ")";
+                    std::cout << "\n";
                 }
             }
             return 0;
         }
 
-        // Wait loop
+        // Wait loop. Follow mode prints streamed text as it grows.
+        std::string streamed;
         if (wait) {
             while (true) {
                 Status s = flow.status(jobId);
                 if (s == Status::Done || s == Status::Failed || s == Status::Missing) break;
+                if (follow && !json && s == Status::Running) {
+                    auto text = flow.partial(jobId, streamed.size());
+                    if (!text.empty()) {
+                        std::cout << text << std::flush;
+                        streamed += text;
+                    }
+                }
                 std::this_thread::sleep_for(std::chrono::milliseconds(100));
             }
         }
@@ -386,17 +449,29 @@ int main(int argc, char* argv[]) {
             }
 
             if (json) {
-                return printJobJson(flow, wsPath, *job);
+                return printJobJson(flow, *job);
             }
 
             if (job->status == Status::Done) {
                 // Print the audio path instead of binary content.
-                auto artifact = contract::findOutputArtifact(
-                    contract::jobDir(std::filesystem::path(workspace), Status::Done, jobId));
+                auto artifact = flow.artifact(jobId);
                 if (artifact && artifact->kind == contract::ArtifactKind::Audio) {
                     std::cout << std::filesystem::absolute(artifact->path).string() << std::endl;
                     return 0;
                 }
+                // After following, print only what the stream has not shown.
+                // A result that differs from the raw stream, such as one with
+                // reasoning removed, is printed in full on a new line.
+                if (!streamed.empty()) {
+                    if (job->content.compare(0, streamed.size(), streamed) == 0) {
+                        job->content.erase(0, streamed.size());
+                        if (job->content.empty() && streamed.back() != '\n') {
+                            std::cout << '\n';
+                        }
+                    } else {
+                        std::cout << '\n';
+                    }
+                }
                 std::cout << job->content;
                 if (!job->content.empty() && job->content.back() != '\n') {
                     std::cout << '\n';
@@ -409,7 +484,11 @@ int main(int argc, char* argv[]) {
                 }
                 return 1;
             } else {
-                std::cerr << "Job not ready: " << jobId << " (status: " << statusToString(job->status) << ")" << std::endl;
+                auto m = flow.meta(jobId);
+                const Priority lane = contract::parsePriority(m ? m->priority : "");
+                std::cerr << "Job not ready: " << jobId << " (status: " << statusToString(job->status);
+                if (lane != Priority::Normal) std::cerr << ", priority: " << contract::toString(lane);
+                std::cerr << ")" << std::endl;
                 return 2; // Different exit code for "not ready"
             }
 
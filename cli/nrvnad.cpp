@@ -305,6 +305,7 @@ void printHelp() {
     std::cout << "Options:\n";
     std::cout << "      --mmproj <path>    Multimodal projection model for vision and STT jobs\n";
     std::cout << "      --vocoder <path>   Vocoder model for TTS jobs\n";
+    std::cout << "      --draft <path>     Small draft model for speculative text and vision decoding\n";
     std::cout << "  -w, --workers <n>      Worker threads (default 4; 1-64)\n";
     std::cout << "      --drain            Process everything queued, then exit; starts no lasting daemon\n";
     std::cout << "  -h, --help             Show help\n";
@@ -425,6 +426,7 @@ int main(int argc, char * argv[]) {
     std::string workspace;
     std::string mmprojPath;
     std::string vocoderPath;
+    std::string draftPath;
     bool drainMode = false;
     int workers = 4;
     if (const char* envWorkers = std::getenv("NRVNA_WORKERS")) {
@@ -458,6 +460,12 @@ int main(int argc, char * argv[]) {
                 return 1;
             }
             vocoderPath = argv[++i];
+        } else if (arg == "--draft") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --draft requires a path\n";
+                return 1;
+            }
+            draftPath = argv[++i];
         } else if (arg == "--drain") {
             drainMode = true;
         } else if (!arg.empty() && arg[0] == '-') {
@@ -560,6 +568,12 @@ int main(int argc, char * argv[]) {
         return 1;
     }
 
+    if (!draftPath.empty() && !std::filesystem::exists(std::filesystem::path(draftPath))) {
+        std::cerr << "Error: Draft model not found: " << draftPath << "\n";
+        releaseWorkspaceLock();
+        return 1;
+    }
+
     ModelInfo probeInfo = Runner::probeModelInfo(modelPath);
     if (!probeInfo.valid) {
         std::cerr << "Error: Failed to probe model metadata: " << modelPath << "\n";
@@ -574,6 +588,7 @@ int main(int argc, char * argv[]) {
              " workers=" + std::to_string(workers) +
              " mmproj=" + (mmprojPath.empty() ? std::string("none") : mmprojPath) +
              " vocoder=" + (vocoderPath.empty() ? std::string("none") : vocoderPath) +
+             " draft=" + (draftPath.empty() ? std::string("none") : draftPath) +
              " gpu_layers=" + std::to_string(daemonGpuLayers()));
 
     const bool interactive = terminal::stderrIsTerminal();
@@ -614,7 +629,8 @@ int main(int argc, char * argv[]) {
         Flow drainFlow((std::filesystem::path(workspace)));
         const std::size_t failedBaseline = drainMode ? drainFlow.counts().failed : 0;
 
-        auto server = std::make_unique<Server>(modelPath, workspace, workers, mmprojPath, vocoderPath);
+        auto server = std::make_unique<Server>(modelPath, workspace, workers, mmprojPath, vocoderPath,
+                                               draftPath);
 
         if (!server->start()) {
             std::cerr << "  " << ansi("\033[31m") << "Failed to start" << ansi("\033[0m") << "\n";
@@ -644,6 +660,9 @@ int main(int argc, char * argv[]) {
         if (!vocoderPath.empty()) {
             std::cerr << "    Vocoder    " << vocoderPath << "\n";
         }
+        if (!draftPath.empty()) {
+            std::cerr << "    Draft      " << draftPath << "\n";
+        }
         std::cerr << "\n";
         if (interactive) {
             std::cerr << "  " << ansi("\033[90m")
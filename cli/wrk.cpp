@@ -15,6 +15,7 @@
 #include <iostream>
 #include <sstream>
 #include <iterator>
+#include <stdexcept>
 #include <unistd.h>
 
 using namespace nrvna;
@@ -76,8 +77,12 @@ void printUsage() {
     std::cout << "      --stt            Transcribe audio\n";
     std::cout << "      --parent <id>    Set the parent job\n";
     std::cout << "      --tag <tag>      Add a tag (repeatable)\n";
+    std::cout << "      --continue       Continue the parent's conversation (text only)\n";
     std::cout << "      --json-schema <path>  Constrain text or vision output with JSON Schema\n";
     std::cout << "      --grammar <path>      Constrain text or vision output with GBNF\n";
+    std::cout << "      --speculate <mode>    Speculative decoding: off, ngram, or draft\n";
+    std::cout << "      --timeout <seconds>   Fail the job after this long running\n";
+    std::cout << "      --priority <lane>     Scheduling lane: high, normal, or low\n";
     std::cout << "  -h, --help           Show help\n";
     std::cout << "  -v, --version        Show version\n";
     std::cout << "\n";
@@ -86,6 +91,10 @@ void printUsage() {
     std::cout << "  { echo \"Summarize:\"; cat notes.md; } | wrk ./ws -\n";
     std::cout << "  wrk ./ws \"What is this screenshot about?\" --image shot.png\n";
     std::cout << "  wrk ./ws \"Extract the fields\" --json-schema fields.schema.json\n";
+    std::cout << "  { echo \"Fix the OCR errors:\"; cat page.txt; } | wrk ./ws - --speculate ngram\n";
+    std::cout << "  wrk ./ws \"And in French?\" --parent <job-id> --continue\n";
+    std::cout << "  wrk ./ws \"Write a long story\" --timeout 120\n";
+    std::cout << "  wrk ./ws - --priority low < nightly-item.txt\n";
     std::cout << "\n";
     std::cout << "wrk creates the workspace when it is missing.\n";
     std::cout << "It prints only the job ID on stdout. Collect the result with:\n";
@@ -185,6 +194,44 @@ int main(int argc, char* argv[]) {
                 return 1;
             }
             grammarPath = argv[++i];
+        } else if (arg == "--speculate") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --speculate requires a mode\n";
+                return 1;
+            }
+            submitOptions.speculate = argv[++i];
+            if (!contract::isValidSpeculation(submitOptions.speculate)) {
+                std::cerr << "Error: --speculate must be off, ngram, or draft\n";
+                return 1;
+            }
+        } else if (arg == "--timeout") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --timeout requires seconds\n";
+                return 1;
+            }
+            try {
+                size_t used = 0;
+                const std::string value = argv[++i];
+                submitOptions.timeout_s = std::stod(value, &used);
+                if (used != value.size() || !(submitOptions.timeout_s > 0.0)) {
+                    throw std::invalid_argument(value);
+                }
+            } catch (const std::exception&) {
+                std::cerr << "Error: --timeout must be a positive number of seconds\n";
+                return 1;
+            }
+        } else if (arg == "--priority") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --priority requires a lane\n";
+                return 1;
+            }
+            submitOptions.priority = argv[++i];
+            if (!contract::isValidPriority(submitOptions.priority)) {
+                std::cerr << "Error: --priority must be high, normal, or low\n";
+                return 1;
+            }
+        } else if (arg == "--continue") {
+            submitOptions.continuation = true;
         } else if (arg == "--embed") {
             useEmbed = true;
         } else if (arg == "--tts") {
@@ -260,6 +307,16 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    if (submitOptions.continuation && (useEmbed || !mode.empty() || !imagePaths.empty())) {
+        std::cerr << "Error: --continue requires a text job\n";
+        return 1;
+    }
+
+    if (!submitOptions.speculate.empty() && (useEmbed || !mode.empty())) {
+        std::cerr << "Error: --speculate requires a text or vision job\n";
+        return 1;
+    }
+
     if (!schemaPath.empty()) {
         try {
             std::string error;
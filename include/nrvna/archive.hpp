@@ -0,0 +1,118 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "nrvna/types.hpp"
+
+namespace nrvna {
+
+// Space and inodes given back to the filesystem.
+struct Reclaimed {
+    uint64_t bytes = 0;
+    uint64_t inodes = 0;
+};
+
+// Done jobs packed into append-only segment files under archive/, one
+// record per job holding its files, found through an append-only offset
+// index. An archived job keeps its ID and stays Done; readers look in
+// output/ first and here second. An Archive object is not thread-safe;
+// writers in one process take turns.
+class Archive final {
+public:
+    explicit Archive(std::filesystem::path workspace) noexcept;
+
+    // Read index lines appended since the last call. False if none were.
+    bool refresh();
+
+    [[nodiscard]] bool contains(const JobId& id) const;
+    [[nodiscard]] std::vector<JobId> ids() const;
+    [[nodiscard]] std::size_t size() const noexcept { return locations_.size(); }
+    // When the job finished, from its directory's mtime at packing.
+    [[nodiscard]] std::optional<int64_t> time(const JobId& id) const;
+
+    // Relative names of an archived job's files, such as "images/0.png".
+    [[nodiscard]] std::vector<std::string> files(const JobId& id) const;
+    [[nodiscard]] std::optional<std::string> readFile(const JobId& id, const std::string& name) const;
+
+    // Append the directories of Done jobs to the newest segment, make the
+    // segment and index durable, then remove the directories. Segments
+    // roll over past segmentBytes. Returns the jobs packed.
+    std::size_t pack(const std::vector<JobId>& ids, std::uintmax_t segmentBytes);
+    // Drop jobs from the index. A sealed segment less than a quarter live
+    // has its live records copied to a new segment; a segment is deleted
+    // once none of its records is live.
+    Reclaimed remove(const std::vector<JobId>& ids);
+
+    // Held while a writer in this process changes the archive or removes
+    // directories from output/ next to it.
+    static std::mutex& writeMutex() noexcept;
+
+private:
+    struct Location {
+        uint32_t segment = 0;
+        uint64_t offset = 0;
+        uint64_t length = 0;
+        int64_t time_us = 0;
+    };
+
+    // Calls visit(name, size, stream) for each file of the record, with the
+    // stream at the file's first byte; visit returns false to stop.
+    template <typename Visit>
+    bool walk(const JobId& id, Visit&& visit) const;
+    [[nodiscard]] std::filesystem::path segmentPath(uint32_t segment) const;
+    // Copy the live records of mostly dead sealed segments into a new one
+    // and index them there. Returns the bytes written.
+    uint64_t rewriteSparse();
+
+    std::filesystem::path workspace_;
+    std::unordered_map<JobId, Location> locations_;
+    uint64_t indexOffset_ = 0;
+    uint32_t lastSegment_ = 0;
+};
+
+// Moves Done jobs older than minAge from output/ into the archive, one pass
+// a minute on a background thread. Jobs whose files are handed out by path
+// (audio.wav, state.kv) stay directories.
+class Compactor final {
+public:
+    Compactor(std::filesystem::path workspace, std::chrono::seconds minAge,
+              std::uintmax_t segmentBytes) noexcept;
+    ~Compactor();
+
+    Compactor(const Compactor&) = delete;
+    Compactor& operator=(const Compactor&) = delete;
+
+    [[nodiscard]] bool start() noexcept;
+    void stop() noexcept;
+
+    // One pass, on the caller. Returns the jobs packed.
+    std::size_t compact();
+
+private:
+    void loop();
+
+    std::filesystem::path workspace_;
+    std::chrono::seconds minAge_;
+    std::uintmax_t segmentBytes_;
+    Archive archive_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+}
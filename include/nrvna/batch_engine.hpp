@@ -0,0 +1,99 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "nrvna/prefix_cache.hpp"
+#include "nrvna/runner.hpp"
+
+struct llama_model;
+struct llama_context;
+struct llama_sampler;
+
+namespace nrvna {
+
+class TextStream;
+
+// Continuous batching: one multi-sequence llama_context shared by every worker.
+// Each live job owns a sequence ID. The engine thread advances all sequences
+// with a single llama_decode per step, and new jobs join between steps.
+class BatchEngine final {
+public:
+    BatchEngine(std::shared_ptr<llama_model> model, int maxSequences, int sequenceCtx);
+    ~BatchEngine();
+
+    BatchEngine(const BatchEngine&) = delete;
+    BatchEngine& operator=(const BatchEngine&) = delete;
+    BatchEngine(BatchEngine&&) = delete;
+    BatchEngine& operator=(BatchEngine&&) = delete;
+
+    [[nodiscard]] bool start() noexcept;
+    void stop() noexcept;
+
+    // Blocks until the sequence finishes. Takes ownership of sampler.
+    // prefix, when given, is restored into the sequence instead of prefilled;
+    // snapshotAt > 0 saves the sequence state to the prefix cache at that length.
+    // onText is called from the engine thread as text is generated. A stopped
+    // control ends the sequence between steps.
+    [[nodiscard]] RunResult generate(std::vector<int32_t> promptTokens, llama_sampler* sampler, int nPredict,
+                                     std::shared_ptr<const PrefixEntry> prefix = nullptr,
+                                     size_t snapshotAt = 0, TextSink onText = nullptr,
+                                     JobControl* control = nullptr);
+
+    void attachPrefixCache(std::shared_ptr<PrefixCache> cache) noexcept { prefixCache_ = std::move(cache); }
+
+    [[nodiscard]] int sequenceContext() const noexcept { return sequenceCtx_; }
+
+private:
+    struct Sequence {
+        std::vector<int32_t> prompt;
+        llama_sampler* sampler = nullptr;
+        int nPredict = 0;
+        int seqId = -1;
+        size_t prefilled = 0;
+        int nPast = 0;
+        int generated = 0;
+        int32_t next = 0;
+        int32_t logitIndex = -1;
+        std::string output;
+        std::shared_ptr<const PrefixEntry> prefix;
+        size_t snapshotAt = 0;
+        size_t reused = 0;
+        std::unique_ptr<TextStream> stream;
+        JobControl* control = nullptr;
+        std::promise<RunResult> done;
+
+        ~Sequence();
+    };
+
+    void loop();
+    void finish(Sequence& seq, RunResult result) noexcept;
+    void restorePrefix(Sequence& seq) noexcept;
+    void savePrefix(Sequence& seq) noexcept;
+
+    std::shared_ptr<llama_model> model_;
+    llama_context* ctx_ = nullptr;
+    int maxSequences_;
+    int sequenceCtx_;
+    int nBatch_ = 0;
+    std::shared_ptr<PrefixCache> prefixCache_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::unique_ptr<Sequence>> pending_;
+    std::vector<int> freeSeqIds_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+}
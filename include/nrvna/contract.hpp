@@ -24,6 +24,7 @@ inline constexpr const char* kReadyDir      = "input/ready";    // Status::Queue
 inline constexpr const char* kProcessingDir = "processing";     // Status::Running
 inline constexpr const char* kOutputDir     = "output";         // Status::Done
 inline constexpr const char* kFailedDir     = "failed";         // Status::Failed
+inline constexpr const char* kConfigFile    = "nrvna.json";     // optional daemon settings
 
 // ── Files and directories inside a job directory ───────────────────────
 inline constexpr const char* kPromptFile     = "prompt.txt";
@@ -37,10 +38,25 @@ inline constexpr const char* kErrorFile      = "error.txt";
 inline constexpr const char* kResponseFile   = "response.txt";
 inline constexpr const char* kSchemaFile     = "schema.json";
 inline constexpr const char* kGrammarFile    = "grammar.gbnf";
+inline constexpr const char* kPartialFile    = "partial.txt";   // streamed text while Running
+inline constexpr const char* kStateFile      = "state.kv";      // final KV state of a --continue job
+inline constexpr const char* kCancelFile     = "cancel";        // written by flw --cancel; stops the job
 inline constexpr const char* kImagesDir      = "images";
 inline constexpr const char* kAudioInputDir  = "audio";
 inline constexpr std::uintmax_t kMaxStructuredOutputBytes = 1'000'000;
 
+// ── Workspace-level files, relative to the workspace root ──────────────
+inline constexpr const char* kSystemPromptFile   = "system.txt";          // optional system message
+inline constexpr const char* kJournalFile        = ".nrvna.journal";      // appended on every state change
+inline constexpr const char* kRotatedJournalFile = ".nrvna.journal.old";  // journal being folded into the index
+inline constexpr const char* kIndexFile          = ".nrvna.index";        // journal snapshot, written by nrvnad
+inline constexpr const char* kGcStatsFile        = ".nrvna.gc";           // space reclaimed by retention
+
+// ── Archive of compacted Done jobs, relative to the workspace root ─────
+inline constexpr const char* kArchiveDir       = "archive";        // append-only segment files
+inline constexpr const char* kArchiveIndexFile = "archive/index";  // job ID -> segment, offset, length
+inline constexpr const char* kSegmentExtension = ".seg";
+
 // Directory a job in state `s` lives under. Missing has no directory.
 inline std::filesystem::path stateDir(const std::filesystem::path& ws, Status s) {
     switch (s) {
@@ -122,6 +138,33 @@ inline bool isValidJobId(const JobId& id) {
     return true;
 }
 
+// ── Speculative decoding modes ──────────────────────────────────────────
+// Per-job choice in meta.json "speculate"; NRVNA_SPECULATE sets the default.
+inline bool isValidSpeculation(const std::string& mode) {
+    return mode == "off" || mode == "ngram" || mode == "draft";
+}
+
+// ── Priority lanes ──────────────────────────────────────────────────────
+// Per-job choice in meta.json "priority"; absent means normal.
+inline const char* toString(Priority p) {
+    switch (p) {
+        case Priority::High: return "high";
+        case Priority::Low:  return "low";
+        default:             return "normal";
+    }
+}
+
+inline bool isValidPriority(const std::string& s) {
+    return s == "high" || s == "normal" || s == "low";
+}
+
+// Unknown or empty values mean normal.
+inline Priority parsePriority(const std::string& s) {
+    if (s == "high") return Priority::High;
+    if (s == "low")  return Priority::Low;
+    return Priority::Normal;
+}
+
 // ── The output artifact rule ────────────────────────────────────────────
 // A Done job has exactly one primary artifact; when several exist, this
 // priority order decides. Stated once, here.
@@ -141,19 +184,33 @@ inline const char* toString(ArtifactKind k) {
     }
 }
 
-inline std::optional<Artifact> findOutputArtifact(const std::filesystem::path& jobDir) {
-    const std::pair<ArtifactKind, const char*> priority[] = {
-        {ArtifactKind::Result,     kResultFile},
-        {ArtifactKind::Transcript, kTranscriptFile},
-        {ArtifactKind::Audio,      kAudioFile},
-        {ArtifactKind::Embedding,  kEmbeddingFile},
-    };
-    for (const auto& [kind, name] : priority) {
-        auto p = jobDir / name;
-        std::error_code ec;
-        if (std::filesystem::exists(p, ec) && !ec) return Artifact{kind, p};
+inline const char* fileName(ArtifactKind k) {
+    switch (k) {
+        case ArtifactKind::Transcript: return kTranscriptFile;
+        case ArtifactKind::Audio:      return kAudioFile;
+        case ArtifactKind::Embedding:  return kEmbeddingFile;
+        default:                       return kResultFile;
+    }
+}
+
+// The primary artifact among the files present(name) reports, whether the
+// job is a directory or packed in an archive segment.
+template <typename Present>
+std::optional<ArtifactKind> primaryArtifact(Present&& present) {
+    for (ArtifactKind kind : {ArtifactKind::Result, ArtifactKind::Transcript,
+                              ArtifactKind::Audio, ArtifactKind::Embedding}) {
+        if (present(fileName(kind))) return kind;
     }
     return std::nullopt;
 }
 
+inline std::optional<Artifact> findOutputArtifact(const std::filesystem::path& jobDir) {
+    auto kind = primaryArtifact([&](const char* name) {
+        std::error_code ec;
+        return std::filesystem::exists(jobDir / name, ec) && !ec;
+    });
+    if (!kind) return std::nullopt;
+    return Artifact{*kind, jobDir / fileName(*kind)};
+}
+
 } // namespace nrvna::contract
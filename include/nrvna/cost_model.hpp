@@ -0,0 +1,51 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+
+#include "nrvna/types.hpp"
+
+namespace nrvna {
+
+// The inputs that drive a job's service time, as found in its directory.
+struct JobShape {
+    JobType type = JobType::Text;
+    std::uintmax_t promptBytes = 0;
+    std::size_t images = 0;  // files under images/
+    std::size_t audio = 0;   // files under audio/
+};
+
+// Predicts a job's service time in seconds for shortest-job-first. A job's
+// work is one unit plus one per KiB of prompt and four per attached file; each
+// mode learns its seconds per unit from the jobs it completes. Thread-safe.
+class CostModel final {
+public:
+    CostModel() noexcept;
+
+    CostModel(const CostModel&) = delete;
+    CostModel& operator=(const CostModel&) = delete;
+
+    [[nodiscard]] static JobShape inspect(const std::filesystem::path& jobDir) noexcept;
+
+    [[nodiscard]] double estimate(const JobShape& shape) const noexcept;
+    void observe(const JobShape& shape, double seconds) noexcept;
+    // Learn from the newest completed jobs in output/. Returns how many were used.
+    std::size_t seed(const std::filesystem::path& workspace, std::size_t limit = 256) noexcept;
+
+private:
+    static constexpr std::size_t kModes = 5;
+
+    [[nodiscard]] static double units(const JobShape& shape) noexcept;
+
+    mutable std::mutex mutex_;
+    std::array<double, kModes> secondsPerUnit_;
+};
+
+}
@@ -0,0 +1,81 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace nrvna {
+
+// How far job state transitions are forced to stable storage (NRVNA_DURABILITY).
+enum class Durability : uint8_t {
+    None,    // leave write-back to the OS
+    Rename,  // fsync the state directories a publishing rename changed
+    Full     // also fsync a job's files before the rename
+};
+
+[[nodiscard]] std::optional<Durability> parseDurability(std::string_view value) noexcept;
+
+// Group commit for fsyncs. Callers queue the paths they need durable and
+// block; one thread syncs everything queued so far in a single pass, each
+// path once, and wakes them all. A directory that many jobs were renamed into
+// is synced once per pass rather than once per job.
+class Syncer final {
+public:
+    explicit Syncer(Durability mode) noexcept;
+    ~Syncer();
+
+    Syncer(const Syncer&) = delete;
+    Syncer& operator=(const Syncer&) = delete;
+    Syncer(Syncer&&) = delete;
+    Syncer& operator=(Syncer&&) = delete;
+
+    // The process-wide syncer, in the mode NRVNA_DURABILITY names. An
+    // unknown value warns and uses none.
+    [[nodiscard]] static Syncer& shared();
+
+    [[nodiscard]] Durability mode() const noexcept { return mode_; }
+
+    // Full: make jobDir's files and entries durable before it is renamed
+    // into a state other processes read.
+    [[nodiscard]] bool beforeRename(const std::filesystem::path& jobDir);
+    // Rename and Full: make a completed rename of a job directory durable.
+    [[nodiscard]] bool afterRename(const std::filesystem::path& from, const std::filesystem::path& to);
+
+    // fsync every path, sharing a pass with concurrent callers. False if any
+    // of this caller's paths failed.
+    [[nodiscard]] bool sync(std::vector<std::filesystem::path> paths);
+    void stop() noexcept;
+
+    // Passes run so far.
+    [[nodiscard]] uint64_t passes() const;
+
+private:
+    struct Request {
+        std::vector<std::filesystem::path> paths;
+        bool done = false;
+        bool ok = true;
+    };
+
+    void loop();
+
+    Durability mode_;
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    std::deque<Request*> queue_;
+    uint64_t passes_ = 0;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+}
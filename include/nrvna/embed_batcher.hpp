@@ -0,0 +1,68 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "nrvna/runner.hpp"
+#include "nrvna/types.hpp"
+
+namespace nrvna {
+
+// Coalesces text embedding jobs from all workers. Workers hand a job over and
+// return; the batcher thread embeds up to maxBatch jobs with one
+// Runner::embedBatch call once the batch is full or maxDelay has passed.
+class EmbedBatcher final {
+public:
+    struct Job {
+        JobId jobId;
+        std::string text;
+        std::chrono::steady_clock::time_point startTime;
+        std::string cacheKey;  // handed back to the completion
+    };
+    using Completion = std::function<void(const Job&, const EmbedResult&)>;
+
+    EmbedBatcher(std::unique_ptr<Runner> runner, std::size_t maxBatch,
+                 std::chrono::milliseconds maxDelay, Completion complete);
+    ~EmbedBatcher();
+
+    EmbedBatcher(const EmbedBatcher&) = delete;
+    EmbedBatcher& operator=(const EmbedBatcher&) = delete;
+    EmbedBatcher(EmbedBatcher&&) = delete;
+    EmbedBatcher& operator=(EmbedBatcher&&) = delete;
+
+    [[nodiscard]] bool start() noexcept;
+    // Embeds everything still queued, then joins the thread.
+    void stop() noexcept;
+
+    // Blocks while the queue is full. Returns false if the batcher is stopped.
+    [[nodiscard]] bool submit(Job job);
+
+private:
+    void loop();
+
+    std::unique_ptr<Runner> runner_;
+    std::size_t maxBatch_;
+    std::size_t maxQueued_;
+    std::chrono::milliseconds maxDelay_;
+    Completion complete_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable space_;
+    std::deque<std::pair<Job, std::chrono::steady_clock::time_point>> queue_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+}
@@ -0,0 +1,55 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nrvna {
+
+// Publishes finished jobs off the worker threads. Workers queue a task that
+// writes a job's artifacts and meta.json and renames it out of processing/,
+// then go back to inference. A job stays in processing/ until its task runs,
+// so a crash in between leaves it for recovery as before.
+class Finalizer final {
+public:
+    using Task = std::function<void()>;
+
+    Finalizer(std::size_t threads, std::size_t capacity) noexcept;
+    ~Finalizer();
+
+    Finalizer(const Finalizer&) = delete;
+    Finalizer& operator=(const Finalizer&) = delete;
+    Finalizer(Finalizer&&) = delete;
+    Finalizer& operator=(Finalizer&&) = delete;
+
+    [[nodiscard]] bool start() noexcept;
+    // Runs everything still queued, then joins the threads.
+    void stop() noexcept;
+
+    // Blocks while the queue is full. Returns false if the finalizer is
+    // stopped; the caller then runs the task itself.
+    [[nodiscard]] bool submit(Task task);
+
+private:
+    void loop();
+
+    std::size_t threadCount_;
+    std::size_t capacity_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable space_;
+    std::deque<Task> queue_;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+};
+
+}
@@ -12,7 +12,11 @@
 #include <chrono>
 
 #include "nrvna/types.hpp"
+#include "nrvna/archive.hpp"
+#include "nrvna/contract.hpp"
+#include "nrvna/job_index.hpp"
 #include "nrvna/meta.hpp"
+#include "nrvna/retention.hpp"
 
 namespace nrvna {
 
@@ -31,6 +35,20 @@ struct WorkspaceCounts {
     std::size_t failed = 0;
 };
 
+// A job selected by tag or parent, and where it currently lives.
+struct SetMatch {
+    JobId id;
+    Status status;
+};
+
+// Queued and running jobs of one fair-share group (see fairShareGroup).
+struct GroupQueue {
+    std::string group;
+    std::size_t queued = 0;
+    std::size_t running = 0;
+    double oldest_wait_s = 0.0;  // longest wait among queued jobs
+};
+
 class Flow {
 public:
     explicit Flow(const std::filesystem::path& workspace) noexcept;
@@ -44,11 +62,42 @@ public:
     [[nodiscard]] std::vector<Job> list(std::size_t max = 10) const noexcept;
     [[nodiscard]] Status status(const JobId& id) const noexcept;
     [[nodiscard]] WorkspaceCounts counts() const noexcept;
+    // What retention has deleted so far; nullopt if it never ran.
+    [[nodiscard]] std::optional<ReclaimStats> reclaimed() const noexcept;
+    // Per-group queue depth, sorted by group. Reads meta.json of every
+    // queued and running job.
+    [[nodiscard]] std::vector<GroupQueue> groups() const noexcept;
 
     [[nodiscard]] std::optional<JobMeta> meta(const JobId& id) const noexcept;
+    // A Done job's primary artifact. The path is empty for an archived job.
+    [[nodiscard]] std::optional<contract::Artifact> artifact(const JobId& id) const noexcept;
+
+    // Jobs carrying tag, or whose parent is parent (either may be empty), in
+    // ID order. Queued and running jobs are read from their meta.json; the
+    // rest come from the job index when nrvnad has written one, otherwise
+    // from every job's meta.json.
+    [[nodiscard]] std::vector<SetMatch> select(const std::string& tag, const JobId& parent) const noexcept;
+
+    // Text streamed by a running job, starting at byte offset. Empty when
+    // the job is not running or has streamed nothing new.
+    [[nodiscard]] std::string partial(const JobId& id, std::size_t offset = 0) const noexcept;
 
 private:
     std::filesystem::path workspace_;
+    // Loaded on first use and refreshed from the journal on each query.
+    mutable std::optional<JobIndex> index_;
+    mutable bool indexTried_ = false;
+    mutable std::optional<Archive> archive_;
+
+    // The index, current as of this call, or null without a snapshot.
+    [[nodiscard]] const JobIndex* index() const;
+    [[nodiscard]] std::vector<SetMatch> scanSelect(const std::string& tag, const JobId& parent) const;
+    // True if a Done or Failed entry's job still exists: the index keeps
+    // jobs deleted by hand until it is rebuilt.
+    [[nodiscard]] bool present(const JobId& id, Status state) const;
+    // The archive, with index lines appended since the last call applied.
+    [[nodiscard]] const Archive& archive() const;
+    [[nodiscard]] std::optional<Job> getArchived(const JobId& id) const;
 
     [[nodiscard]] std::string readResultContent(const JobId& id) const;
 };
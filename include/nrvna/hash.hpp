@@ -0,0 +1,44 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace nrvna {
+
+// SHA-256 for keys that content from job inputs decides, where a crafted
+// collision must not hand one job another job's cached data.
+class Sha256 final {
+public:
+    Sha256() noexcept;
+
+    void update(const void* data, std::size_t size) noexcept;
+    // Lowercase hex of the digest. Call once.
+    [[nodiscard]] std::string hexDigest() noexcept;
+
+private:
+    void block(const uint8_t* data) noexcept;
+
+    std::array<uint32_t, 8> state_;
+    std::array<uint8_t, 64> buffer_{};
+    std::size_t buffered_ = 0;
+    uint64_t length_ = 0;
+};
+
+[[nodiscard]] std::string sha256Hex(const std::string& data) noexcept;
+
+// FNV-1a, for in-memory tables and file names whose full key is compared
+// after the lookup. Pass a previous result as hash to continue it.
+constexpr uint64_t kFnvOffset = 1469598103934665603ull;
+constexpr uint64_t kFnvPrime = 1099511628211ull;
+[[nodiscard]] uint64_t fnv1a(const void* data, std::size_t size, uint64_t hash = kFnvOffset) noexcept;
+
+// value as 16 lowercase hex digits.
+[[nodiscard]] std::string hex64(uint64_t value);
+
+}
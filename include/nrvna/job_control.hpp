@@ -0,0 +1,47 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace nrvna {
+
+// Stop conditions of one running job: a cancel file in its directory and an
+// optional deadline. Decode loops poll it between steps; ggml polls it
+// through abortCallback while a long prefill runs on the compute threads.
+class JobControl final {
+public:
+    // timeoutSeconds <= 0 means no deadline. The deadline counts from construction.
+    JobControl(std::filesystem::path cancelFile, double timeoutSeconds) noexcept;
+
+    JobControl(const JobControl&) = delete;
+    JobControl& operator=(const JobControl&) = delete;
+
+    // True once the job is cancelled or past its deadline, and from then on.
+    // Cheap enough per token: the cancel file is checked at most every 50ms.
+    [[nodiscard]] bool stopRequested() noexcept;
+    // Error recorded for a stopped job.
+    [[nodiscard]] std::string reason() const;
+
+    // ggml_abort_callback adapter; data is a JobControl*.
+    static bool abortCallback(void* data) noexcept;
+
+private:
+    enum State : int { kRunning, kCancelled, kExpired };
+
+    bool stop(State state) noexcept;
+
+    std::filesystem::path cancelFile_;
+    double timeout_;
+    std::chrono::steady_clock::time_point deadline_;
+    std::atomic<int> state_{kRunning};
+    std::atomic<int64_t> nextPoll_{0};  // steady_clock ticks
+};
+
+}
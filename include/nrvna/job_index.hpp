@@ -0,0 +1,133 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "nrvna/meta.hpp"
+#include "nrvna/types.hpp"
+
+namespace nrvna {
+
+// One journal line: a job entering a state. Missing means it was removed.
+struct JournalRecord {
+    JobId id;
+    Status state = Status::Missing;
+    int64_t time_us = 0;
+    JobId parent;
+    std::vector<std::string> tags;
+};
+
+namespace journal {
+
+// Append a transition to the workspace journal, after the rename that made
+// it. Best effort: the index built from the journal is advisory, and
+// nrvnad rebuilds it from the state directories when it is lost. meta
+// supplies tags and parent; pass it whenever the caller has it.
+bool append(const std::filesystem::path& workspace, const JobId& id, Status state,
+            const std::optional<JobMeta>& meta = std::nullopt) noexcept;
+
+[[nodiscard]] std::string format(const JournalRecord& record);
+[[nodiscard]] std::optional<JournalRecord> parse(const std::string& line);
+
+}
+
+// A workspace's jobs by ID, tag, parent, and time of their last
+// transition: the snapshot nrvnad writes, plus the journal after it.
+// Terminal states are final. Queued and running entries can lag a
+// transition whose journal line was lost, so readers confirm those against
+// the state directories. Not thread-safe.
+class JobIndex final {
+public:
+    struct Entry {
+        Status state = Status::Missing;
+        int64_t time_us = 0;
+        JobId parent;
+        std::vector<std::string> tags;
+    };
+
+    explicit JobIndex(std::filesystem::path workspace) noexcept;
+
+    // Read the snapshot and the journal after it. False without a usable
+    // snapshot; callers then scan the state directories.
+    [[nodiscard]] bool load();
+    // Apply journal lines appended since load(). True if any were.
+    bool refresh();
+    // Replace the index with the contents of the state directories and the
+    // archive, reading every job's meta.json. For a missing or damaged
+    // snapshot.
+    void rebuild();
+    // Write the snapshot. Past maxJournalBytes the journal is first folded
+    // into it and started afresh.
+    [[nodiscard]] bool save(std::uintmax_t maxJournalBytes);
+
+    void apply(const JournalRecord& record);
+
+    [[nodiscard]] const Entry* find(const JobId& id) const;
+    // IDs in ID (submission) order.
+    [[nodiscard]] std::vector<JobId> tagged(const std::string& tag) const;
+    [[nodiscard]] std::vector<JobId> children(const JobId& parent) const;
+    // The n jobs with the latest transitions, newest first.
+    [[nodiscard]] std::vector<JobId> recent(std::size_t n) const;
+    [[nodiscard]] std::size_t count(Status state) const noexcept;
+    [[nodiscard]] std::size_t size() const noexcept { return entries_.size(); }
+    [[nodiscard]] const std::unordered_map<JobId, Entry>& entries() const noexcept { return entries_; }
+
+private:
+    bool replay(uint64_t inode, uint64_t offset);
+    void unlink(const JobId& id, const Entry& entry);
+
+    std::filesystem::path workspace_;
+    std::unordered_map<JobId, Entry> entries_;
+    std::unordered_map<std::string, std::set<JobId>> byTag_;
+    std::unordered_map<JobId, std::set<JobId>> byParent_;
+    std::array<std::size_t, 5> counts_{};
+    int64_t generation_ = 0;      // changes when the journal restarts
+    uint64_t journalInode_ = 0;   // journal file the offset refers to
+    uint64_t journalOffset_ = 0;  // bytes of it applied
+};
+
+// Keeps the snapshot current for nrvnad. One low-priority thread loads it
+// (rebuilding it if needed), then folds new journal lines in and rewrites
+// it every interval when something changed.
+class IndexKeeper final {
+public:
+    IndexKeeper(std::filesystem::path workspace, std::chrono::seconds interval,
+                std::uintmax_t maxJournalBytes) noexcept;
+    ~IndexKeeper();
+
+    IndexKeeper(const IndexKeeper&) = delete;
+    IndexKeeper& operator=(const IndexKeeper&) = delete;
+
+    [[nodiscard]] bool start() noexcept;
+    // Saves once more, then joins the thread.
+    void stop() noexcept;
+
+private:
+    void loop();
+
+    JobIndex index_;
+    std::chrono::seconds interval_;
+    std::uintmax_t maxJournalBytes_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+}
@@ -0,0 +1,84 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "nrvna/prefix_cache.hpp"
+
+namespace nrvna {
+
+// On-disk tier of the prefix cache: one file per prefix under
+// <workspace>/.nrvnad.kv/<model-id>/, named by the token hash. Files are
+// written atomically and loaded lazily, so snapshots survive restarts.
+// saveAsync hands the write and the budget scan to the store's own writer
+// thread, so decode threads never wait on the disk.
+class KvSnapshotStore final {
+public:
+    // Starts the writer thread. Throws if dir cannot be made.
+    KvSnapshotStore(std::filesystem::path dir, std::size_t budgetBytes);
+    // Writes everything still queued, then joins the writer.
+    ~KvSnapshotStore();
+
+    KvSnapshotStore(const KvSnapshotStore&) = delete;
+    KvSnapshotStore& operator=(const KvSnapshotStore&) = delete;
+
+    // Stable identity of a model file: hash of its path, size and mtime.
+    [[nodiscard]] static std::string modelIdentity(const std::filesystem::path& modelPath);
+
+    [[nodiscard]] bool contains(uint64_t hash) const;
+    // Returns nullptr if the file is missing, corrupt, or holds other tokens.
+    [[nodiscard]] std::shared_ptr<const PrefixEntry> load(uint64_t hash, const std::vector<int32_t>& tokens,
+                                                          std::size_t length) noexcept;
+    // Writes on the calling thread.
+    bool save(uint64_t hash, const PrefixEntry& entry) noexcept;
+    // Queues the write. Dropped when kMaxPending writes are already waiting.
+    void saveAsync(uint64_t hash, std::shared_ptr<const PrefixEntry> entry) noexcept;
+    // Blocks until the queued writes are on disk.
+    void flush() noexcept;
+
+    static constexpr std::size_t kMaxPending = 8;
+
+    [[nodiscard]] const std::filesystem::path& directory() const noexcept { return dir_; }
+
+    // Snapshot file format, also used for per-job conversation state. Writes
+    // go through a temp file and a rename and record entry.model.
+    // tokensOnly skips the state bytes.
+    static bool writeFile(const std::filesystem::path& path, const PrefixEntry& entry) noexcept;
+    [[nodiscard]] static std::shared_ptr<PrefixEntry> readFile(const std::filesystem::path& path,
+                                                               bool tokensOnly = false) noexcept;
+
+private:
+    [[nodiscard]] std::filesystem::path pathFor(uint64_t hash) const;
+    bool store(uint64_t hash, const PrefixEntry& entry) noexcept;
+    // Remove oldest snapshots until the directory fits the budget.
+    void enforceBudget() noexcept;
+    void writerLoop();
+
+    std::filesystem::path dir_;
+    std::size_t budget_;
+    mutable std::mutex mutex_;
+    std::unordered_set<uint64_t> index_;
+
+    std::condition_variable wake_;
+    std::condition_variable drained_;
+    std::deque<uint64_t> queue_;
+    std::unordered_map<uint64_t, std::shared_ptr<const PrefixEntry>> pending_;  // queued or being written
+    bool stopping_ = false;
+    std::thread writer_;
+};
+
+}
@@ -18,6 +18,9 @@ inline constexpr const char* kLockFile  = ".nrvnad.lock";
 inline constexpr const char* kPidFile   = ".nrvnad.pid";
 inline constexpr const char* kReadyFile = ".nrvnad.ready";
 inline constexpr const char* kInfoFile  = ".nrvnad.info";
+inline constexpr const char* kKvDir     = ".nrvnad.kv";  // prefix KV snapshots, per model
+inline constexpr const char* kMediaDir  = ".nrvnad.media";  // image and audio encodings, per mmproj
+inline constexpr const char* kResultDir = ".nrvnad.results";  // cached job artifacts (NRVNA_RESULT_CACHE_MB)
 
 enum class DaemonState : uint8_t { NotRunning, Starting, Ready };
 
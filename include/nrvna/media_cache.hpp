@@ -0,0 +1,105 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace nrvna {
+
+// Encoded image and audio embeddings keyed by the SHA-256 of their source
+// file, so media seen again skips the encoder. Entries are evicted
+// least-recently-used once the memory budget is exceeded. With a directory
+// attached, entries are also written there by a writer thread and read back
+// on a memory miss; each file records its key, which is checked on load.
+// Thread-safe.
+class MediaCache final {
+public:
+    explicit MediaCache(std::size_t budgetBytes) noexcept;
+    // Writes everything still queued, then joins the writer.
+    ~MediaCache();
+
+    MediaCache(const MediaCache&) = delete;
+    MediaCache& operator=(const MediaCache&) = delete;
+
+    // Hex SHA-256 of a file's bytes; empty if it cannot be read.
+    [[nodiscard]] static std::string hashFile(const std::filesystem::path& path) noexcept;
+    // Key of the ordinal-th chunk encoded from a file (long audio spans several).
+    [[nodiscard]] static std::string chunkKey(const std::string& contentHash, std::size_t ordinal);
+
+    // hashFile(), remembered by the file's identity (device, inode, size,
+    // mtime). A rename keeps it, so a file hashed while its job was queued is
+    // not read again when the job runs.
+    [[nodiscard]] std::string contentHash(const std::filesystem::path& path);
+
+    // Spill entries to dir, one file per key, removing the oldest past
+    // diskBudgetBytes. Attach before workers start. Throws if dir cannot be
+    // made or the writer cannot start.
+    void attachDirectory(std::filesystem::path dir, std::size_t diskBudgetBytes);
+
+    // The cached embedding if it holds exactly floats values, else nullptr.
+    [[nodiscard]] std::shared_ptr<const std::vector<float>> lookup(const std::string& key, std::size_t floats);
+    // Keeps the entry in memory and queues its file write.
+    bool insert(const std::string& key, std::vector<float> embedding);
+    // Blocks until the queued writes are on disk.
+    void flush() noexcept;
+
+    [[nodiscard]] std::size_t bytes() const;
+    [[nodiscard]] std::size_t size() const;
+    [[nodiscard]] std::size_t budget() const noexcept { return budget_; }
+
+    static constexpr std::size_t kMaxPending = 32;
+
+private:
+    using Embedding = std::shared_ptr<const std::vector<float>>;
+    using Lru = std::list<std::string>;
+    struct Slot {
+        Embedding embedding;
+        Lru::iterator lru;
+    };
+
+    [[nodiscard]] std::filesystem::path pathFor(const std::string& key) const;
+    void storeLocked(const std::string& key, Embedding embedding);
+    Embedding readFile(const std::string& key, std::size_t floats) noexcept;
+    bool writeFile(const std::string& key, const std::vector<float>& embedding) noexcept;
+    void enforceDiskBudget() noexcept;
+    void writerLoop();
+
+    std::size_t budget_;
+    std::size_t bytes_ = 0;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Slot> entries_;
+    Lru lru_;  // front = most recently used
+
+    using FileIdentity = std::tuple<uint64_t, uint64_t, uint64_t, int64_t>;
+    std::mutex hashMutex_;
+    std::map<FileIdentity, std::string> hashes_;
+
+    std::filesystem::path dir_;
+    std::size_t diskBudget_ = 0;
+    std::mutex diskMutex_;
+    std::unordered_map<std::string, std::uintmax_t> onDisk_;  // key -> file size
+    std::uintmax_t diskBytes_ = 0;
+    std::condition_variable wake_;
+    std::condition_variable drained_;
+    std::deque<std::string> queue_;
+    std::unordered_map<std::string, Embedding> pending_;  // queued or being written
+    bool stopping_ = false;
+    std::thread writer_;
+};
+
+}
@@ -0,0 +1,87 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct llama_model;
+struct llama_context;
+struct mtmd_context;
+struct mtmd_input_chunk;
+struct mtmd_input_chunks;
+
+namespace nrvna {
+
+class MediaCache;
+
+struct MediaChunksDeleter {
+    void operator()(mtmd_input_chunks* chunks) const noexcept;
+};
+using MediaChunks = std::unique_ptr<mtmd_input_chunks, MediaChunksDeleter>;
+
+// Owns the daemon's single mtmd context and the thread that uses it. Workers
+// hand image and audio work to the encoder thread, which runs it with every
+// CPU thread, and decode the resulting embeddings into their own contexts.
+// The mtmd graph is not safe to run concurrently, so this replaces a lock
+// around per-worker contexts.
+class MediaEncoder final {
+public:
+    // ctx is owned from here on; model must outlive the encoder.
+    MediaEncoder(mtmd_context* ctx, std::shared_ptr<llama_model> model);
+    ~MediaEncoder();
+
+    MediaEncoder(const MediaEncoder&) = delete;
+    MediaEncoder& operator=(const MediaEncoder&) = delete;
+    MediaEncoder(MediaEncoder&&) = delete;
+    MediaEncoder& operator=(MediaEncoder&&) = delete;
+
+    [[nodiscard]] bool start() noexcept;
+    // Runs everything still queued, then joins the thread.
+    void stop() noexcept;
+
+    [[nodiscard]] bool supportsAudio() const noexcept { return audio_; }
+    // Reuse encodings of files seen before. Attach before workers start.
+    void attachCache(std::shared_ptr<MediaCache> cache) noexcept { cache_ = std::move(cache); }
+
+    // Load the files and tokenize prompt (with its media markers) against them.
+    // Returns null and sets error on failure.
+    [[nodiscard]] MediaChunks tokenize(const std::string& prompt,
+                                       const std::vector<std::filesystem::path>& files, bool audio,
+                                       std::string& error);
+    // Evaluate chunks from index first on into sequence 0 of ctx, continuing
+    // at n_past. Text chunks decode on the calling thread; media chunks are
+    // encoded on the encoder thread, or taken from the cache, then decoded here.
+    [[nodiscard]] bool eval(llama_context* ctx, const mtmd_input_chunks* chunks, std::size_t first,
+                            int32_t& n_past);
+
+private:
+    // Blocks until task has run on the encoder thread. False if stopped.
+    bool run(std::function<void(mtmd_context*)> task);
+    void loop();
+    [[nodiscard]] std::vector<float> encode(const mtmd_input_chunk* chunk, std::size_t floats);
+
+    std::shared_ptr<mtmd_context> ctx_;
+    std::shared_ptr<llama_model> model_;
+    bool audio_ = false;
+    std::shared_ptr<MediaCache> cache_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::function<void(mtmd_context*)>> queue_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+}
@@ -6,6 +6,7 @@
 #pragma once
 #include "nrvna/types.hpp"
 #include <filesystem>
+#include <map>
 #include <optional>
 #include <string>
 #include <vector>
@@ -19,6 +20,10 @@ struct JobMeta {
     JobId parent;               // empty if none
     std::vector<std::string> tags;
     std::string output_format;  // "json_schema" or "gbnf"; empty if unconstrained
+    std::string speculate;      // "off", "ngram", or "draft"; empty uses the daemon default
+    bool continuation = false;  // resumes the parent's conversation and keeps its own state
+    double timeout_s = 0.0;     // running-time limit; 0 uses the daemon default
+    std::string priority;       // "high", "normal", or "low"; empty is normal
     unsigned int recovery_attempts = 0;
 
     // Completion phase (written by Processor)
@@ -26,10 +31,14 @@ struct JobMeta {
     double duration_s = -1.0;   // negative = not yet completed
     std::vector<std::string> artifacts;
     std::string status;         // contract::toString(Status::Done|Failed)
+    std::map<std::string, double> metrics;  // per-job timings such as setup_s
+    JobId cached_from;          // job whose cached result this is; empty if computed
 };
 
 bool writeMetaJson(const std::filesystem::path& dir, const JobMeta& meta);
 std::optional<JobMeta> readMetaJson(const std::filesystem::path& dir);
+// The contents of a meta.json, such as one read from an archive segment.
+std::optional<JobMeta> parseMetaJson(const std::string& text);
 
 std::string formatTimestamp();
 std::string escapeJson(const std::string& s);
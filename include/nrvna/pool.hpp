@@ -8,20 +8,22 @@
 #include <condition_variable>
 #include <functional>
 #include <mutex>
-#include <queue>
-#include <unordered_set>
 #include <thread>
 #include <vector>
 
+#include "nrvna/scheduler.hpp"
 #include "nrvna/types.hpp"
 
 namespace nrvna {
 
 using JobProcessor = std::function<void(const JobId&, int workerId)>;
+using JobHint = std::function<void(const std::vector<JobId>&)>;
 
 class Pool {
 public:
-    explicit Pool(int workers) noexcept;
+    // mediaWorkers caps the workers running media-encoder jobs at once;
+    // the rest keep taking other work. 0 means no cap.
+    explicit Pool(int workers, SchedulerConfig config = {}, int mediaWorkers = 0) noexcept;
     ~Pool();
 
     Pool(const Pool&) = delete;
@@ -29,26 +31,36 @@ public:
     Pool(Pool&&) = delete;
     Pool& operator=(Pool&&) = delete;
 
+    // After each claim, hint receives up to jobs queued jobs in the order
+    // they will run, so their inputs can be read while the workers are busy.
+    // hint must not throw. Set before start().
+    void setLookahead(std::size_t jobs, JobHint hint) noexcept;
     [[nodiscard]] bool start(JobProcessor processor);
     void stop() noexcept;
-    [[nodiscard]] bool submit(const JobId& jobId) noexcept;
+    [[nodiscard]] bool submit(const JobId& jobId, const JobTraits& traits = {}) noexcept;
     
     [[nodiscard]] bool isRunning() const noexcept { return running_.load(); }
 
 private:
     void workerLoop(int workerId);
-    bool isJobInQueue(const JobId& jobId) const;
+    [[nodiscard]] bool mediaAllowed() const noexcept {
+        return mediaWorkers_ <= 0 || activeMedia_ < mediaWorkers_;
+    }
     
     int workers_;
+    int mediaWorkers_;
     JobProcessor processor_;
+    std::size_t lookahead_ = 0;
+    JobHint hint_;
     
     std::atomic<bool> running_{false};
     std::atomic<bool> shutdown_{false};
     
     mutable std::mutex queueMutex_;
     std::condition_variable jobAvailable_;
-    std::queue<JobId> jobQueue_;
-    std::unordered_set<JobId> enqueuedJobs_;
+    Scheduler scheduler_;
+    int activeMedia_ = 0;  // guarded by queueMutex_
+    int idle_ = 0;         // workers waiting for a job; guarded by queueMutex_
     
     std::vector<std::thread> workerThreads_;
 };
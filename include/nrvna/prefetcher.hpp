@@ -0,0 +1,70 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "nrvna/types.hpp"
+
+namespace nrvna {
+
+struct JobInputs;
+
+// Reads queued jobs' inputs ahead of the workers. The pool hints at the jobs
+// it will hand out next; one thread loads them from input/ready/, and the
+// worker that claims a job takes its inputs instead of reading them. Loaded
+// entries past capacity are dropped oldest first, so a hint for a job that
+// runs much later costs only the read.
+class Prefetcher final {
+public:
+    // Returns null when the job cannot be read ahead; the worker reads it.
+    using Loader = std::function<std::shared_ptr<const JobInputs>(const JobId&)>;
+
+    Prefetcher(Loader loader, std::size_t capacity) noexcept;
+    ~Prefetcher();
+
+    Prefetcher(const Prefetcher&) = delete;
+    Prefetcher& operator=(const Prefetcher&) = delete;
+    Prefetcher(Prefetcher&&) = delete;
+    Prefetcher& operator=(Prefetcher&&) = delete;
+
+    [[nodiscard]] bool start() noexcept;
+    // Drops whatever is still queued and joins the thread.
+    void stop() noexcept;
+
+    // Queue jobs that are not loaded or loading yet.
+    void hint(const std::vector<JobId>& ids);
+    // The job's inputs if they are loaded, removed from the prefetcher. A
+    // job still loading is abandoned and null is returned.
+    [[nodiscard]] std::shared_ptr<const JobInputs> take(const JobId& id);
+
+    [[nodiscard]] std::size_t size() const;
+
+private:
+    void loop();
+
+    Loader loader_;
+    std::size_t capacity_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<JobId> pending_;
+    std::unordered_set<JobId> known_;  // pending, loading, or loaded
+    std::unordered_map<JobId, std::shared_ptr<const JobInputs>> loaded_;
+    std::deque<JobId> order_;  // loaded_, oldest first
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+}
@@ -0,0 +1,83 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace nrvna {
+
+class KvSnapshotStore;
+
+// Serialized sequence state (llama_state_seq_get_data) for one token prefix.
+struct PrefixEntry {
+    std::vector<int32_t> tokens;
+    std::vector<uint8_t> state;
+    bool pinned = false;  // never evicted, such as the workspace system prompt
+    std::string model;    // KvSnapshotStore::modelIdentity of the producer, if recorded
+
+    [[nodiscard]] std::size_t bytes() const noexcept {
+        return state.size() + tokens.size() * sizeof(int32_t);
+    }
+};
+
+// Shared-prefix KV cache. Entries are keyed by a hash of their tokens and
+// evicted least-recently-used once the memory budget is exceeded. The cache
+// stores bytes only, so any worker context can restore an entry.
+class PrefixCache final {
+public:
+    explicit PrefixCache(std::size_t budgetBytes) noexcept;
+
+    PrefixCache(const PrefixCache&) = delete;
+    PrefixCache& operator=(const PrefixCache&) = delete;
+
+    [[nodiscard]] static uint64_t hashTokens(const int32_t* tokens, std::size_t count) noexcept;
+    [[nodiscard]] static uint64_t extendHash(uint64_t hash, const int32_t* tokens, std::size_t count) noexcept;
+
+    // Longest cached prefix of tokens among the candidate lengths, or nullptr.
+    [[nodiscard]] std::shared_ptr<const PrefixEntry> lookup(const std::vector<int32_t>& tokens,
+                                                            const std::vector<std::size_t>& lengths);
+    [[nodiscard]] bool contains(const std::vector<int32_t>& tokens, std::size_t length) const;
+    // persist=false keeps the entry in memory only, even with a store attached.
+    bool insert(std::vector<int32_t> tokens, std::vector<uint8_t> state, bool pinned = false,
+                bool persist = true);
+
+    // Count how often a prefix was seen. Prefixes are snapshotted on repeat.
+    unsigned noteSighting(const std::vector<int32_t>& tokens, std::size_t length);
+
+    [[nodiscard]] std::size_t bytes() const;
+    [[nodiscard]] std::size_t size() const;
+    [[nodiscard]] std::size_t budget() const noexcept { return budget_; }
+
+    // Back the cache with on-disk snapshots: inserts are queued with the
+    // store's writer and memory misses fall back to the store. Attach before
+    // workers start.
+    void attachStore(std::shared_ptr<KvSnapshotStore> store) noexcept { store_ = std::move(store); }
+
+private:
+    using Lru = std::list<uint64_t>;
+    struct Slot {
+        std::shared_ptr<const PrefixEntry> entry;
+        Lru::iterator lru;
+    };
+
+    void evictLocked();
+
+    std::size_t budget_;
+    std::size_t bytes_ = 0;
+    mutable std::mutex mutex_;
+    std::unordered_map<uint64_t, Slot> entries_;
+    Lru lru_;  // front = most recently used
+    std::unordered_map<uint64_t, unsigned> sightings_;
+    std::shared_ptr<KvSnapshotStore> store_;
+};
+
+}
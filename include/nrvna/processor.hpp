@@ -4,12 +4,15 @@
  * SPDX-License-Identifier: MIT
  */
 #pragma once
+#include <chrono>
 #include <filesystem>
+#include <map>
 #include <memory>
 #include <optional>
 #include <string>
 #include <vector>
 
+#include "nrvna/meta.hpp"
 #include "nrvna/types.hpp"
 #include <unordered_map>
 #include <mutex>
@@ -18,6 +21,16 @@ namespace nrvna {
 
 class Runner;
 class TtsRunner;
+class CostModel;
+class BatchEngine;
+class PrefixCache;
+class EmbedBatcher;
+class Finalizer;
+class MediaCache;
+class Prefetcher;
+class ResultCache;
+struct EmbedResult;
+struct ChatTurn;
 
 struct PromptReadResult {
     bool ok;
@@ -25,6 +38,17 @@ struct PromptReadResult {
     std::string error;
 };
 
+// A job's input files, read and checked. Paths point into the directory
+// they were read from.
+struct JobInputs {
+    PromptReadResult prompt{false, "", ""};
+    PromptReadResult grammar{true, "", ""};
+    std::optional<JobMeta> meta;
+    std::optional<JobType> type;
+    std::vector<std::filesystem::path> images;
+    std::vector<std::filesystem::path> audio;
+};
+
 enum class ProcessResult : uint8_t {
     Success,
     Failed,
@@ -37,8 +61,10 @@ public:
     explicit Processor(const std::filesystem::path& workspace,
                        const std::string& modelPath,
                        const std::string& mmprojPath = "",
-                       const std::string& vocoderPath = "");
-    
+                       const std::string& vocoderPath = "",
+                       const std::string& draftPath = "");
+    ~Processor();
+
     Processor(const Processor&) = delete;
     Processor& operator=(const Processor&) = delete;
     Processor(Processor&&) = delete;
@@ -47,37 +73,107 @@ public:
     // Pre-initialize runners for all worker threads (MUST be called before threads start)
     bool initializeRunners(int numWorkers);
     bool initializeTtsRunners(int numWorkers);
+    // Completed jobs report their service time here (MUST be set before threads start).
+    void setCostModel(std::shared_ptr<CostModel> costModel) { costModel_ = std::move(costModel); }
 
     [[nodiscard]] ProcessResult process(const JobId& jobId, int workerId) noexcept;
 
+    // Jobs each worker may have read ahead (NRVNA_PREFETCH); 0 disables it.
+    [[nodiscard]] std::size_t prefetchDepth() const noexcept { return prefetchDepth_; }
+    // Read these queued jobs' inputs before a worker claims them.
+    void prefetch(const std::vector<JobId>& jobIds) noexcept;
+
 private:
     std::filesystem::path workspace_;
     std::string modelPath_;
     std::string mmprojPath_;
     std::string vocoderPath_;
+    std::string draftPath_;
 
     // Per-thread Runner instances for Metal compatibility
     std::unordered_map<int, std::unique_ptr<Runner>> runners_;
     std::mutex runnersMutex_;
 
+    // Shared multi-sequence context for text jobs (NRVNA_BATCHING=1)
+    std::shared_ptr<BatchEngine> batchEngine_;
+
+    // Shared-prefix KV cache for all runners and the batching engine
+    std::shared_ptr<PrefixCache> prefixCache_;
+
+    // Coalesces text embedding jobs (NRVNA_EMBED_BATCH > 1)
+    std::unique_ptr<EmbedBatcher> embedBatcher_;
+
+    // Learns service times for shortest-job-first; may be null
+    std::shared_ptr<CostModel> costModel_;
+
     // Per-thread TTS Runner instances
     std::unordered_map<int, std::unique_ptr<TtsRunner>> ttsRunners_;
     std::mutex ttsRunnersMutex_;
-    
+
+    // A finished job's outcome, handed from the worker to publish().
+    struct Completion {
+        JobId jobId;
+        bool ok = false;
+        double elapsed = 0.0;
+        std::string artifact;                // file written on success (contract.hpp)
+        std::string text;                    // result or transcript; the error on failure
+        std::vector<float> values;           // embedding vector or audio samples
+        int sampleRate = 0;
+        std::optional<std::string> partial;  // output produced before a failure
+        std::map<std::string, double> metrics;
+        std::string detail;                  // note on the status line
+        std::string cacheKey;                // result cache key; empty if not cached
+        JobId cachedFrom;                    // job whose cached result this is
+    };
+
+    // Publishes completions off the worker threads (NRVNA_FINALIZE_THREADS > 0)
+    std::unique_ptr<Finalizer> finalizer_;
+
+    // Encodings of image and audio files; null without a projector
+    std::shared_ptr<MediaCache> mediaCache_;
+
+    // Artifacts of earlier identical jobs (NRVNA_RESULT_CACHE_MB > 0)
+    std::unique_ptr<ResultCache> resultCache_;
+    std::string resultKeyPrefix_;  // model, projector, and system prompt
+
+    // Reads queued jobs' inputs from input/ready/ (NRVNA_PREFETCH > 0)
+    std::size_t prefetchDepth_ = 0;
+    std::unique_ptr<Prefetcher> prefetcher_;
+
     [[nodiscard]] bool moveReadyToProcessing(const JobId& jobId) noexcept;
-    [[nodiscard]] bool finalizeSuccess(const JobId& jobId, const std::string& result) noexcept;
+    // Queue the completion for the finalizer, or publish it here without one.
+    ProcessResult finish(Completion completion) noexcept;
+    ProcessResult fail(const JobId& jobId, double elapsed, std::string error, std::string detail = "",
+                       std::optional<std::string> partial = std::nullopt) noexcept;
+    // Write the artifact, then meta.json once, then move the job to output/
+    // (or failed/ if a write fails). A crash before the move leaves the job
+    // in processing/ for recovery.
+    void publish(Completion& completion) noexcept;
+    [[nodiscard]] bool writeArtifact(const Completion& completion) const noexcept;
     [[nodiscard]] bool finalizeFailure(const JobId& jobId, const std::string& error,
                                        std::optional<std::string> partialOutput = std::nullopt) noexcept;
     
-    [[nodiscard]] PromptReadResult readPrompt(const JobId& jobId) const noexcept;
-    [[nodiscard]] PromptReadResult readGrammar(const JobId& jobId) const noexcept;
-    [[nodiscard]] std::optional<JobType> readJobType(const JobId& jobId) const noexcept;
-    [[nodiscard]] std::vector<std::filesystem::path> readImages(const JobId& jobId) const noexcept;
-    [[nodiscard]] std::vector<std::filesystem::path> readAudio(const JobId& jobId) const noexcept;
+    // Inputs of the job in jobDir. Claimed jobs are read from processing/;
+    // the prefetcher reads queued ones from input/ready/, whose files no
+    // longer change.
+    [[nodiscard]] JobInputs readInputs(const std::filesystem::path& jobDir) const noexcept;
+    // Prefetcher loader: the job's inputs, or null if any are unusable.
+    [[nodiscard]] std::shared_ptr<const JobInputs> readAhead(const JobId& jobId) const noexcept;
+    [[nodiscard]] PromptReadResult readPrompt(const std::filesystem::path& jobDir) const noexcept;
+    [[nodiscard]] PromptReadResult readGrammar(const std::filesystem::path& jobDir) const noexcept;
+    // Turns of the conversation ending at parent (oldest first), read from output/.
+    [[nodiscard]] bool readConversation(const JobId& parent, std::vector<ChatTurn>& turns,
+                                        std::string& error) const noexcept;
+    // Contents of <workspace>/system.txt, or empty when absent.
+    [[nodiscard]] std::string readSystemPrompt() const noexcept;
+    [[nodiscard]] std::optional<JobType> readJobType(const std::filesystem::path& jobDir) const noexcept;
+    [[nodiscard]] std::vector<std::filesystem::path> readImages(const std::filesystem::path& jobDir) const noexcept;
+    [[nodiscard]] std::vector<std::filesystem::path> readAudio(const std::filesystem::path& jobDir) const noexcept;
     [[nodiscard]] std::filesystem::path getJobPath(const char* phase, const JobId& jobId) const noexcept;
-    [[nodiscard]] bool finalizeEmbedding(const JobId& jobId, const std::vector<float>& embedding) noexcept;
-    [[nodiscard]] bool finalizeTranscript(const JobId& jobId, const std::string& transcript) noexcept;
-    [[nodiscard]] bool finalizeAudio(const JobId& jobId, const std::vector<float>& audio, int sampleRate) noexcept;
+    ProcessResult completeEmbedding(const JobId& jobId, std::chrono::steady_clock::time_point startTime,
+                                    const EmbedResult& embedResult, std::string cacheKey = "") noexcept;
+    // The job's result cache key, or empty if its result is not reproducible.
+    [[nodiscard]] std::string resultKey(JobType type, const JobInputs& inputs) const;
 
     // Metal-compatible per-thread Runner management
     Runner* getRunnerForWorker(int workerId);
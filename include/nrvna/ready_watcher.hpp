@@ -0,0 +1,44 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace nrvna {
+
+struct WatchEvents {
+    std::vector<std::string> arrived;  // entries renamed or created in the directory
+    bool rescan = false;               // the names are unknown or events were lost
+};
+
+// Wakes the scanner when jobs are published into input/ready/. Uses inotify
+// on Linux and kqueue on macOS; elsewhere it is inactive and the server
+// keeps polling.
+class ReadyWatcher final {
+public:
+    explicit ReadyWatcher(const std::filesystem::path& readyDir) noexcept;
+    ~ReadyWatcher();
+
+    ReadyWatcher(const ReadyWatcher&) = delete;
+    ReadyWatcher& operator=(const ReadyWatcher&) = delete;
+
+    [[nodiscard]] bool active() const noexcept { return watchFd_ >= 0; }
+
+    // Block until the directory changes, wake() is called, or timeout passes.
+    [[nodiscard]] WatchEvents wait(std::chrono::milliseconds timeout) noexcept;
+    // Interrupt a blocked wait(), such as for shutdown. Safe from any thread.
+    void wake() noexcept;
+
+private:
+    int watchFd_ = -1;   // inotify instance or kqueue
+    int dirFd_ = -1;     // watched directory (kqueue only)
+    int wakeRead_ = -1;
+    int wakeWrite_ = -1;
+};
+
+}
@@ -0,0 +1,68 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "nrvna/types.hpp"
+
+namespace nrvna {
+
+// Finished jobs' artifacts keyed by everything that decides them: model,
+// type, prompt, attachments, grammar, and sampling settings. A job whose
+// key was seen before is answered from here without a model. One file per
+// entry, named by the key's hash and holding the key itself, so a hash
+// collision is a miss. The least recently used entries are removed past the
+// budget; a hit touches the file, so the order survives restarts.
+// Thread-safe.
+class ResultCache final {
+public:
+    struct Entry {
+        JobId source;               // job that computed it
+        std::string artifact;       // contract.hpp file name
+        std::string text;           // result or transcript
+        std::vector<float> values;  // embedding vector
+    };
+
+    // Throws if dir cannot be made.
+    ResultCache(std::filesystem::path dir, std::size_t budgetBytes);
+
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    [[nodiscard]] std::optional<Entry> lookup(const std::string& key) noexcept;
+    bool insert(const std::string& key, const Entry& entry) noexcept;
+
+    [[nodiscard]] std::size_t bytes() const;
+    [[nodiscard]] std::size_t size() const;
+
+private:
+    using Lru = std::list<uint64_t>;
+    struct Slot {
+        std::uintmax_t bytes = 0;
+        Lru::iterator lru;
+    };
+
+    [[nodiscard]] std::filesystem::path pathFor(uint64_t hash) const;
+    void storeLocked(uint64_t hash, std::uintmax_t bytes);
+    void forgetLocked(uint64_t hash);
+
+    std::filesystem::path dir_;
+    std::size_t budget_;
+    std::uintmax_t bytes_ = 0;
+    mutable std::mutex mutex_;
+    std::unordered_map<uint64_t, Slot> entries_;
+    Lru lru_;  // front = most recently used
+};
+
+}
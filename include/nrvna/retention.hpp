@@ -0,0 +1,99 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "nrvna/archive.hpp"
+#include "nrvna/job_index.hpp"
+#include "nrvna/types.hpp"
+
+namespace nrvna {
+
+// How long finished jobs are kept. Zero means no limit.
+struct RetentionPolicy {
+    std::chrono::seconds maxAge{0};       // Done and Failed jobs
+    std::size_t maxCount = 0;             // newest finished jobs kept
+    std::chrono::seconds keepFailed{0};   // Failed jobs; replaces maxAge for them
+    // Per tag; replaces the limits above for a job with the tag. The
+    // shortest of a job's tags applies.
+    std::unordered_map<std::string, std::chrono::seconds> tagTtl;
+
+    [[nodiscard]] bool empty() const noexcept {
+        return maxAge.count() == 0 && maxCount == 0 && keepFailed.count() == 0 && tagTtl.empty();
+    }
+};
+
+// Reads the "retention" section of the workspace's nrvna.json. A missing file
+// or section gives an empty policy; a malformed one gives nullopt.
+std::optional<RetentionPolicy> loadRetentionPolicy(const std::filesystem::path& workspace);
+
+// Finished jobs the policy no longer keeps, oldest first. A job whose
+// children are still queued or running is kept until they finish, since
+// they read its turns.
+std::vector<JobId> expiredJobs(const JobIndex& index, const RetentionPolicy& policy, int64_t now_us);
+
+// Totals since the workspace's first collection, kept in .nrvna.gc.
+struct ReclaimStats {
+    uint64_t jobs = 0;
+    uint64_t bytes = 0;
+    uint64_t inodes = 0;
+    std::string last_run;  // ISO 8601, like meta.json timestamps
+};
+
+[[nodiscard]] std::optional<ReclaimStats> readReclaimStats(const std::filesystem::path& workspace) noexcept;
+
+// Deletes expired jobs for nrvnad: from output/ and failed/, and from the
+// archive, whose segments go once nothing in them is kept. One thread at
+// idle CPU and I/O priority removes at most batchSize jobs, then sleeps for
+// pause, so inference keeps the disk. Reads the job index; until nrvnad has
+// written one, passes do nothing.
+class GarbageCollector final {
+public:
+    GarbageCollector(std::filesystem::path workspace, RetentionPolicy policy,
+                     std::chrono::seconds interval, std::size_t batchSize,
+                     std::chrono::milliseconds pause) noexcept;
+    ~GarbageCollector();
+
+    GarbageCollector(const GarbageCollector&) = delete;
+    GarbageCollector& operator=(const GarbageCollector&) = delete;
+
+    [[nodiscard]] bool start() noexcept;
+    void stop() noexcept;
+
+    // One pass, on the caller. Returns what it reclaimed.
+    ReclaimStats collect();
+
+private:
+    void loop();
+    // Waits out the pause between batches. False once stopping.
+    bool rest();
+
+    std::filesystem::path workspace_;
+    RetentionPolicy policy_;
+    std::chrono::seconds interval_;
+    std::size_t batchSize_;
+    std::chrono::milliseconds pause_;
+    JobIndex index_;
+    Archive archive_;
+    bool loaded_ = false;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+}
@@ -7,22 +7,32 @@
 #include <atomic>
 #include <cstdint>
 #include <filesystem>
+#include <functional>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <vector>
 
+#include "nrvna/types.hpp"
+
 struct llama_model;
 struct llama_context;
 struct llama_context_params;
 struct llama_sampler;
 struct llama_vocab;
-struct mtmd_context;
-struct mtmd_bitmap;
+struct mtmd_input_chunks;
 struct common_chat_templates;
 
 namespace nrvna {
 
+class BatchEngine;
+class MediaCache;
+class MediaEncoder;
+class PrefixCache;
+class Drafter;
+class JobControl;
+
 struct ModelInfo {
     bool        valid = false;
     std::string desc;                 // llama_model_desc() for display only
@@ -39,21 +49,47 @@ struct RunResult {
     bool ok = false;
     std::string output;
     std::string error;
+    std::map<std::string, double> metrics;  // recorded in meta.json, e.g. setup_s
+
+    RunResult() = default;
+    RunResult(bool ok_, std::string output_, std::string error_)
+        : ok(ok_), output(std::move(output_)), error(std::move(error_)) {}
+};
+
+// Receives generated text in order while a job runs.
+using TextSink = std::function<void(const std::string& text)>;
+
+struct ChatTurn {
+    std::string user;
+    std::string assistant;
 };
 
 struct GenerationOptions {
     std::string grammar;
+    std::string speculate;  // "off", "ngram", or "draft"; empty uses NRVNA_SPECULATE
+    // Conversation continuation (text only): earlier turns, oldest first.
+    std::vector<ChatTurn> history;
+    std::filesystem::path resumeState;  // parent's final KV state, if it kept one
+    std::filesystem::path saveState;    // where to keep this job's final KV state
+    TextSink onText;                    // raw generated text, flushed periodically
+    JobControl* control = nullptr;      // cancellation and deadline; may be null
 };
 
 struct EmbedResult {
     bool ok = false;
     std::vector<float> embedding;
     std::string error;
+    std::map<std::string, double> metrics;
+
+    EmbedResult() = default;
+    EmbedResult(bool ok_, std::vector<float> embedding_, std::string error_)
+        : ok(ok_), embedding(std::move(embedding_)), error(std::move(error_)) {}
 };
 
 class Runner final {
 public:
-    explicit Runner(const std::string& modelPath, const std::string& mmprojPath, int numWorkers = 1);
+    // Runners given the same mmproj share one MediaEncoder.
+    explicit Runner(const std::string& modelPath, const std::string& mmprojPath);
     ~Runner();
 
     Runner(const Runner&) = delete;
@@ -64,12 +100,41 @@ public:
     [[nodiscard]] RunResult run(const std::string& prompt, const GenerationOptions& options = {});
     [[nodiscard]] RunResult run(const std::string& prompt, const std::vector<std::filesystem::path>& imagePaths,
                                 const GenerationOptions& options = {});
-    [[nodiscard]] RunResult transcribe(const std::string& prompt, const std::vector<std::filesystem::path>& audioPaths);
+    [[nodiscard]] RunResult transcribe(const std::string& prompt, const std::vector<std::filesystem::path>& audioPaths,
+                                       JobControl* control = nullptr);
     [[nodiscard]] EmbedResult embed(const std::string& text);
+    // Embed several texts with one decode per group, one sequence per text.
+    // Results line up with texts; each fails or succeeds on its own.
+    [[nodiscard]] std::vector<EmbedResult> embedBatch(const std::vector<std::string>& texts);
     [[nodiscard]] EmbedResult embedVision(const std::string& prompt, const std::vector<std::filesystem::path>& imagePaths);
     // Load the model briefly to read GGUF metadata without starting a server.
     [[nodiscard]] static ModelInfo probeModelInfo(const std::string& modelPath);
 
+    // Continuous batching: text jobs become sequences in one shared context.
+    // Call after the model is loaded. Returns nullptr if the context fails.
+    [[nodiscard]] static std::shared_ptr<BatchEngine> createBatchEngine(int maxSequences);
+    void attachBatchEngine(std::shared_ptr<BatchEngine> engine) noexcept { batch_engine_ = std::move(engine); }
+
+    // The sampling settings a job of this type decodes with, as a stable
+    // string; empty when it samples from a random seed. Vision covers any
+    // generation with images. Call after the model is loaded.
+    [[nodiscard]] static std::string samplingFingerprint(JobType type);
+
+    // Default speculation mode: NRVNA_SPECULATE, else "draft" with a draft model, else "off".
+    [[nodiscard]] static std::string defaultSpeculation();
+    // Speculative decoding: load a small draft model with the same vocabulary.
+    // Call after the main model is loaded. Returns false if it is unusable.
+    [[nodiscard]] static bool loadDraftModel(const std::string& draftPath);
+
+    // Shared-prefix KV cache: repeated prompt prefixes are restored instead of prefilled.
+    void attachPrefixCache(std::shared_ptr<PrefixCache> cache) noexcept { prefix_cache_ = std::move(cache); }
+    // Content-addressed cache of image and audio encodings, shared through the media encoder.
+    void attachMediaCache(std::shared_ptr<MediaCache> cache) noexcept;
+    // Workspace system prompt for text and vision jobs. Set before workers start.
+    static void setSystemPrompt(std::string prompt);
+    // Prefill the chat template head (system prompt included) once and pin it in the cache.
+    bool warmPrefixCache() noexcept;
+
 private:
     struct SamplingConfig {
         int n_predict = 0;
@@ -83,10 +148,20 @@ private:
         uint32_t seed = 0;
     };
 
-    // Shared model (thread-safe), per-worker mtmd context (not thread-safe)
+    struct DecodeStats {
+        int generated = 0;
+        int drafted = 0;
+        int accepted = 0;
+        double seconds = 0.0;
+        int32_t n_past = 0;  // tokens in KV memory when generation stopped
+    };
+
+    // Shared model (thread-safe); the mtmd context lives in the shared MediaEncoder
     static std::shared_ptr<llama_model> shared_model_;
     static std::string current_model_path_;
+    static std::string current_model_identity_;  // recorded in state.kv
     static std::mutex model_mutex_;
+    static std::shared_ptr<llama_model> draft_model_;
 
     // Resolve GGUF sampling defaults once. env_*() uses them as fallbacks.
     // If GGUF has no value, these hold the hardcoded defaults.
@@ -97,27 +172,80 @@ private:
     static float gguf_repeat_penalty_;
     static int   gguf_repeat_last_n_;
 
-    // Per-instance mtmd context for thread-safe vision processing
-    std::shared_ptr<mtmd_context> mtmd_owned_;
-    std::string mmproj_path_;
+    // Held by every Runner with an mmproj; the encoder stops when the last one goes.
+    static std::weak_ptr<MediaEncoder> shared_media_;
+    static std::string media_path_;
 
     [[nodiscard]] bool initializeModel(const std::string& modelPath) noexcept;
     void cleanup() noexcept;
-    std::string formatPrompt(const std::string& content);
-    std::string formatMultimodalPrompt(const std::string& prompt, size_t imageCount, const char* marker);
-    SamplingConfig buildSamplingConfig() const;
+    std::string formatPrompt(const std::string& content, const std::vector<ChatTurn>& history = {});
+    std::string formatMultimodalPrompt(const std::string& prompt, size_t imageCount, const char* marker,
+                                       bool withSystemPrompt = false);
+    std::vector<int32_t> tokenize(const std::string& text) const;
+    // Tokens every formatted prompt starts with: BOS, system prompt and the user turn opener.
+    std::vector<int32_t> templateHead();
+    // Candidate prefix lengths (template head, then every NRVNA_PREFIX_BLOCK tokens) up to limit.
+    std::vector<size_t> prefixBoundaries(const std::vector<int32_t>& tokens, size_t limit);
+    // Restore the longest cached prefix into sequence 0; returns the tokens covered.
+    size_t restorePrefix(llama_context* ctx, const std::vector<int32_t>& tokens, const std::vector<size_t>& bounds);
+    // Length to snapshot after prefill (0 = none): the longest boundary seen before.
+    size_t chooseSnapshot(const std::vector<int32_t>& tokens, const std::vector<size_t>& bounds, size_t reused);
+    void savePrefix(llama_context* ctx, const std::vector<int32_t>& tokens, size_t length, bool pinned = false);
+    // Load a parent conversation's KV state when it covers more than reused tokens.
+    size_t resumeConversation(llama_context* ctx, const std::vector<int32_t>& tokens,
+                              const std::filesystem::path& statePath, size_t reused);
+    // Write the first length tokens' KV state to path and keep it resident for the next turn.
+    void saveConversation(llama_context* ctx, std::vector<int32_t> tokens, size_t length,
+                          const std::filesystem::path& path);
+    // Evaluate every chunk, with the leading text chunk served from the prefix cache.
+    bool evalMediaChunks(llama_context* ctx, mtmd_input_chunks* chunks, int32_t& n_past, size_t& reused);
+    // Sampling settings from GGUF defaults and the environment, with the
+    // vision and speech-to-text overrides. buildSamplingConfig also logs them.
+    static SamplingConfig samplingConfig(JobType type);
+    SamplingConfig buildSamplingConfig(JobType type = JobType::Text) const;
     void buildContextParams(int n_prompt, const SamplingConfig& config, llama_context_params& params) const;
     llama_sampler* buildSampler(const SamplingConfig& config, const llama_vocab* vocab,
                                 const std::string& grammar) const;
+    // Reuse a pooled context of the same size class, or create one. The KV
+    // memory of a reused context is cleared before it is returned.
+    std::shared_ptr<llama_context> acquireContext(llama_context_params params);
+    // Grammar-free sampler chains are reused after llama_sampler_reset().
+    std::shared_ptr<llama_sampler> acquireSampler(const SamplingConfig& config, const llama_vocab* vocab,
+                                                  const std::string& grammar);
+    // This worker's drafter for the job's speculation mode, or nullptr to decode plainly.
+    Drafter* acquireDrafter(const GenerationOptions& options, int max_ctx);
+    // Sample from the logits left by prefill, then decode until EOG or n_predict.
+    // With a drafter, each step verifies the proposed tokens in one decode.
+    // history holds the tokens decoded so far and receives the generated ones.
+    // A stopped control ends generation with its reason as the error.
+    bool generateTokens(llama_context* ctx, llama_sampler* smpl, int32_t n_past, int n_predict,
+                        Drafter* drafter, const TextSink& onText, JobControl* control,
+                        std::vector<int32_t>& history,
+                        std::string& output, std::string& error, DecodeStats& stats);
     RunResult runText(const std::string& prompt, const GenerationOptions& options);
     RunResult runVision(const std::string& prompt, const std::vector<std::filesystem::path>& imagePaths,
                         const GenerationOptions& options);
-    RunResult runStt(const std::string& prompt, const std::vector<std::filesystem::path>& audioPaths);
-    std::vector<mtmd_bitmap*> loadImages(const std::vector<std::filesystem::path>& imagePaths) const;
-    std::vector<mtmd_bitmap*> loadAudio(const std::vector<std::filesystem::path>& audioPaths) const;
-    void freeBitmaps(std::vector<mtmd_bitmap*>& bitmaps) const noexcept;
-
-    mtmd_context* mtmd_ctx_ = nullptr;
+    RunResult runStt(const std::string& prompt, const std::vector<std::filesystem::path>& audioPaths,
+                     JobControl* control);
+
+    std::shared_ptr<MediaEncoder> media_;
+
+    // Per-worker reusable contexts (bucketed by n_ctx) and sampler chains
+    std::map<std::string, std::shared_ptr<llama_context>> context_pool_;
+    std::vector<std::string> context_lru_;
+    std::map<std::string, std::shared_ptr<llama_sampler>> sampler_pool_;
+    std::unique_ptr<Drafter> model_drafter_;  // owns this worker's draft-model context
+    std::unique_ptr<Drafter> ngram_drafter_;
+    int draft_ctx_n_ = 0;
+
+    // Shared by all workers when NRVNA_BATCHING is enabled
+    std::shared_ptr<BatchEngine> batch_engine_;
+    std::shared_ptr<PrefixCache> prefix_cache_;
+
+    static std::string system_prompt_;
+    static std::vector<int32_t> template_head_;
+    static bool template_head_ready_;
+    static std::mutex template_head_mutex_;
 
     // Shared chat templates (initialized once at model load, like shared_model_)
     static common_chat_templates* chat_templates_;
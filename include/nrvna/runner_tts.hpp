@@ -13,6 +13,8 @@ struct llama_model;
 
 namespace nrvna {
 
+class JobControl;
+
 enum class TtsVersion { V0_2, V0_3 };
 
 struct TtsResult {
@@ -32,7 +34,8 @@ public:
     TtsRunner(TtsRunner&&) = delete;
     TtsRunner& operator=(TtsRunner&&) = delete;
 
-    [[nodiscard]] TtsResult run(const std::string& text);
+    // control, when given, stops code generation on cancellation or deadline.
+    [[nodiscard]] TtsResult run(const std::string& text, JobControl* control = nullptr);
 
 private:
     static std::shared_ptr<llama_model> shared_tts_model_;
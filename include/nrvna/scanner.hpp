@@ -4,13 +4,26 @@
  * SPDX-License-Identifier: MIT
  */
 #pragma once
+#include <cstdint>
 #include <filesystem>
+#include <unordered_map>
 #include <vector>
 
+#include "nrvna/cost_model.hpp"
+#include "nrvna/scheduler.hpp"
 #include "nrvna/types.hpp"
 
 namespace nrvna {
 
+// Changes to input/ready/ since the previous scan, each sorted by job ID.
+struct ScanDelta {
+    std::vector<JobId> added;
+    std::vector<JobId> removed;
+};
+
+// Lists the jobs in input/ready/. Validated entries are cached by inode, so
+// a rescan reads only directory entries (readdir with d_type) and validates
+// new arrivals. An unchanged directory is not read at all.
 class Scanner {
 public:
     explicit Scanner(const std::filesystem::path& workspace) noexcept;
@@ -20,13 +33,48 @@ public:
     Scanner(Scanner&&) noexcept = default;
     Scanner& operator=(Scanner&&) noexcept = default;
 
-    [[nodiscard]] std::vector<JobId> scan() const noexcept;
-    [[nodiscard]] std::size_t readyJobCount() const noexcept;
+    // Every ready job, sorted by ID.
+    [[nodiscard]] std::vector<JobId> scan() noexcept;
+    // Jobs that appeared or left since the previous scan or scanDelta.
+    [[nodiscard]] ScanDelta scanDelta() noexcept;
+    [[nodiscard]] std::size_t readyJobCount() noexcept;
+    // Whether one entry of input/ready/ is a valid job, without a full scan.
+    [[nodiscard]] bool isReady(const std::string& name) const noexcept;
+    // Whether the last scan listed the job. Reads only the cache.
+    [[nodiscard]] bool listed(const JobId& id) const noexcept;
+    // Scheduling traits from the job's directory, read once per listed job.
+    // The cost is left at zero without a model.
+    [[nodiscard]] JobTraits traits(const JobId& id, const CostModel* costs = nullptr) noexcept;
 
 private:
+    struct Entry {
+        uint64_t inode = 0;
+        uint64_t pass = 0;  // last refresh that saw the entry
+        bool valid = false;
+        bool traitsKnown = false;
+        JobTraits traits;
+    };
+    struct DirStamp {
+        uint64_t device = 0;
+        uint64_t inode = 0;
+        int64_t mtimeNs = -1;
+        bool operator==(const DirStamp& other) const noexcept {
+            return device == other.device && inode == other.inode && mtimeNs == other.mtimeNs;
+        }
+    };
+
     std::filesystem::path workspace_;
     std::filesystem::path readyPath_;
+    std::uintmax_t maxPromptBytes_;
+    std::unordered_map<JobId, Entry> entries_;
+    std::size_t validCount_ = 0;
+    std::size_t invalidCount_ = 0;
+    uint64_t pass_ = 0;
+    DirStamp stamp_;
+    bool stampSettled_ = false;  // stamp_ is old enough to trust an unchanged mtime
     
+    // Bring the cache up to date; appends changes to delta when given.
+    void refresh(ScanDelta* delta) noexcept;
     [[nodiscard]] bool isValidJobDirectory(const std::filesystem::path& dir) const noexcept;
     [[nodiscard]] JobId extractJobId(const std::filesystem::path& dir) const noexcept;
 };
@@ -0,0 +1,115 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "nrvna/meta.hpp"
+#include "nrvna/types.hpp"
+
+namespace nrvna {
+
+// What the scheduler knows about a queued job, read from its meta.json.
+struct JobTraits {
+    Priority priority = Priority::Normal;
+    std::string group;  // fair-share group; see fairShareGroup()
+    double cost = 0.0;  // estimated service seconds (CostModel)
+    bool media = false;  // needs the shared media encoder: vision, image embedding, speech-to-text
+};
+
+struct ScheduledJob {
+    JobId id;
+    bool media = false;
+};
+
+// The job's first tag, else "parent:<id>", else "" (the shared default group).
+std::string fairShareGroup(const JobMeta& meta);
+JobTraits jobTraits(const JobMeta& meta);
+
+struct SchedulerConfig {
+    std::chrono::steady_clock::duration aging = std::chrono::seconds(60);
+    std::unordered_map<std::string, double> weights;  // group -> jobs per round; default 1
+    // A job queued this long runs in arrival order, ahead of cheaper jobs of
+    // its group. Zero disables shortest-job-first.
+    std::chrono::steady_clock::duration shortestFirstWait = std::chrono::seconds(300);
+};
+
+// Reads the "scheduler" section of the workspace's nrvna.json. A missing file
+// gives the defaults; a malformed one gives nullopt.
+std::optional<SchedulerConfig> loadSchedulerConfig(const std::filesystem::path& workspace);
+
+// Orders queued jobs for the pool. Lanes are strict: the highest non-empty
+// lane runs next. A job is treated as one lane higher for each full aging
+// interval it has waited, so low lanes are never starved. Within a lane,
+// groups share workers by deficit round robin in proportion to their
+// weights, and each group runs its cheapest job first until one has waited
+// shortestFirstWait. Media-encoder jobs queue apart so a caller at its
+// encoder limit can still take other work.
+// Not thread-safe; Pool guards it with its queue mutex.
+class Scheduler final {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit Scheduler(SchedulerConfig config = {}) noexcept;
+
+    // False if the job is already queued.
+    bool push(const JobId& id, const JobTraits& traits = {}, Clock::time_point now = Clock::now());
+    // allowMedia false skips jobs that need the media encoder.
+    [[nodiscard]] std::optional<ScheduledJob> pop(Clock::time_point now = Clock::now(),
+                                                  bool allowMedia = true);
+    // About the next n jobs pop() would return at now, without taking them
+    // or copying the queue. Costs O(n) per group walked, so keep n small.
+    [[nodiscard]] std::vector<JobId> upcoming(std::size_t n, Clock::time_point now = Clock::now()) const;
+    [[nodiscard]] bool runnable(bool allowMedia) const noexcept {
+        return allowMedia ? !queued_.empty() : queued_.size() > mediaQueued_;
+    }
+
+    [[nodiscard]] bool contains(const JobId& id) const noexcept { return queued_.count(id) > 0; }
+    [[nodiscard]] bool empty() const noexcept { return queued_.empty(); }
+    [[nodiscard]] std::size_t size() const noexcept { return queued_.size(); }
+    void clear() noexcept;
+
+private:
+    static constexpr std::size_t kLanes = 3;
+
+    struct Queued {
+        JobId id;
+        Clock::time_point since;
+        double cost;
+    };
+    struct Group {
+        std::map<uint64_t, Queued> bySeq;                 // arrival order
+        std::set<std::pair<double, uint64_t>> byCost;   // cheapest first
+        double deficit = 0.0;
+    };
+    struct Lane {
+        std::unordered_map<std::string, Group> groups;
+        std::deque<std::string> rotation;  // groups with queued jobs, in DRR order
+    };
+
+    [[nodiscard]] double weight(const std::string& group) const noexcept;
+    JobId take(Lane& lane, const std::string& group, Clock::time_point now, bool oldest);
+    JobId takeFair(Lane& lane, Clock::time_point now);
+
+    SchedulerConfig config_;
+    std::array<Lane, kLanes * 2> lanes_;  // per priority; media jobs in the second half
+    std::unordered_set<JobId> queued_;
+    std::size_t mediaQueued_ = 0;
+    uint64_t seq_ = 0;
+};
+
+}
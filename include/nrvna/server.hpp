@@ -12,8 +12,13 @@
 namespace nrvna {
 
 class Scanner;
+class Compactor;
+class CostModel;
+class GarbageCollector;
+class IndexKeeper;
 class Pool;
 class Processor;
+class ReadyWatcher;
 
 struct RecoveryReport {
     int recovered = 0;
@@ -29,7 +34,8 @@ public:
            const std::filesystem::path& workspace,
            int workers = 4,
            const std::string& mmprojPath = "",
-           const std::string& vocoderPath = "");
+           const std::string& vocoderPath = "",
+           const std::string& draftPath = "");
     ~Server();
 
     Server(const Server&) = delete;
@@ -49,6 +55,7 @@ private:
     std::string modelPath_;
     std::string mmprojPath_;
     std::string vocoderPath_;
+    std::string draftPath_;
     std::filesystem::path workspace_;
     int workers_;
     
@@ -58,6 +65,11 @@ private:
     std::unique_ptr<Scanner> scanner_;
     std::unique_ptr<Pool> pool_;
     std::unique_ptr<Processor> processor_;
+    std::unique_ptr<ReadyWatcher> watcher_;
+    std::unique_ptr<IndexKeeper> indexKeeper_;
+    std::unique_ptr<Compactor> compactor_;  // null unless NRVNA_COMPACT_MINUTES is set
+    std::unique_ptr<GarbageCollector> collector_;  // null without a retention policy
+    std::shared_ptr<CostModel> costModel_;  // shared with the processor
     
     std::thread scannerThread_;
 };
@@ -16,6 +16,13 @@ enum class JobType : std::uint8_t {
     Stt = 4
 };
 
+// Scheduling lane, serialized to meta.json "priority". Lower values run first.
+enum class Priority : std::uint8_t {
+    High = 0,
+    Normal = 1,
+    Low = 2
+};
+
 // Opaque job identifier (string-based for now; can evolve to strong type).
 using JobId = std::string;
 
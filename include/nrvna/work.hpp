@@ -18,6 +18,10 @@ struct SubmitOptions {
     std::string output_format;
     std::string schema;
     std::string grammar;
+    std::string speculate;  // contract::isValidSpeculation; empty uses the daemon default
+    bool continuation = false;  // text only: resume the parent's conversation
+    double timeout_s = 0.0;     // fail the job after this many running seconds; 0 = daemon default
+    std::string priority;       // contract::isValidPriority; empty is normal
 };
 
 enum class SubmissionError : uint8_t {
@@ -54,6 +58,10 @@ public:
                                             const SubmitOptions& opts = {});
     [[nodiscard]] static bool isValidTag(const std::string& tag) noexcept;
 
+    // Ask the daemon to stop a queued or running job. Returns the state the
+    // request was recorded in, or the job's final state if it was too late.
+    [[nodiscard]] Status cancel(const JobId& id) const noexcept;
+
 private:
     std::filesystem::path workspace_;
     std::size_t maxBytes_ = 10'000'000; // 10MB
@@ -0,0 +1,477 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "nrvna/archive.hpp"
+#include "nrvna/contract.hpp"
+#include "nrvna/durability.hpp"
+#include "nrvna/logger.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace nrvna {
+
+namespace {
+
+constexpr const char* kRecordHeader = "nrvna-job";
+constexpr std::size_t kPackBatch = 256;                       // jobs per durable index append
+constexpr std::chrono::seconds kCompactInterval{60};
+constexpr uint64_t kSparseRatio = 4;                          // rewrite segments under 1/4 live
+
+int64_t directoryTime(const std::filesystem::path& dir) {
+    std::error_code ec;
+    const auto mtime = std::filesystem::last_write_time(dir, ec);
+    if (ec) return 0;
+    // file_time_type's epoch is unspecified; map through now().
+    const auto age = std::filesystem::file_time_type::clock::now() - mtime;
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch() - age).count();
+}
+
+bool writeAll(int fd, const std::string& data) {
+    std::size_t written = 0;
+    while (written < data.size()) {
+        const ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        written += static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+// Appends data and returns the offset it starts at.
+std::optional<uint64_t> appendFile(const std::filesystem::path& path, const std::string& data) {
+    const int fd = ::open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOG_WARN("Cannot open " + path.string() + ": " + std::strerror(errno));
+        return std::nullopt;
+    }
+    struct stat st{};
+    const bool ok = ::fstat(fd, &st) == 0 && writeAll(fd, data);
+    if (!ok) {
+        LOG_WARN("Cannot append to " + path.string() + ": " + std::strerror(errno));
+    }
+    ::close(fd);
+    if (!ok) return std::nullopt;
+    return static_cast<uint64_t>(st.st_size);
+}
+
+// One job's files as a segment record, or nullopt if it cannot be packed.
+std::optional<std::string> buildRecord(const JobId& id, const std::filesystem::path& dir) {
+    std::vector<std::pair<std::string, std::filesystem::path>> entries;
+    std::error_code ec;
+    for (std::filesystem::recursive_directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        if (!it->is_regular_file(ec)) continue;
+        auto name = it->path().lexically_relative(dir).generic_string();
+        if (name.find_first_of("\t\n") != std::string::npos) return std::nullopt;
+        entries.emplace_back(std::move(name), it->path());
+    }
+    if (ec) return std::nullopt;
+    std::sort(entries.begin(), entries.end());
+
+    std::string record = std::string(kRecordHeader) + '\t' + id + '\t' + std::to_string(entries.size()) + '\n';
+    for (const auto& [name, path] : entries) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return std::nullopt;
+        std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (file.bad()) return std::nullopt;
+        record += name + '\t' + std::to_string(data.size()) + '\n';
+        record += data;
+    }
+    return record;
+}
+
+}
+
+Archive::Archive(std::filesystem::path workspace) noexcept
+    : workspace_(std::move(workspace)) {}
+
+// Segment and index appends compute offsets from the file size, so the
+// compactor and the garbage collector write one at a time.
+std::mutex& Archive::writeMutex() noexcept {
+    static std::mutex mutex;
+    return mutex;
+}
+
+bool Archive::refresh() {
+    std::ifstream in(workspace_ / contract::kArchiveIndexFile, std::ios::binary);
+    if (!in || !in.seekg(static_cast<std::streamoff>(indexOffset_))) {
+        return false;
+    }
+    bool applied = false;
+    std::string line;
+    // Only whole lines: one still being appended is read next time.
+    while (std::getline(in, line) && !in.eof()) {
+        indexOffset_ += line.size() + 1;
+        std::istringstream fields(line);
+        JobId id;
+        Location location;
+        if (!(fields >> id >> location.segment >> location.offset >> location.length >> location.time_us) ||
+            !contract::isValidJobId(id)) {
+            continue;
+        }
+        applied = true;
+        if (location.segment == 0) {
+            locations_.erase(id);  // removed
+            continue;
+        }
+        lastSegment_ = std::max(lastSegment_, location.segment);
+        locations_[id] = location;
+    }
+    return applied;
+}
+
+bool Archive::contains(const JobId& id) const {
+    return locations_.count(id) > 0;
+}
+
+std::vector<JobId> Archive::ids() const {
+    std::vector<JobId> ids;
+    ids.reserve(locations_.size());
+    for (const auto& [id, location] : locations_) ids.push_back(id);
+    return ids;
+}
+
+std::optional<int64_t> Archive::time(const JobId& id) const {
+    auto found = locations_.find(id);
+    if (found == locations_.end()) return std::nullopt;
+    return found->second.time_us;
+}
+
+std::filesystem::path Archive::segmentPath(uint32_t segment) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%06u%s", segment, contract::kSegmentExtension);
+    return workspace_ / contract::kArchiveDir / name;
+}
+
+template <typename Visit>
+bool Archive::walk(const JobId& id, Visit&& visit) const {
+    auto found = locations_.find(id);
+    if (found == locations_.end()) return false;
+    const Location& location = found->second;
+
+    std::ifstream in(segmentPath(location.segment), std::ios::binary);
+    if (!in || !in.seekg(static_cast<std::streamoff>(location.offset))) return false;
+    const uint64_t end = location.offset + location.length;
+
+    std::string header;
+    std::getline(in, header);
+    std::istringstream fields(header);
+    std::string magic;
+    JobId recorded;
+    std::size_t count = 0;
+    if (!(fields >> magic >> recorded >> count) || magic != kRecordHeader || recorded != id) {
+        LOG_WARN("Damaged archive record for job " + id);
+        return false;
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        std::string entry;
+        if (!std::getline(in, entry)) return false;
+        const auto tab = entry.rfind('\t');
+        if (tab == std::string::npos) return false;
+        uint64_t size = 0;
+        try {
+            size = std::stoull(entry.substr(tab + 1));
+        } catch (...) {
+            return false;
+        }
+        const auto start = static_cast<uint64_t>(in.tellg());
+        if (start + size > end) return false;
+        if (!visit(entry.substr(0, tab), size, in)) return true;
+        in.seekg(static_cast<std::streamoff>(start + size));
+    }
+    return true;
+}
+
+std::vector<std::string> Archive::files(const JobId& id) const {
+    std::vector<std::string> names;
+    walk(id, [&](const std::string& name, uint64_t, std::istream&) {
+        names.push_back(name);
+        return true;
+    });
+    return names;
+}
+
+std::optional<std::string> Archive::readFile(const JobId& id, const std::string& name) const {
+    std::optional<std::string> content;
+    walk(id, [&](const std::string& entry, uint64_t size, std::istream& in) {
+        if (entry != name) return true;
+        std::string data(size, '\0');
+        if (in.read(data.data(), static_cast<std::streamsize>(size))) {
+            content = std::move(data);
+        }
+        return false;
+    });
+    return content;
+}
+
+std::size_t Archive::pack(const std::vector<JobId>& ids, std::uintmax_t segmentBytes) {
+    std::lock_guard<std::mutex> lock(writeMutex());
+    refresh();
+    std::error_code ec;
+    std::filesystem::create_directories(workspace_ / contract::kArchiveDir, ec);
+    if (ec) {
+        LOG_WARN("Cannot create archive directory: " + ec.message());
+        return 0;
+    }
+
+    std::vector<JobId> packed;
+    std::vector<JobId> stale;  // indexed by a pass that stopped before removing them
+    std::set<uint32_t> segments;
+    std::string indexLines;
+    uint32_t segment = std::max<uint32_t>(1, lastSegment_);
+    for (const auto& id : ids) {
+        const auto dir = contract::jobDir(workspace_, Status::Done, id);
+        if (!std::filesystem::is_directory(dir, ec)) continue;
+        if (contains(id)) {
+            stale.push_back(id);
+            continue;
+        }
+        auto record = buildRecord(id, dir);
+        if (!record) {
+            LOG_WARN("Cannot archive job " + id + "; leaving it in output/");
+            continue;
+        }
+        const auto size = std::filesystem::file_size(segmentPath(segment), ec);
+        if (!ec && size > 0 && size + record->size() > segmentBytes) {
+            ++segment;
+        }
+        auto offset = appendFile(segmentPath(segment), *record);
+        if (!offset) {
+            break;
+        }
+        segments.insert(segment);
+        indexLines += id + '\t' + std::to_string(segment) + '\t' + std::to_string(*offset) + '\t' +
+                      std::to_string(record->size()) + '\t' + std::to_string(directoryTime(dir)) + '\n';
+        packed.push_back(id);
+    }
+
+    // Records reach the disk before the index names them, and the index
+    // before the directories go.
+    auto& syncer = Syncer::shared();
+    if (!packed.empty()) {
+        std::vector<std::filesystem::path> paths{workspace_ / contract::kArchiveDir};
+        for (uint32_t s : segments) paths.push_back(segmentPath(s));
+        if (!syncer.sync(std::move(paths))) {
+            LOG_WARN("Archive segments not synced; jobs stay in output/");
+            return 0;
+        }
+        const auto indexPath = workspace_ / contract::kArchiveIndexFile;
+        if (!appendFile(indexPath, indexLines) || !syncer.sync({indexPath, workspace_ / contract::kArchiveDir})) {
+            LOG_WARN("Archive index not synced; jobs stay in output/");
+            return 0;
+        }
+        refresh();
+    }
+
+    for (const auto* list : {&packed, &stale}) {
+        for (const auto& id : *list) {
+            std::filesystem::remove_all(contract::jobDir(workspace_, Status::Done, id), ec);
+            if (ec) {
+                LOG_WARN("Archived job " + id + " still in output/: " + ec.message());
+            }
+        }
+    }
+    return packed.size();
+}
+
+Reclaimed Archive::remove(const std::vector<JobId>& ids) {
+    std::lock_guard<std::mutex> lock(writeMutex());
+    refresh();
+    Reclaimed reclaimed;
+    std::string tombstones;
+    for (const auto& id : ids) {
+        if (contains(id)) tombstones += id + "\t0\t0\t0\t0\n";
+    }
+    if (tombstones.empty()) {
+        return reclaimed;
+    }
+    // Durable before any segment goes, so no live entry outlives its record.
+    const auto indexPath = workspace_ / contract::kArchiveIndexFile;
+    if (!appendFile(indexPath, tombstones) || !Syncer::shared().sync({indexPath})) {
+        LOG_WARN("Archive index not synced; segments kept");
+        return reclaimed;
+    }
+    refresh();
+    const uint64_t rewritten = rewriteSparse();
+
+    std::set<uint32_t> live;
+    for (const auto& [id, location] : locations_) live.insert(location.segment);
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(workspace_ / contract::kArchiveDir, ec), end;
+         !ec && it != end; it.increment(ec)) {
+        if (it->path().extension() != contract::kSegmentExtension) continue;
+        uint32_t segment = 0;
+        try {
+            segment = static_cast<uint32_t>(std::stoul(it->path().stem().string()));
+        } catch (...) {
+            continue;
+        }
+        // The newest segment is still being appended to.
+        if (segment == 0 || segment >= lastSegment_ || live.count(segment) > 0) continue;
+        std::error_code fileEc;
+        const auto size = it->file_size(fileEc);
+        if (std::filesystem::remove(it->path(), fileEc) && !fileEc) {
+            reclaimed.bytes += size;
+            reclaimed.inodes += 1;
+        }
+    }
+    // The copies are part of the cost.
+    reclaimed.bytes -= std::min(reclaimed.bytes, rewritten);
+    if (rewritten > 0 && reclaimed.inodes > 0) --reclaimed.inodes;
+    return reclaimed;
+}
+
+uint64_t Archive::rewriteSparse() {
+    std::unordered_map<uint32_t, uint64_t> liveBytes;
+    for (const auto& [id, location] : locations_) liveBytes[location.segment] += location.length;
+    std::set<uint32_t> sparse;
+    for (const auto& [segment, bytes] : liveBytes) {
+        // The newest segment is still being appended to.
+        if (segment >= lastSegment_) continue;
+        std::error_code ec;
+        const auto size = std::filesystem::file_size(segmentPath(segment), ec);
+        if (!ec && bytes * kSparseRatio < size) sparse.insert(segment);
+    }
+    if (sparse.empty()) {
+        return 0;
+    }
+    std::vector<JobId> moving;
+    for (const auto& [id, location] : locations_) {
+        if (sparse.count(location.segment) > 0) moving.push_back(id);
+    }
+    std::sort(moving.begin(), moving.end());
+
+    // Records reach the disk before the index moves them, and the index
+    // before the old segments go; readers holding old offsets see the job
+    // until then.
+    const uint32_t target = lastSegment_ + 1;
+    std::string indexLines;
+    uint64_t written = 0;
+    for (const auto& id : moving) {
+        const Location& from = locations_.at(id);
+        std::ifstream in(segmentPath(from.segment), std::ios::binary);
+        std::string record(from.length, '\0');
+        if (!in.seekg(static_cast<std::streamoff>(from.offset)) ||
+            !in.read(record.data(), static_cast<std::streamsize>(from.length))) {
+            LOG_WARN("Cannot read archive record for job " + id + "; segment " +
+                     std::to_string(from.segment) + " kept");
+            return 0;
+        }
+        auto offset = appendFile(segmentPath(target), record);
+        if (!offset) {
+            return 0;
+        }
+        written += record.size();
+        indexLines += id + '\t' + std::to_string(target) + '\t' + std::to_string(*offset) + '\t' +
+                      std::to_string(from.length) + '\t' + std::to_string(from.time_us) + '\n';
+    }
+    auto& syncer = Syncer::shared();
+    const auto indexPath = workspace_ / contract::kArchiveIndexFile;
+    if (!syncer.sync({segmentPath(target), workspace_ / contract::kArchiveDir}) ||
+        !appendFile(indexPath, indexLines) || !syncer.sync({indexPath})) {
+        LOG_WARN("Rewritten archive segment not synced; old segments kept");
+        return 0;
+    }
+    refresh();
+    LOG_INFO("Rewrote " + std::to_string(moving.size()) + " archived job(s) out of " +
+             std::to_string(sparse.size()) + " sparse segment(s)");
+    return written;
+}
+
+Compactor::Compactor(std::filesystem::path workspace, std::chrono::seconds minAge,
+                     std::uintmax_t segmentBytes) noexcept
+    : workspace_(workspace), minAge_(minAge), segmentBytes_(segmentBytes), archive_(std::move(workspace)) {}
+
+Compactor::~Compactor() {
+    stop();
+}
+
+bool Compactor::start() noexcept {
+    try {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (thread_.joinable()) {
+            return true;
+        }
+        stopping_ = false;
+        thread_ = std::thread(&Compactor::loop, this);
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to start compactor: " + std::string(e.what()));
+        return false;
+    }
+}
+
+void Compactor::stop() noexcept {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+std::size_t Compactor::compact() {
+    const auto cutoff = std::filesystem::file_time_type::clock::now() - minAge_;
+    std::vector<JobId> due;
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(contract::stateDir(workspace_, Status::Done), ec), end;
+         !ec && it != end; it.increment(ec)) {
+        const auto id = it->path().filename().string();
+        if (!contract::isValidJobId(id) || !it->is_directory(ec)) continue;
+        std::error_code fileEc;
+        if (std::filesystem::last_write_time(it->path(), fileEc) > cutoff || fileEc) continue;
+        if (std::filesystem::exists(it->path() / contract::kAudioFile, fileEc) ||
+            std::filesystem::exists(it->path() / contract::kStateFile, fileEc)) {
+            continue;
+        }
+        due.push_back(id);
+    }
+    std::sort(due.begin(), due.end());
+
+    std::size_t packed = 0;
+    for (std::size_t i = 0; i < due.size(); i += kPackBatch) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) break;
+        }
+        const auto last = due.begin() + static_cast<std::ptrdiff_t>(std::min(due.size(), i + kPackBatch));
+        packed += archive_.pack({due.begin() + static_cast<std::ptrdiff_t>(i), last}, segmentBytes_);
+    }
+    if (packed > 0) {
+        LOG_INFO("Archived " + std::to_string(packed) + " finished job(s)");
+    }
+    return packed;
+}
+
+void Compactor::loop() {
+    setThreadName("Compact");
+
+    while (true) {
+        try {
+            compact();
+        } catch (const std::exception& e) {
+            LOG_WARN("Compaction pass failed: " + std::string(e.what()));
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (wake_.wait_for(lock, kCompactInterval, [&] { return stopping_; })) {
+            break;
+        }
+    }
+}
+
+}
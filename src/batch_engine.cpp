@@ -0,0 +1,289 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "nrvna/batch_engine.hpp"
+#include "nrvna/job_control.hpp"
+#include "nrvna/logger.hpp"
+#include "llama_util.hpp"
+#include "text_stream.hpp"
+#include "llama.h"
+#include <algorithm>
+
+namespace nrvna {
+
+namespace {
+
+void addToken(llama_batch& batch, llama_token token, llama_pos pos, llama_seq_id seqId, bool logits) {
+    const int i = batch.n_tokens++;
+    batch.token[i] = token;
+    batch.pos[i] = pos;
+    batch.n_seq_id[i] = 1;
+    batch.seq_id[i][0] = seqId;
+    batch.logits[i] = logits;
+}
+
+}
+
+BatchEngine::BatchEngine(std::shared_ptr<llama_model> model, int maxSequences, int sequenceCtx)
+    : model_(std::move(model)), maxSequences_(std::max(1, maxSequences)), sequenceCtx_(sequenceCtx) {
+    llama_context_params params = llama_context_default_params();
+    params.n_seq_max = static_cast<uint32_t>(maxSequences_);
+    // Each sequence gets its own sequenceCtx-sized slice of the KV cache.
+    params.n_ctx = static_cast<uint32_t>(maxSequences_) * static_cast<uint32_t>(sequenceCtx_);
+    // Every decoding sequence contributes one token per step, so the batch
+    // must always hold at least one token per sequence.
+    nBatch_ = std::max(maxSequences_, env_positive_int("NRVNA_BATCH", 2048));
+    params.n_batch = static_cast<uint32_t>(nBatch_);
+    params.n_ubatch = static_cast<uint32_t>(std::max(1, std::min(nBatch_, env_positive_int("NRVNA_UBATCH", nBatch_))));
+    params.no_perf = false;
+    if (effective_gpu_layers() <= 0) {
+        params.offload_kqv = false;
+        params.op_offload = false;
+    }
+
+    ctx_ = llama_init_from_model(model_.get(), params);
+    if (!ctx_) {
+        throw std::runtime_error("Failed to create batching context");
+    }
+
+    for (int i = maxSequences_ - 1; i >= 0; --i) {
+        freeSeqIds_.push_back(i);
+    }
+
+    LOG_INFO("Batching engine: " + std::to_string(maxSequences_) + " sequences x " +
+             std::to_string(sequenceCtx_) + " tokens, batch=" + std::to_string(nBatch_));
+}
+
+BatchEngine::~BatchEngine() {
+    stop();
+    if (ctx_) {
+        llama_free(ctx_);
+    }
+}
+
+bool BatchEngine::start() noexcept {
+    try {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (thread_.joinable()) {
+            return true;
+        }
+        stopping_ = false;
+        thread_ = std::thread(&BatchEngine::loop, this);
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to start batching engine: " + std::string(e.what()));
+        return false;
+    }
+}
+
+void BatchEngine::stop() noexcept {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& seq : pending_) {
+        if (seq->sampler) llama_sampler_free(seq->sampler);
+        seq->done.set_value({false, "", "Batching engine stopped"});
+    }
+    pending_.clear();
+}
+
+BatchEngine::Sequence::~Sequence() = default;
+
+RunResult BatchEngine::generate(std::vector<int32_t> promptTokens, llama_sampler* sampler, int nPredict,
+                                std::shared_ptr<const PrefixEntry> prefix, size_t snapshotAt, TextSink onText,
+                                JobControl* control) {
+    auto seq = std::make_unique<Sequence>();
+    seq->stream = std::make_unique<TextStream>(std::move(onText));
+    seq->control = control;
+    seq->prompt = std::move(promptTokens);
+    seq->sampler = sampler;
+    seq->nPredict = nPredict;
+    // A prefix must leave at least one prompt token to produce logits.
+    if (prefix && prefix->tokens.size() < seq->prompt.size()) {
+        seq->prefix = std::move(prefix);
+    }
+    seq->snapshotAt = prefixCache_ && snapshotAt < seq->prompt.size() ? snapshotAt : 0;
+    auto result = seq->done.get_future();
+
+    if (seq->prompt.empty() || nPredict <= 0) {
+        if (sampler) llama_sampler_free(sampler);
+        return {false, "", "Batching engine received an empty request"};
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_ || !thread_.joinable()) {
+            if (sampler) llama_sampler_free(sampler);
+            return {false, "", "Batching engine is not running"};
+        }
+        pending_.push_back(std::move(seq));
+    }
+    wake_.notify_one();
+    return result.get();
+}
+
+void BatchEngine::finish(Sequence& seq, RunResult result) noexcept {
+    try {
+        seq.stream->flush();
+    } catch (...) {
+    }
+    if (seq.reused > 0) {
+        result.metrics["prefix_reused_tokens"] = static_cast<double>(seq.reused);
+    }
+    llama_memory_seq_rm(llama_get_memory(ctx_), seq.seqId, -1, -1);
+    if (seq.sampler) {
+        llama_sampler_free(seq.sampler);
+        seq.sampler = nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        freeSeqIds_.push_back(seq.seqId);
+    }
+    seq.seqId = -1;
+    seq.done.set_value(std::move(result));
+}
+
+void BatchEngine::restorePrefix(Sequence& seq) noexcept {
+    auto prefix = std::move(seq.prefix);
+    if (!prefix || !seq_state_set(ctx_, prefix->state, seq.seqId)) {
+        return;
+    }
+    seq.reused = prefix->tokens.size();
+    seq.prefilled = seq.reused;
+    seq.nPast = static_cast<int>(seq.reused);
+    if (seq.snapshotAt <= seq.reused) {
+        seq.snapshotAt = 0;
+    }
+}
+
+void BatchEngine::savePrefix(Sequence& seq) noexcept {
+    const size_t length = seq.snapshotAt;
+    seq.snapshotAt = 0;
+    auto state = seq_state_get(ctx_, seq.seqId);
+    if (state.empty()) {
+        return;
+    }
+    try {
+        std::vector<int32_t> tokens(seq.prompt.begin(), seq.prompt.begin() + static_cast<std::ptrdiff_t>(length));
+        prefixCache_->insert(std::move(tokens), std::move(state));
+    } catch (const std::exception& e) {
+        LOG_WARN("Failed to cache prompt prefix: " + std::string(e.what()));
+    }
+}
+
+void BatchEngine::loop() {
+    setThreadName("Batch");
+    const llama_vocab* vocab = llama_model_get_vocab(model_.get());
+    llama_batch batch = llama_batch_init(nBatch_, 0, 1);
+    std::vector<std::unique_ptr<Sequence>> active;
+
+    while (true) {
+        const size_t admitted = active.size();
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return stopping_ || !pending_.empty() || !active.empty(); });
+            if (stopping_) {
+                break;
+            }
+            // Join new jobs between steps while sequence IDs are free.
+            while (!pending_.empty() && !freeSeqIds_.empty()) {
+                auto seq = std::move(pending_.front());
+                pending_.pop_front();
+                seq->seqId = freeSeqIds_.back();
+                freeSeqIds_.pop_back();
+                active.push_back(std::move(seq));
+            }
+        }
+        for (size_t i = admitted; i < active.size(); ++i) {
+            restorePrefix(*active[i]);
+        }
+
+        // Cancelled or expired jobs leave between steps. The shared context has
+        // no abort callback: aborting a decode would fail every sequence in it.
+        for (auto& seq : active) {
+            if (seq->control && seq->control->stopRequested()) {
+                finish(*seq, {false, std::move(seq->output), seq->control->reason()});
+            }
+        }
+        active.erase(std::remove_if(active.begin(), active.end(),
+                                    [](const std::unique_ptr<Sequence>& seq) { return seq->seqId < 0; }),
+                     active.end());
+
+        // Decoding sequences go first so prefill never starves generation.
+        batch.n_tokens = 0;
+        for (auto& seq : active) {
+            seq->logitIndex = -1;
+            if (seq->prefilled < seq->prompt.size()) continue;
+            seq->logitIndex = batch.n_tokens;
+            addToken(batch, seq->next, seq->nPast++, seq->seqId, true);
+        }
+        for (auto& seq : active) {
+            // Prefill pauses at the snapshot point until the state is saved.
+            while (seq->prefilled < seq->prompt.size() && batch.n_tokens < nBatch_ &&
+                   !(seq->snapshotAt > 0 && seq->prefilled == seq->snapshotAt)) {
+                const bool last = seq->prefilled + 1 == seq->prompt.size();
+                if (last) seq->logitIndex = batch.n_tokens;
+                addToken(batch, seq->prompt[seq->prefilled++], seq->nPast++, seq->seqId, last);
+            }
+        }
+
+        if (batch.n_tokens == 0) {
+            continue;
+        }
+
+        if (llama_decode(ctx_, batch) != 0) {
+            LOG_ERROR("Batched decode failed for " + std::to_string(active.size()) + " sequence(s)");
+            for (auto& seq : active) {
+                finish(*seq, {false, "", "Failed to decode batch"});
+            }
+            active.clear();
+            continue;
+        }
+
+        for (auto& seq : active) {
+            if (seq->snapshotAt > 0 && seq->prefilled == seq->snapshotAt) {
+                savePrefix(*seq);
+            }
+            if (seq->logitIndex < 0) continue;
+
+            const llama_token token = llama_sampler_sample(seq->sampler, ctx_, seq->logitIndex);
+            if (llama_vocab_is_eog(vocab, token)) {
+                finish(*seq, {true, std::move(seq->output), ""});
+                continue;
+            }
+
+            auto piece = token_piece(vocab, token);
+            if (!piece) {
+                finish(*seq, {false, "", "Failed to convert generated token to text"});
+                continue;
+            }
+            seq->output += *piece;
+            seq->stream->append(*piece);
+            seq->next = token;
+            if (++seq->generated >= seq->nPredict) {
+                finish(*seq, {true, std::move(seq->output), ""});
+            }
+        }
+
+        active.erase(std::remove_if(active.begin(), active.end(),
+                                    [](const std::unique_ptr<Sequence>& seq) { return seq->seqId < 0; }),
+                     active.end());
+    }
+
+    for (auto& seq : active) {
+        finish(*seq, {false, "", "Batching engine stopped"});
+    }
+    llama_batch_free(batch);
+}
+
+}
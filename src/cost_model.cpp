@@ -0,0 +1,119 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "nrvna/cost_model.hpp"
+#include "nrvna/contract.hpp"
+#include "nrvna/logger.hpp"
+#include "nrvna/meta.hpp"
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace nrvna {
+
+namespace {
+// Starting rates until a mode has history; only their ratios matter.
+constexpr std::array<double, 5> kPriorSecondsPerUnit = {
+    4.0,   // text
+    0.2,   // embed
+    8.0,   // vision
+    4.0,   // tts
+    4.0,   // stt
+};
+constexpr double kLearningRate = 0.1;
+
+std::size_t countFiles(const std::filesystem::path& dir) noexcept {
+    std::size_t n = 0;
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->is_regular_file(ec)) ++n;
+    }
+    return n;
+}
+
+std::size_t modeIndex(JobType type) noexcept {
+    const auto index = static_cast<std::size_t>(type);
+    return index < kPriorSecondsPerUnit.size() ? index : 0;
+}
+}
+
+CostModel::CostModel() noexcept : secondsPerUnit_(kPriorSecondsPerUnit) {}
+
+JobShape CostModel::inspect(const std::filesystem::path& jobDir) noexcept {
+    JobShape shape;
+    try {
+        std::error_code ec;
+        const auto bytes = std::filesystem::file_size(jobDir / contract::kPromptFile, ec);
+        shape.promptBytes = ec ? 0 : bytes;
+        std::ifstream typeFile(jobDir / contract::kTypeFile);
+        std::string type;
+        if (typeFile && std::getline(typeFile, type)) {
+            shape.type = contract::tryParseJobType(type).value_or(JobType::Text);
+        }
+        shape.images = countFiles(jobDir / contract::kImagesDir);
+        shape.audio = countFiles(jobDir / contract::kAudioInputDir);
+    } catch (...) {
+    }
+    return shape;
+}
+
+double CostModel::units(const JobShape& shape) noexcept {
+    return 1.0 + static_cast<double>(shape.promptBytes) / 1024.0 +
+           4.0 * static_cast<double>(shape.images + shape.audio);
+}
+
+double CostModel::estimate(const JobShape& shape) const noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return secondsPerUnit_[modeIndex(shape.type)] * units(shape);
+}
+
+void CostModel::observe(const JobShape& shape, double seconds) noexcept {
+    if (!(seconds >= 0.0)) return;
+    const double rate = seconds / units(shape);
+    std::lock_guard<std::mutex> lock(mutex_);
+    double& current = secondsPerUnit_[modeIndex(shape.type)];
+    current += kLearningRate * (rate - current);
+}
+
+std::size_t CostModel::seed(const std::filesystem::path& workspace, std::size_t limit) noexcept {
+    try {
+        // Job IDs sort by submission time, so the largest are the newest.
+        std::vector<std::string> ids;
+        const auto outputDir = contract::stateDir(workspace, Status::Done);
+        std::error_code ec;
+        for (std::filesystem::directory_iterator it(outputDir, ec), end; !ec && it != end; it.increment(ec)) {
+            auto id = it->path().filename().string();
+            if (contract::isValidJobId(id)) ids.push_back(std::move(id));
+        }
+        if (ids.size() > limit) {
+            std::nth_element(ids.begin(), ids.begin() + static_cast<std::ptrdiff_t>(limit), ids.end(),
+                             std::greater<>());
+            ids.resize(limit);
+        }
+        // Oldest first, so the newest history weighs most.
+        std::sort(ids.begin(), ids.end());
+
+        std::size_t used = 0;
+        for (const auto& id : ids) {
+            const auto dir = outputDir / id;
+            auto meta = readMetaJson(dir);
+            // A cached result's duration says nothing about the model.
+            if (!meta || meta->duration_s < 0.0 || !meta->cached_from.empty()) continue;
+            observe(inspect(dir), meta->duration_s);
+            ++used;
+        }
+        if (used > 0) {
+            LOG_DEBUG("Cost model seeded from " + std::to_string(used) + " completed jobs");
+        }
+        return used;
+    } catch (...) {
+        return 0;
+    }
+}
+
+}
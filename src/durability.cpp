@@ -0,0 +1,179 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "nrvna/durability.hpp"
+#include "nrvna/logger.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <set>
+#include <string>
+#include <unistd.h>
+
+namespace nrvna {
+
+namespace {
+
+bool fsyncPath(const std::filesystem::path& path) noexcept {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_WARN("Cannot open for fsync: " + path.string() + ": " + std::strerror(errno));
+        return false;
+    }
+#ifdef __APPLE__
+    // fsync on macOS stops at the drive cache.
+    int rc = ::fcntl(fd, F_FULLFSYNC);
+    if (rc != 0) rc = ::fsync(fd);
+#else
+    const int rc = ::fsync(fd);
+#endif
+    if (rc != 0) {
+        LOG_WARN("fsync failed: " + path.string() + ": " + std::strerror(errno));
+    }
+    ::close(fd);
+    return rc == 0;
+}
+
+}
+
+std::optional<Durability> parseDurability(std::string_view value) noexcept {
+    if (value.empty() || value == "none") return Durability::None;
+    if (value == "rename") return Durability::Rename;
+    if (value == "full") return Durability::Full;
+    return std::nullopt;
+}
+
+Syncer::Syncer(Durability mode) noexcept : mode_(mode) {}
+
+Syncer::~Syncer() {
+    stop();
+}
+
+Syncer& Syncer::shared() {
+    static Syncer syncer([] {
+        const char* value = std::getenv("NRVNA_DURABILITY");
+        auto mode = parseDurability(value ? value : "");
+        if (!mode) {
+            LOG_WARN("Unknown NRVNA_DURABILITY value: " + std::string(value) + " (expected none, rename, or full)");
+            return Durability::None;
+        }
+        return *mode;
+    }());
+    return syncer;
+}
+
+bool Syncer::beforeRename(const std::filesystem::path& jobDir) {
+    if (mode_ != Durability::Full) {
+        return true;
+    }
+    std::vector<std::filesystem::path> paths;
+    std::error_code ec;
+    for (std::filesystem::recursive_directory_iterator it(jobDir, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->is_regular_file(ec) || it->is_directory(ec)) {
+            paths.push_back(it->path());
+        }
+    }
+    if (ec) {
+        LOG_WARN("Cannot list " + jobDir.string() + " for fsync: " + ec.message());
+        return false;
+    }
+    paths.push_back(jobDir);
+    return sync(std::move(paths));
+}
+
+bool Syncer::afterRename(const std::filesystem::path& from, const std::filesystem::path& to) {
+    if (mode_ == Durability::None) {
+        return true;
+    }
+    return sync({to.parent_path(), from.parent_path()});
+}
+
+bool Syncer::sync(std::vector<std::filesystem::path> paths) {
+    if (paths.empty()) {
+        return true;
+    }
+    Request request;
+    request.paths = std::move(paths);
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!stopping_ && !thread_.joinable()) {
+            try {
+                thread_ = std::thread(&Syncer::loop, this);
+            } catch (const std::exception& e) {
+                LOG_WARN("Syncing on the caller: " + std::string(e.what()));
+            }
+        }
+        if (thread_.joinable()) {
+            queue_.push_back(&request);
+            wake_.notify_one();
+            done_.wait(lock, [&] { return request.done; });
+            return request.ok;
+        }
+    }
+
+    // Stopped, or no thread: sync here.
+    bool ok = true;
+    for (const auto& path : request.paths) {
+        ok = fsyncPath(path) && ok;
+    }
+    return ok;
+}
+
+void Syncer::stop() noexcept {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+uint64_t Syncer::passes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return passes_;
+}
+
+void Syncer::loop() {
+    setThreadName("Sync");
+
+    while (true) {
+        std::deque<Request*> batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                break;  // stopping with nothing left to sync
+            }
+            batch.swap(queue_);
+        }
+
+        std::set<std::filesystem::path> unique;
+        for (const auto* request : batch) {
+            unique.insert(request->paths.begin(), request->paths.end());
+        }
+        std::set<std::filesystem::path> failed;
+        for (const auto& path : unique) {
+            if (!fsyncPath(path)) failed.insert(path);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++passes_;
+            for (auto* request : batch) {
+                for (const auto& path : request->paths) {
+                    if (failed.count(path) > 0) request->ok = false;
+                }
+                request->done = true;
+            }
+        }
+        done_.notify_all();
+    }
+}
+
+}
@@ -0,0 +1,104 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "nrvna/embed_batcher.hpp"
+#include "nrvna/logger.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace nrvna {
+
+EmbedBatcher::EmbedBatcher(std::unique_ptr<Runner> runner, std::size_t maxBatch,
+                           std::chrono::milliseconds maxDelay, Completion complete)
+    : runner_(std::move(runner)),
+      maxBatch_(std::max<std::size_t>(1, maxBatch)),
+      maxQueued_(4 * maxBatch_),
+      maxDelay_(maxDelay),
+      complete_(std::move(complete)) {}
+
+EmbedBatcher::~EmbedBatcher() {
+    stop();
+}
+
+bool EmbedBatcher::start() noexcept {
+    try {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (thread_.joinable()) {
+            return true;
+        }
+        stopping_ = false;
+        thread_ = std::thread(&EmbedBatcher::loop, this);
+        LOG_INFO("Embedding batches: up to " + std::to_string(maxBatch_) + " jobs, " +
+                 std::to_string(maxDelay_.count()) + " ms delay");
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to start embedding batcher: " + std::string(e.what()));
+        return false;
+    }
+}
+
+void EmbedBatcher::stop() noexcept {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    space_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+bool EmbedBatcher::submit(Job job) {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        space_.wait(lock, [&] { return stopping_ || queue_.size() < maxQueued_; });
+        if (stopping_ || !thread_.joinable()) {
+            return false;
+        }
+        queue_.emplace_back(std::move(job), std::chrono::steady_clock::now());
+    }
+    wake_.notify_one();
+    return true;
+}
+
+void EmbedBatcher::loop() {
+    setThreadName("Embed");
+
+    while (true) {
+        std::vector<Job> batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                break;  // stopping with nothing left to embed
+            }
+            // Give other workers until the oldest job's deadline to fill the batch.
+            const auto deadline = queue_.front().second + maxDelay_;
+            wake_.wait_until(lock, deadline, [&] { return stopping_ || queue_.size() >= maxBatch_; });
+
+            const std::size_t count = std::min(maxBatch_, queue_.size());
+            batch.reserve(count);
+            for (std::size_t i = 0; i < count; ++i) {
+                batch.push_back(std::move(queue_.front().first));
+                queue_.pop_front();
+            }
+        }
+        space_.notify_all();
+
+        std::vector<std::string> texts;
+        texts.reserve(batch.size());
+        for (const auto& job : batch) {
+            texts.push_back(job.text);
+        }
+        auto results = runner_->embedBatch(texts);
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            complete_(batch[i], i < results.size() ? results[i] : EmbedResult{false, {}, "Missing embedding result"});
+        }
+    }
+}
+
+}
@@ -0,0 +1,93 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "nrvna/finalizer.hpp"
+#include "nrvna/logger.hpp"
+#include <algorithm>
+#include <string>
+
+namespace nrvna {
+
+Finalizer::Finalizer(std::size_t threads, std::size_t capacity) noexcept
+    : threadCount_(std::max<std::size_t>(1, threads)), capacity_(std::max<std::size_t>(1, capacity)) {}
+
+Finalizer::~Finalizer() {
+    stop();
+}
+
+bool Finalizer::start() noexcept {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!threads_.empty()) {
+        return true;
+    }
+    stopping_ = false;
+    try {
+        for (std::size_t i = 0; i < threadCount_; ++i) {
+            threads_.emplace_back(&Finalizer::loop, this);
+        }
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to start finalizer: " + std::string(e.what()));
+        lock.unlock();
+        stop();
+        return false;
+    }
+    LOG_INFO("Finalizer: " + std::to_string(threadCount_) + " threads, queue of " + std::to_string(capacity_));
+    return true;
+}
+
+void Finalizer::stop() noexcept {
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        threads.swap(threads_);
+    }
+    wake_.notify_all();
+    space_.notify_all();
+    for (auto& thread : threads) {
+        if (thread.joinable()) thread.join();
+    }
+}
+
+bool Finalizer::submit(Task task) {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        space_.wait(lock, [&] { return stopping_ || queue_.size() < capacity_; });
+        if (stopping_ || threads_.empty()) {
+            return false;
+        }
+        queue_.push_back(std::move(task));
+    }
+    wake_.notify_one();
+    return true;
+}
+
+void Finalizer::loop() {
+    setThreadName("Finalize");
+
+    while (true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                break;  // stopping with nothing left to publish
+            }
+            task = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        space_.notify_one();
+        try {
+            task();
+        } catch (const std::exception& e) {
+            LOG_ERROR("Finalize task failed: " + std::string(e.what()));
+        } catch (...) {
+            LOG_ERROR("Finalize task failed");
+        }
+    }
+}
+
+}
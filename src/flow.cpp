@@ -7,10 +7,14 @@
 #include "nrvna/flow.hpp"
 #include "nrvna/contract.hpp"
 #include "nrvna/scanner.hpp"
+#include "nrvna/scheduler.hpp"
 #include "nrvna/logger.hpp"
 #include <fstream>
 #include <algorithm>
 #include <cctype>
+#include <cstdlib>
+#include <map>
+#include <set>
 
 namespace nrvna {
 
@@ -36,8 +40,8 @@ std::optional<Job> Flow::get(const JobId& id) const noexcept {
             auto outputDir = contract::jobDir(workspace_, Status::Done, id);
             auto artifact = contract::findOutputArtifact(outputDir);
             if (!artifact) {
-                LOG_DEBUG("No result file found for job: " + id);
-                return std::nullopt;
+                // Archived, possibly while we looked.
+                return getArchived(id);
             }
 
             std::string content;
@@ -100,7 +104,15 @@ std::optional<Job> Flow::get(const JobId& id) const noexcept {
             }
             return Job{id, Status::Failed, errorContent, partial, sctp};
 
-        } else if (jobStatus == Status::Queued || jobStatus == Status::Running) {
+        } else if (jobStatus == Status::Running) {
+            auto sctp = std::chrono::system_clock::now();
+            std::optional<std::string> streamed = std::nullopt;
+            std::error_code ec;
+            if (std::filesystem::exists(contract::jobDir(workspace_, Status::Running, id) / contract::kPartialFile, ec)) {
+                streamed = partial(id);
+            }
+            return Job{id, jobStatus, "", streamed, sctp};
+        } else if (jobStatus == Status::Queued) {
             auto sctp = std::chrono::system_clock::now();
             return Job{id, jobStatus, "", std::nullopt, sctp};
         }
@@ -116,6 +128,27 @@ std::optional<Job> Flow::get(const JobId& id) const noexcept {
 std::vector<Job> Flow::list(std::size_t max) const noexcept {
     std::vector<Job> jobs;
     try {
+        if (const JobIndex* idx = index()) {
+            // Widen the window past jobs deleted by hand, which the index
+            // keeps until its next rebuild.
+            for (std::size_t want = max;;) {
+                const auto ids = idx->recent(want);
+                jobs.clear();
+                for (const auto& id : ids) {
+                    const auto* entry = idx->find(id);
+                    // The journal may lag a queued or running job's directory.
+                    const Status state = present(id, entry->state) ? entry->state : status(id);
+                    if (state == Status::Missing) continue;
+                    const auto sctp = std::chrono::system_clock::time_point(std::chrono::microseconds(entry->time_us));
+                    jobs.push_back({id, state, "", "", sctp});
+                    if (jobs.size() == max) break;
+                }
+                if (jobs.size() == max || ids.size() < want) break;
+                want += max - jobs.size();
+            }
+            return jobs;
+        }
+
         const std::pair<std::filesystem::path, Status> dirs[] = {
             {contract::stateDir(workspace_, Status::Done),    Status::Done},
             {contract::stateDir(workspace_, Status::Failed),  Status::Failed},
@@ -135,6 +168,11 @@ std::vector<Job> Flow::list(std::size_t max) const noexcept {
                 }
             }
         }
+        const Archive& archived = archive();
+        for (const auto& id : archived.ids()) {
+            const auto sctp = std::chrono::system_clock::time_point(std::chrono::microseconds(*archived.time(id)));
+            jobs.push_back({id, Status::Done, "", "", sctp});
+        }
 
         std::sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) {
             return a.timestamp > b.timestamp;
@@ -154,6 +192,15 @@ std::vector<Job> Flow::list(std::size_t max) const noexcept {
 Status Flow::status(const JobId& id) const noexcept {
     try {
         if (!contract::isValidJobId(id)) return Status::Missing;
+        // A terminal state in an index this Flow already holds is final, so
+        // one probe confirms it.
+        if (index_) {
+            const auto* entry = index_->find(id);
+            if (entry && (entry->state == Status::Done || entry->state == Status::Failed) &&
+                std::filesystem::exists(contract::jobDir(workspace_, entry->state, id))) {
+                return entry->state;
+            }
+        }
         // Check upstream states first: jobs move queued → running → done/failed,
         // so a mid-check rename is re-observed downstream instead of reading as
         // Missing (which callers like `flw -w` treat as terminal).
@@ -170,6 +217,10 @@ Status Flow::status(const JobId& id) const noexcept {
             return Status::Failed;
         }
 
+        if (archive().contains(id)) {
+            return Status::Done;
+        }
+
         return Status::Missing;
 
     } catch (...) {
@@ -196,12 +247,171 @@ std::optional<JobMeta> Flow::meta(const JobId& id) const noexcept {
                 }
             }
         }
+        if (auto text = archive().readFile(id, contract::kMetaFile)) {
+            return parseMetaJson(*text);
+        }
         return std::nullopt;
     } catch (...) {
         return std::nullopt;
     }
 }
 
+std::optional<contract::Artifact> Flow::artifact(const JobId& id) const noexcept {
+    try {
+        if (!contract::isValidJobId(id)) return std::nullopt;
+        if (auto artifact = contract::findOutputArtifact(contract::jobDir(workspace_, Status::Done, id))) {
+            return artifact;
+        }
+        const auto names = archive().files(id);
+        auto kind = contract::primaryArtifact([&](const char* name) {
+            return std::find(names.begin(), names.end(), name) != names.end();
+        });
+        if (!kind) return std::nullopt;
+        return contract::Artifact{*kind, {}};
+    } catch (...) {
+        return std::nullopt;
+    }
+}
+
+// True if meta carries tag or has parent as its parent.
+static bool inSet(const JobMeta& meta, const std::string& tag, const JobId& parent) {
+    if (!tag.empty() && std::find(meta.tags.begin(), meta.tags.end(), tag) != meta.tags.end()) return true;
+    return !parent.empty() && meta.parent == parent;
+}
+
+// Record every job in state s whose meta.json puts it in the set.
+static void scanState(const std::filesystem::path& workspace, Status s, const std::string& tag,
+                      const JobId& parent, std::map<JobId, Status>& found) {
+    auto dir = contract::stateDir(workspace, s);
+    std::error_code ec;
+    if (!std::filesystem::exists(dir, ec) || ec) return;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        if (!entry.is_directory()) continue;
+        auto id = entry.path().filename().string();
+        if (!contract::isValidJobId(id)) continue;
+        auto meta = readMetaJson(entry.path());
+        if (meta && inSet(*meta, tag, parent)) found[id] = s;
+    }
+}
+
+std::vector<SetMatch> Flow::select(const std::string& tag, const JobId& parent) const noexcept {
+    try {
+        const JobIndex* idx = index();
+        if (!idx) {
+            return scanSelect(tag, parent);
+        }
+        // Queued and running jobs are few and their journal lines can lag
+        // the submit or claim, so read them directly; the index answers for
+        // the rest.
+        std::map<JobId, Status> found;
+        scanState(workspace_, Status::Queued, tag, parent, found);
+        scanState(workspace_, Status::Running, tag, parent, found);
+        std::set<JobId> ids;
+        if (!tag.empty()) {
+            for (auto& id : idx->tagged(tag)) ids.insert(std::move(id));
+        }
+        if (!parent.empty()) {
+            for (auto& id : idx->children(parent)) ids.insert(std::move(id));
+        }
+        for (const auto& id : ids) {
+            const Status indexed = idx->find(id)->state;
+            const Status state = present(id, indexed) ? indexed : status(id);
+            if (state != Status::Missing) found[id] = state;
+        }
+        std::vector<SetMatch> matches;
+        matches.reserve(found.size());
+        for (const auto& [id, s] : found) matches.push_back({id, s});
+        return matches;  // std::map iterates id-sorted
+    } catch (const std::exception& e) {
+        LOG_ERROR("Error selecting jobs: " + std::string(e.what()));
+        return {};
+    }
+}
+
+std::vector<SetMatch> Flow::scanSelect(const std::string& tag, const JobId& parent) const {
+    // Scan upstream states first (queued → running → done → failed): jobs
+    // move downstream between scans, so a mid-scan transition is re-observed
+    // in a later directory instead of slipping through. Later sightings win.
+    std::map<JobId, Status> found;
+    for (Status s : {Status::Queued, Status::Running, Status::Done, Status::Failed}) {
+        scanState(workspace_, s, tag, parent, found);
+    }
+    const Archive& archived = archive();
+    for (const auto& id : archived.ids()) {
+        if (found.count(id) > 0) continue;
+        auto text = archived.readFile(id, contract::kMetaFile);
+        auto meta = text ? parseMetaJson(*text) : std::nullopt;
+        if (meta && inSet(*meta, tag, parent)) found[id] = Status::Done;
+    }
+    std::vector<SetMatch> matches;
+    matches.reserve(found.size());
+    for (const auto& [id, s] : found) matches.push_back({id, s});
+    return matches;  // std::map iterates id-sorted
+}
+
+bool Flow::present(const JobId& id, Status state) const {
+    if (state != Status::Done && state != Status::Failed) return false;
+    std::error_code ec;
+    if (std::filesystem::exists(contract::jobDir(workspace_, state, id), ec)) return true;
+    return state == Status::Done && archive().contains(id);
+}
+
+const Archive& Flow::archive() const {
+    if (!archive_) {
+        archive_.emplace(workspace_);
+    }
+    archive_->refresh();
+    return *archive_;
+}
+
+std::optional<Job> Flow::getArchived(const JobId& id) const {
+    const Archive& archived = archive();
+    const auto names = archived.files(id);
+    auto kind = contract::primaryArtifact([&](const char* name) {
+        return std::find(names.begin(), names.end(), name) != names.end();
+    });
+    auto data = kind ? archived.readFile(id, contract::fileName(*kind)) : std::nullopt;
+    if (!data) {
+        LOG_DEBUG("No result file found for job: " + id);
+        return std::nullopt;
+    }
+
+    // Match what the directory readers return.
+    std::string content = std::move(*data);
+    if (*kind == contract::ArtifactKind::Result && !content.empty() && content.back() == '\n') {
+        content.pop_back();
+    } else if (*kind == contract::ArtifactKind::Embedding && !content.empty() && content.back() != '\n') {
+        content += '\n';
+    }
+    const auto sctp = std::chrono::system_clock::time_point(std::chrono::microseconds(archived.time(id).value_or(0)));
+    return Job{id, Status::Done, content, std::nullopt, sctp};
+}
+
+const JobIndex* Flow::index() const {
+    if (!indexTried_) {
+        indexTried_ = true;
+        index_.emplace(workspace_);
+        if (!index_->load()) {
+            index_.reset();
+        }
+    } else if (index_) {
+        index_->refresh();
+    }
+    return index_ ? &*index_ : nullptr;
+}
+
+std::string Flow::partial(const JobId& id, std::size_t offset) const noexcept {
+    try {
+        if (!contract::isValidJobId(id)) return "";
+        std::ifstream file(contract::jobDir(workspace_, Status::Running, id) / contract::kPartialFile,
+                           std::ios::binary);
+        if (!file || !file.seekg(static_cast<std::streamoff>(offset))) return "";
+        return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    } catch (...) {
+        return "";
+    }
+}
+
 static std::size_t countSubdirs(const std::filesystem::path& dir) noexcept {
     std::size_t n = 0;
     try {
@@ -216,15 +426,62 @@ static std::size_t countSubdirs(const std::filesystem::path& dir) noexcept {
     return n;
 }
 
+std::optional<ReclaimStats> Flow::reclaimed() const noexcept {
+    return readReclaimStats(workspace_);
+}
+
 WorkspaceCounts Flow::counts() const noexcept {
     WorkspaceCounts c;
     c.queued  = Scanner(workspace_).readyJobCount();
     c.running = countSubdirs(contract::stateDir(workspace_, Status::Running));
-    c.done    = countSubdirs(contract::stateDir(workspace_, Status::Done));
+    // failed/ stays small and decides flw -W's exit code, so it is counted
+    // directly rather than trusting a journal line that may not be written yet.
+    const JobIndex* idx = nullptr;
+    std::size_t archived = 0;
+    try {
+        idx = index();
+        if (!idx) archived = archive().size();
+    } catch (...) {}
+    c.done    = idx ? idx->count(Status::Done)
+                    : countSubdirs(contract::stateDir(workspace_, Status::Done)) + archived;
     c.failed  = countSubdirs(contract::stateDir(workspace_, Status::Failed));
     return c;
 }
 
+std::vector<GroupQueue> Flow::groups() const noexcept {
+    std::vector<GroupQueue> out;
+    try {
+        std::map<std::string, GroupQueue> byGroup;
+        const auto nowUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        for (Status state : {Status::Queued, Status::Running}) {
+            const auto dir = contract::stateDir(workspace_, state);
+            std::error_code ec;
+            for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+                const std::string id = entry.path().filename().string();
+                if (!contract::isValidJobId(id) || !entry.is_directory(ec)) continue;
+                auto meta = readMetaJson(entry.path());
+                const std::string group = meta ? fairShareGroup(*meta) : "";
+                GroupQueue& queue = byGroup[group];
+                queue.group = group;
+                if (state == Status::Running) {
+                    ++queue.running;
+                    continue;
+                }
+                ++queue.queued;
+                // Job IDs start with the submission time in microseconds.
+                const long long submittedUs = std::atoll(id.c_str());
+                if (submittedUs > 0 && nowUs > submittedUs) {
+                    queue.oldest_wait_s = std::max(queue.oldest_wait_s, (nowUs - submittedUs) / 1e6);
+                }
+            }
+        }
+        out.reserve(byGroup.size());
+        for (auto& [group, queue] : byGroup) out.push_back(std::move(queue));
+    } catch (...) {}
+    return out;
+}
+
 std::string Flow::readResultContent(const JobId& id) const {
     auto resultFile = contract::jobDir(workspace_, Status::Done, id) / contract::kResultFile;
     std::ifstream file(resultFile);
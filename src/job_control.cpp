@@ -0,0 +1,65 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "nrvna/job_control.hpp"
+#include <sstream>
+
+namespace nrvna {
+
+namespace {
+constexpr auto kPollInterval = std::chrono::milliseconds(50);
+}
+
+JobControl::JobControl(std::filesystem::path cancelFile, double timeoutSeconds) noexcept
+    : cancelFile_(std::move(cancelFile)),
+      timeout_(timeoutSeconds > 0.0 ? timeoutSeconds : 0.0),
+      deadline_(std::chrono::steady_clock::now() +
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(timeout_))) {}
+
+bool JobControl::stopRequested() noexcept {
+    if (state_.load(std::memory_order_relaxed) != kRunning) {
+        return true;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    if (timeout_ > 0.0 && now >= deadline_) {
+        return stop(kExpired);
+    }
+
+    // Only one caller per interval pays for the stat; compute threads race here.
+    const int64_t ticks = now.time_since_epoch().count();
+    int64_t due = nextPoll_.load(std::memory_order_relaxed);
+    if (ticks < due ||
+        !nextPoll_.compare_exchange_strong(due, (now + kPollInterval).time_since_epoch().count())) {
+        return false;
+    }
+    std::error_code ec;
+    if (std::filesystem::exists(cancelFile_, ec)) {
+        return stop(kCancelled);
+    }
+    return false;
+}
+
+bool JobControl::stop(State state) noexcept {
+    int expected = kRunning;
+    state_.compare_exchange_strong(expected, state);
+    return true;
+}
+
+std::string JobControl::reason() const {
+    if (state_.load() == kExpired) {
+        std::ostringstream out;
+        out << "Job exceeded its " << timeout_ << "s deadline";
+        return out.str();
+    }
+    return "Job cancelled";
+}
+
+bool JobControl::abortCallback(void* data) noexcept {
+    return data && static_cast<JobControl*>(data)->stopRequested();
+}
+
+}
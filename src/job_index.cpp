@@ -0,0 +1,539 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "nrvna/job_index.hpp"
+#include "nrvna/archive.hpp"
+#include "nrvna/contract.hpp"
+#include "nrvna/logger.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace nrvna {
+
+namespace {
+
+constexpr const char* kIndexHeader = "nrvna-index";
+constexpr int kIndexVersion = 1;
+
+int64_t nowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::optional<Status> parseState(const std::string& s) {
+    for (Status state : {Status::Queued, Status::Running, Status::Done, Status::Failed, Status::Missing}) {
+        if (s == contract::toString(state)) return state;
+    }
+    return std::nullopt;
+}
+
+bool isTerminal(Status s) {
+    return s == Status::Done || s == Status::Failed;
+}
+
+// The journal moves here while a rotation folds its tail into the snapshot.
+std::filesystem::path rotatedJournal(const std::filesystem::path& workspace) {
+    return workspace / contract::kRotatedJournalFile;
+}
+
+bool fileIdentity(const std::filesystem::path& path, uint64_t& inode, uint64_t& size) {
+    struct stat st{};
+    if (::stat(path.c_str(), &st) != 0) return false;
+    inode = static_cast<uint64_t>(st.st_ino);
+    size = static_cast<uint64_t>(st.st_size);
+    return true;
+}
+
+}
+
+namespace journal {
+
+std::string format(const JournalRecord& record) {
+    std::string line = std::to_string(record.time_us);
+    line += '\t';
+    line += contract::toString(record.state);
+    line += '\t';
+    line += record.id;
+    line += '\t';
+    line += record.parent;
+    line += '\t';
+    for (std::size_t i = 0; i < record.tags.size(); ++i) {
+        if (i > 0) line += ',';
+        line += record.tags[i];
+    }
+    line += '\n';
+    return line;
+}
+
+std::optional<JournalRecord> parse(const std::string& line) {
+    std::vector<std::string> fields;
+    std::size_t start = 0;
+    while (true) {
+        auto tab = line.find('\t', start);
+        fields.push_back(line.substr(start, tab == std::string::npos ? std::string::npos : tab - start));
+        if (tab == std::string::npos) break;
+        start = tab + 1;
+    }
+    if (fields.size() != 5) return std::nullopt;
+
+    JournalRecord record;
+    try {
+        std::size_t used = 0;
+        record.time_us = std::stoll(fields[0], &used);
+        if (used != fields[0].size()) return std::nullopt;
+    } catch (...) {
+        return std::nullopt;
+    }
+    auto state = parseState(fields[1]);
+    if (!state || !contract::isValidJobId(fields[2])) return std::nullopt;
+    if (!fields[3].empty() && !contract::isValidJobId(fields[3])) return std::nullopt;
+    record.state = *state;
+    record.id = fields[2];
+    record.parent = fields[3];
+
+    std::istringstream tags(fields[4]);
+    std::string tag;
+    while (std::getline(tags, tag, ',')) {
+        if (!tag.empty()) record.tags.push_back(tag);
+    }
+    return record;
+}
+
+bool append(const std::filesystem::path& workspace, const JobId& id, Status state,
+            const std::optional<JobMeta>& meta) noexcept {
+    try {
+        JournalRecord record;
+        record.id = id;
+        record.state = state;
+        record.time_us = nowMicros();
+        if (meta) {
+            record.parent = meta->parent;
+            record.tags = meta->tags;
+        }
+        const std::string line = format(record);
+        const auto path = workspace / contract::kJournalFile;
+
+        // The shared lock holds off a rotation between our open and write;
+        // if one slipped in before the lock, the path names a new file.
+        for (int attempt = 0; attempt < 3; ++attempt) {
+            const int fd = ::open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+            if (fd < 0) {
+                LOG_DEBUG("Cannot open journal: " + std::string(std::strerror(errno)));
+                return false;
+            }
+            ::flock(fd, LOCK_SH);
+            struct stat opened{}, current{};
+            if (::fstat(fd, &opened) == 0 && ::stat(path.c_str(), &current) == 0 &&
+                opened.st_ino == current.st_ino) {
+                // One write() per line; O_APPEND keeps concurrent lines whole.
+                const bool ok = ::write(fd, line.data(), line.size()) == static_cast<ssize_t>(line.size());
+                ::close(fd);
+                return ok;
+            }
+            ::close(fd);
+        }
+        return false;
+    } catch (...) {
+        return false;
+    }
+}
+
+}
+
+JobIndex::JobIndex(std::filesystem::path workspace) noexcept
+    : workspace_(std::move(workspace)) {}
+
+bool JobIndex::load() {
+    std::ifstream in(workspace_ / contract::kIndexFile);
+    if (!in) {
+        return false;
+    }
+    std::string header;
+    std::getline(in, header);
+    std::istringstream fields(header);
+    std::string magic;
+    int version = 0;
+    int64_t generation = 0;
+    uint64_t inode = 0;
+    uint64_t offset = 0;
+    if (!(fields >> magic >> version >> generation >> inode >> offset) || magic != kIndexHeader ||
+        version != kIndexVersion) {
+        LOG_WARN("Ignoring unreadable job index: " + (workspace_ / contract::kIndexFile).string());
+        return false;
+    }
+
+    generation_ = generation;
+    entries_.clear();
+    byTag_.clear();
+    byParent_.clear();
+    counts_.fill(0);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (auto record = journal::parse(line)) apply(*record);
+    }
+
+    // A rotation that stopped before its snapshot leaves the tail we need
+    // in the rotated file.
+    uint64_t rotatedInode = 0;
+    uint64_t rotatedSize = 0;
+    if (inode != 0 && fileIdentity(rotatedJournal(workspace_), rotatedInode, rotatedSize) && rotatedInode == inode) {
+        replay(rotatedInode, offset);
+        offset = 0;
+    }
+
+    uint64_t journalInode = 0;
+    uint64_t journalSize = 0;
+    if (!fileIdentity(workspace_ / contract::kJournalFile, journalInode, journalSize)) {
+        journalInode_ = 0;
+        journalOffset_ = 0;
+        return true;
+    }
+    replay(journalInode, journalInode == inode ? offset : 0);
+    return true;
+}
+
+bool JobIndex::refresh() {
+    // A rotation since load() moved lines we have not read into a new
+    // snapshot; inode numbers alone cannot tell, as the new journal may
+    // reuse the old one's.
+    {
+        std::ifstream in(workspace_ / contract::kIndexFile);
+        std::string magic;
+        int version = 0;
+        int64_t generation = 0;
+        if (in >> magic >> version >> generation && magic == kIndexHeader && version == kIndexVersion &&
+            generation != generation_) {
+            return load();
+        }
+    }
+    uint64_t inode = 0;
+    uint64_t size = 0;
+    if (!fileIdentity(workspace_ / contract::kJournalFile, inode, size)) {
+        return false;
+    }
+    if (inode == journalInode_ && size <= journalOffset_) {
+        return false;
+    }
+    return replay(inode, inode == journalInode_ ? journalOffset_ : 0);
+}
+
+bool JobIndex::replay(uint64_t inode, uint64_t offset) {
+    // The file may have moved aside for a rotation since it was stat'ed.
+    uint64_t currentInode = 0;
+    uint64_t size = 0;
+    std::filesystem::path source = workspace_ / contract::kJournalFile;
+    if (!fileIdentity(source, currentInode, size) || currentInode != inode) {
+        source = rotatedJournal(workspace_);
+        if (!fileIdentity(source, currentInode, size) || currentInode != inode) {
+            return false;
+        }
+    }
+    std::ifstream in(source, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    in.seekg(static_cast<std::streamoff>(offset));
+
+    bool applied = false;
+    std::string line;
+    uint64_t consumed = offset;
+    // Only whole lines: a line still being written is read next time.
+    while (std::getline(in, line) && !in.eof()) {
+        consumed += line.size() + 1;
+        if (auto record = journal::parse(line)) {
+            apply(*record);
+            applied = true;
+        }
+    }
+    journalInode_ = inode;
+    journalOffset_ = consumed;
+    return applied;
+}
+
+void JobIndex::rebuild() {
+    // Lines appended during the scan are replayed afterwards.
+    uint64_t inode = 0;
+    uint64_t size = 0;
+    if (!fileIdentity(workspace_ / contract::kJournalFile, inode, size)) {
+        inode = 0;
+        size = 0;
+    }
+
+    generation_ = nowMicros();
+    entries_.clear();
+    byTag_.clear();
+    byParent_.clear();
+    counts_.fill(0);
+    for (Status state : {Status::Queued, Status::Running, Status::Done, Status::Failed}) {
+        std::error_code ec;
+        for (std::filesystem::directory_iterator it(contract::stateDir(workspace_, state), ec), end;
+             !ec && it != end; it.increment(ec)) {
+            const auto id = it->path().filename().string();
+            if (!contract::isValidJobId(id)) continue;
+
+            JournalRecord record;
+            record.id = id;
+            record.state = state;
+            std::error_code timeEc;
+            const auto mtime = std::filesystem::last_write_time(it->path(), timeEc);
+            if (!timeEc) {
+                // file_time_type's epoch is unspecified; map through now().
+                const auto age = std::filesystem::file_time_type::clock::now() - mtime;
+                record.time_us = nowMicros() - std::chrono::duration_cast<std::chrono::microseconds>(age).count();
+            }
+            if (auto meta = readMetaJson(it->path())) {
+                record.parent = meta->parent;
+                record.tags = meta->tags;
+            }
+            apply(record);
+        }
+    }
+
+    Archive archive(workspace_);
+    archive.refresh();
+    for (const auto& id : archive.ids()) {
+        JournalRecord record;
+        record.id = id;
+        record.state = Status::Done;
+        record.time_us = archive.time(id).value_or(0);
+        if (auto text = archive.readFile(id, contract::kMetaFile)) {
+            if (auto meta = parseMetaJson(*text)) {
+                record.parent = meta->parent;
+                record.tags = meta->tags;
+            }
+        }
+        apply(record);
+    }
+    journalInode_ = inode;
+    journalOffset_ = size;
+}
+
+bool JobIndex::save(std::uintmax_t maxJournalBytes) {
+    const auto journalPath = workspace_ / contract::kJournalFile;
+    const auto rotatedPath = rotatedJournal(workspace_);
+
+    uint64_t inode = 0;
+    uint64_t size = 0;
+    if (maxJournalBytes > 0 && fileIdentity(journalPath, inode, size) && size > maxJournalBytes) {
+        std::error_code ec;
+        std::filesystem::rename(journalPath, rotatedPath, ec);
+        if (ec) {
+            LOG_WARN("Cannot rotate journal: " + ec.message());
+        } else {
+            // Wait out appends that opened the journal before the rename.
+            const int fd = ::open(rotatedPath.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd >= 0) {
+                ::flock(fd, LOCK_EX);
+            }
+            replay(inode, inode == journalInode_ ? journalOffset_ : 0);
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            // Whatever has been appended since starts a new file.
+            generation_ = nowMicros();
+            journalInode_ = 0;
+            journalOffset_ = 0;
+        }
+    }
+
+    const auto indexPath = workspace_ / contract::kIndexFile;
+    const auto tmpPath = indexPath.string() + ".tmp";
+    try {
+        {
+            std::ofstream out(tmpPath, std::ios::trunc);
+            if (!out) {
+                LOG_WARN("Cannot write job index: " + tmpPath);
+                return false;
+            }
+            out << kIndexHeader << ' ' << kIndexVersion << ' ' << generation_ << ' ' << journalInode_ << ' '
+                << journalOffset_ << '\n';
+            for (const auto& [id, entry] : entries_) {
+                JournalRecord record{id, entry.state, entry.time_us, entry.parent, entry.tags};
+                out << journal::format(record);
+            }
+            out.flush();
+            if (!out) {
+                LOG_WARN("Failed writing job index: " + tmpPath);
+                return false;
+            }
+        }
+        std::filesystem::rename(tmpPath, indexPath);
+    } catch (const std::exception& e) {
+        LOG_WARN("Failed to save job index: " + std::string(e.what()));
+        std::error_code ec;
+        std::filesystem::remove(tmpPath, ec);
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::remove(rotatedPath, ec);
+    return true;
+}
+
+void JobIndex::apply(const JournalRecord& record) {
+    auto found = entries_.find(record.id);
+    if (record.state == Status::Missing) {
+        if (found != entries_.end()) {
+            unlink(record.id, found->second);
+            entries_.erase(found);
+        }
+        return;
+    }
+
+    Entry entry;
+    if (found != entries_.end()) {
+        // Terminal states are final; a late queued or running line (the
+        // submitter and a worker race to append) must not revive the job.
+        if (isTerminal(found->second.state) && !isTerminal(record.state)) {
+            return;
+        }
+        entry = found->second;
+        unlink(record.id, found->second);
+    }
+    entry.state = record.state;
+    entry.time_us = std::max(entry.time_us, record.time_us);
+    // Later transitions are journaled without metadata; keep what we have.
+    if (!record.parent.empty()) entry.parent = record.parent;
+    if (!record.tags.empty()) entry.tags = record.tags;
+
+    for (const auto& tag : entry.tags) {
+        byTag_[tag].insert(record.id);
+    }
+    if (!entry.parent.empty()) {
+        byParent_[entry.parent].insert(record.id);
+    }
+    ++counts_[static_cast<std::size_t>(entry.state)];
+    entries_[record.id] = std::move(entry);
+}
+
+void JobIndex::unlink(const JobId& id, const Entry& entry) {
+    for (const auto& tag : entry.tags) {
+        auto set = byTag_.find(tag);
+        if (set == byTag_.end()) continue;
+        set->second.erase(id);
+        if (set->second.empty()) byTag_.erase(set);
+    }
+    if (!entry.parent.empty()) {
+        auto set = byParent_.find(entry.parent);
+        if (set != byParent_.end()) {
+            set->second.erase(id);
+            if (set->second.empty()) byParent_.erase(set);
+        }
+    }
+    --counts_[static_cast<std::size_t>(entry.state)];
+}
+
+const JobIndex::Entry* JobIndex::find(const JobId& id) const {
+    auto found = entries_.find(id);
+    return found == entries_.end() ? nullptr : &found->second;
+}
+
+std::vector<JobId> JobIndex::tagged(const std::string& tag) const {
+    auto found = byTag_.find(tag);
+    if (found == byTag_.end()) return {};
+    return {found->second.begin(), found->second.end()};
+}
+
+std::vector<JobId> JobIndex::children(const JobId& parent) const {
+    auto found = byParent_.find(parent);
+    if (found == byParent_.end()) return {};
+    return {found->second.begin(), found->second.end()};
+}
+
+std::vector<JobId> JobIndex::recent(std::size_t n) const {
+    std::vector<std::pair<int64_t, JobId>> all;
+    all.reserve(entries_.size());
+    for (const auto& [id, entry] : entries_) {
+        all.emplace_back(entry.time_us, id);
+    }
+    n = std::min(n, all.size());
+    std::partial_sort(all.begin(), all.begin() + static_cast<std::ptrdiff_t>(n), all.end(),
+                      [](const auto& a, const auto& b) { return a > b; });
+    std::vector<JobId> ids;
+    ids.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        ids.push_back(std::move(all[i].second));
+    }
+    return ids;
+}
+
+std::size_t JobIndex::count(Status state) const noexcept {
+    return counts_[static_cast<std::size_t>(state)];
+}
+
+IndexKeeper::IndexKeeper(std::filesystem::path workspace, std::chrono::seconds interval,
+                         std::uintmax_t maxJournalBytes) noexcept
+    : index_(std::move(workspace)), interval_(interval), maxJournalBytes_(maxJournalBytes) {}
+
+IndexKeeper::~IndexKeeper() {
+    stop();
+}
+
+bool IndexKeeper::start() noexcept {
+    try {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (thread_.joinable()) {
+            return true;
+        }
+        stopping_ = false;
+        thread_ = std::thread(&IndexKeeper::loop, this);
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to start index keeper: " + std::string(e.what()));
+        return false;
+    }
+}
+
+void IndexKeeper::stop() noexcept {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void IndexKeeper::loop() {
+    setThreadName("Index");
+
+    try {
+        if (!index_.load()) {
+            index_.rebuild();
+            if (index_.save(maxJournalBytes_)) {
+                LOG_INFO("Rebuilt job index: " + std::to_string(index_.size()) + " jobs");
+            }
+        }
+        if (index_.refresh()) {
+            (void)index_.save(maxJournalBytes_);
+        }
+
+        bool stopping = false;
+        while (!stopping) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait_for(lock, interval_, [&] { return stopping_; });
+                stopping = stopping_;
+            }
+            if (index_.refresh()) {
+                (void)index_.save(maxJournalBytes_);
+            }
+        }
+    } catch (const std::exception& e) {
+        LOG_WARN("Index keeper stopped: " + std::string(e.what()));
+    }
+}
+
+}
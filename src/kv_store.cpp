@@ -0,0 +1,301 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "nrvna/kv_store.hpp"
+#include "nrvna/hash.hpp"
+#include "nrvna/logger.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <unistd.h>
+
+namespace nrvna {
+
+namespace {
+
+constexpr char kMagic[8] = {'N', 'R', 'V', 'K', 'V', '0', '0', '2'};
+constexpr char kMagicV1[8] = {'N', 'R', 'V', 'K', 'V', '0', '0', '1'};  // no model identity
+constexpr uint64_t kMaxIdentity = 256;
+constexpr const char* kSnapshotExt = ".kv";
+
+}
+
+KvSnapshotStore::KvSnapshotStore(std::filesystem::path dir, std::size_t budgetBytes)
+    : dir_(std::move(dir)), budget_(budgetBytes) {
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+    if (ec) {
+        throw std::runtime_error("Cannot create KV snapshot directory " + dir_.string() + ": " + ec.message());
+    }
+
+    for (const auto& item : std::filesystem::directory_iterator(dir_, ec)) {
+        const auto& path = item.path();
+        if (path.extension() != kSnapshotExt) {
+            // Leftover temp files from an interrupted save.
+            if (path.extension() == ".tmp") std::filesystem::remove(path, ec);
+            continue;
+        }
+        try {
+            index_.insert(std::stoull(path.stem().string(), nullptr, 16));
+        } catch (const std::exception&) {
+            continue;
+        }
+    }
+    LOG_INFO("KV snapshots: " + std::to_string(index_.size()) + " in " + dir_.string());
+    writer_ = std::thread(&KvSnapshotStore::writerLoop, this);
+}
+
+KvSnapshotStore::~KvSnapshotStore() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+}
+
+std::string KvSnapshotStore::modelIdentity(const std::filesystem::path& modelPath) {
+    std::error_code ec;
+    const auto canonical = std::filesystem::weakly_canonical(modelPath, ec).string();
+    const auto size = std::filesystem::file_size(modelPath, ec);
+    const auto mtime = std::filesystem::last_write_time(modelPath, ec).time_since_epoch().count();
+
+    const std::string key = canonical + "\n" + std::to_string(size) + "\n" + std::to_string(mtime);
+    std::vector<int32_t> bytes(key.begin(), key.end());
+    return hex64(PrefixCache::hashTokens(bytes.data(), bytes.size()));
+}
+
+std::filesystem::path KvSnapshotStore::pathFor(uint64_t hash) const {
+    return dir_ / (hex64(hash) + kSnapshotExt);
+}
+
+bool KvSnapshotStore::contains(uint64_t hash) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return index_.count(hash) > 0 || pending_.count(hash) > 0;
+}
+
+std::shared_ptr<PrefixEntry> KvSnapshotStore::readFile(const std::filesystem::path& path, bool tokensOnly) noexcept {
+    try {
+        std::ifstream file(path, std::ios::binary);
+        char magic[sizeof(kMagic)] = {};
+        if (!file.read(magic, sizeof(magic))) {
+            LOG_WARN("Ignoring invalid KV snapshot: " + path.string());
+            return nullptr;
+        }
+        auto entry = std::make_shared<PrefixEntry>();
+        const bool v1 = std::memcmp(magic, kMagicV1, sizeof(kMagicV1)) == 0;
+        uint64_t idSize = 0;
+        if (!v1 && (std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+                    !file.read(reinterpret_cast<char*>(&idSize), sizeof(idSize)) || idSize > kMaxIdentity)) {
+            LOG_WARN("Ignoring invalid KV snapshot: " + path.string());
+            return nullptr;
+        }
+        entry->model.resize(idSize);
+        uint64_t nTokens = 0;
+        if (!file.read(entry->model.data(), static_cast<std::streamsize>(idSize)) ||
+            !file.read(reinterpret_cast<char*>(&nTokens), sizeof(nTokens)) || nTokens == 0) {
+            LOG_WARN("Ignoring invalid KV snapshot: " + path.string());
+            return nullptr;
+        }
+
+        entry->tokens.resize(nTokens);
+        if (!file.read(reinterpret_cast<char*>(entry->tokens.data()),
+                       static_cast<std::streamsize>(nTokens * sizeof(int32_t)))) {
+            LOG_WARN("Truncated KV snapshot: " + path.string());
+            return nullptr;
+        }
+        if (tokensOnly) {
+            return entry;
+        }
+        uint64_t stateSize = 0;
+        if (!file.read(reinterpret_cast<char*>(&stateSize), sizeof(stateSize))) {
+            return nullptr;
+        }
+        entry->state.resize(stateSize);
+        if (!file.read(reinterpret_cast<char*>(entry->state.data()), static_cast<std::streamsize>(stateSize))) {
+            LOG_WARN("Truncated KV snapshot: " + path.string());
+            return nullptr;
+        }
+        return entry;
+    } catch (const std::exception& e) {
+        LOG_WARN("Failed to read KV snapshot: " + std::string(e.what()));
+        return nullptr;
+    }
+}
+
+bool KvSnapshotStore::writeFile(const std::filesystem::path& path, const PrefixEntry& entry) noexcept {
+    try {
+        auto tmpPath = path;
+        tmpPath += "." + std::to_string(::getpid()) + ".tmp";
+        {
+            std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+            const uint64_t idSize = entry.model.size();
+            const uint64_t nTokens = entry.tokens.size();
+            const uint64_t stateSize = entry.state.size();
+            file.write(kMagic, sizeof(kMagic));
+            file.write(reinterpret_cast<const char*>(&idSize), sizeof(idSize));
+            file.write(entry.model.data(), static_cast<std::streamsize>(idSize));
+            file.write(reinterpret_cast<const char*>(&nTokens), sizeof(nTokens));
+            file.write(reinterpret_cast<const char*>(entry.tokens.data()), nTokens * sizeof(int32_t));
+            file.write(reinterpret_cast<const char*>(&stateSize), sizeof(stateSize));
+            file.write(reinterpret_cast<const char*>(entry.state.data()), static_cast<std::streamsize>(stateSize));
+            if (!file) {
+                std::error_code ec;
+                std::filesystem::remove(tmpPath, ec);
+                return false;
+            }
+        }
+        std::filesystem::rename(tmpPath, path);
+        return true;
+    } catch (const std::exception& e) {
+        LOG_WARN("Failed to write KV snapshot: " + std::string(e.what()));
+        return false;
+    }
+}
+
+std::shared_ptr<const PrefixEntry> KvSnapshotStore::load(uint64_t hash, const std::vector<int32_t>& tokens,
+                                                         std::size_t length) noexcept {
+    if (length == 0 || length > tokens.size()) {
+        return nullptr;
+    }
+    std::shared_ptr<const PrefixEntry> entry;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto queued = pending_.find(hash);
+        if (queued != pending_.end()) {
+            entry = queued->second;
+        } else if (index_.count(hash) == 0) {
+            return nullptr;
+        }
+    }
+
+    const auto path = pathFor(hash);
+    const bool onDisk = !entry;
+    if (onDisk) {
+        entry = readFile(path);
+    }
+    if (!entry || entry->tokens.size() != length ||
+        !std::equal(entry->tokens.begin(), entry->tokens.end(), tokens.begin())) {
+        return nullptr;
+    }
+
+    if (onDisk) {
+        // Touch the file so budget eviction keeps recently used snapshots.
+        std::error_code ec;
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+        LOG_DEBUG("KV snapshot loaded: " + std::to_string(length) + " tokens");
+    }
+    return entry;
+}
+
+bool KvSnapshotStore::save(uint64_t hash, const PrefixEntry& entry) noexcept {
+    if (entry.bytes() > budget_ || contains(hash)) {
+        return false;
+    }
+    return store(hash, entry);
+}
+
+void KvSnapshotStore::saveAsync(uint64_t hash, std::shared_ptr<const PrefixEntry> entry) noexcept {
+    if (!entry || entry->bytes() > budget_) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (index_.count(hash) > 0 || pending_.count(hash) > 0) {
+            return;
+        }
+        if (queue_.size() >= kMaxPending) {
+            LOG_DEBUG("KV snapshot writer busy; not persisting " + hex64(hash));
+            return;
+        }
+        pending_.emplace(hash, std::move(entry));
+        queue_.push_back(hash);
+    }
+    wake_.notify_one();
+}
+
+void KvSnapshotStore::flush() noexcept {
+    std::unique_lock<std::mutex> lock(mutex_);
+    drained_.wait(lock, [&] { return pending_.empty(); });
+}
+
+bool KvSnapshotStore::store(uint64_t hash, const PrefixEntry& entry) noexcept {
+    if (!writeFile(pathFor(hash), entry)) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        index_.insert(hash);
+    }
+    enforceBudget();
+    return true;
+}
+
+void KvSnapshotStore::writerLoop() {
+    setThreadName("KvWrite");
+
+    while (true) {
+        uint64_t hash = 0;
+        std::shared_ptr<const PrefixEntry> entry;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                break;  // stopping with nothing left to write
+            }
+            hash = queue_.front();
+            queue_.pop_front();
+            entry = pending_.at(hash);
+        }
+        (void)store(hash, *entry);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_.erase(hash);
+        }
+        drained_.notify_all();
+    }
+}
+
+void KvSnapshotStore::enforceBudget() noexcept {
+    struct Snapshot {
+        std::filesystem::path path;
+        std::filesystem::file_time_type mtime;
+        std::uintmax_t size;
+    };
+
+    // Only the index is shared; the directory scan runs unlocked.
+    std::error_code ec;
+    std::vector<Snapshot> snapshots;
+    std::uintmax_t total = 0;
+    for (const auto& item : std::filesystem::directory_iterator(dir_, ec)) {
+        if (item.path().extension() != kSnapshotExt) continue;
+        const auto size = item.file_size(ec);
+        if (ec) continue;
+        snapshots.push_back({item.path(), item.last_write_time(ec), size});
+        total += size;
+    }
+    if (total <= budget_) {
+        return;
+    }
+
+    std::sort(snapshots.begin(), snapshots.end(),
+              [](const Snapshot& a, const Snapshot& b) { return a.mtime < b.mtime; });
+    for (const auto& snapshot : snapshots) {
+        if (total <= budget_) break;
+        if (!std::filesystem::remove(snapshot.path, ec)) continue;
+        total -= snapshot.size;
+        try {
+            const auto hash = std::stoull(snapshot.path.stem().string(), nullptr, 16);
+            std::lock_guard<std::mutex> lock(mutex_);
+            index_.erase(hash);
+        } catch (const std::exception&) {
+        }
+    }
+}
+
+}
@@ -8,11 +8,14 @@
 
 #include "llama.h"
 #include <cerrno>
+#include <cstdint>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <limits>
+#include <optional>
 #include <string>
+#include <vector>
 
 namespace nrvna {
 
@@ -65,6 +68,37 @@ inline float env_float(const char* name, float defv) {
     return defv;
 }
 
+// Convert one token to its text piece, growing the buffer for long pieces.
+inline std::optional<std::string> token_piece(const llama_vocab* vocab, llama_token token) {
+    char stack[128];
+    int n = llama_token_to_piece(vocab, token, stack, sizeof(stack), 0, true);
+    if (n >= 0) return std::string(stack, static_cast<size_t>(n));
+
+    std::vector<char> buffer(static_cast<size_t>(-n));
+    n = llama_token_to_piece(vocab, token, buffer.data(), buffer.size(), 0, true);
+    if (n < 0) return std::nullopt;
+    return std::string(buffer.data(), static_cast<size_t>(n));
+}
+
+// Serialize one sequence's KV state. Empty on failure.
+inline std::vector<uint8_t> seq_state_get(llama_context* ctx, llama_seq_id seq) {
+    std::vector<uint8_t> state(llama_state_seq_get_size(ctx, seq));
+    if (state.empty()) return state;
+    const size_t written = llama_state_seq_get_data(ctx, state.data(), state.size(), seq);
+    state.resize(written);
+    return state;
+}
+
+// Restore a serialized sequence into seq. The sequence must be empty.
+inline bool seq_state_set(llama_context* ctx, const std::vector<uint8_t>& state, llama_seq_id seq) {
+    if (state.empty()) return false;
+    if (llama_state_seq_set_data(ctx, state.data(), state.size(), seq) == 0) {
+        llama_memory_seq_rm(llama_get_memory(ctx), seq, -1, -1);
+        return false;
+    }
+    return true;
+}
+
 inline int effective_gpu_layers() {
     return env_int("NRVNA_GPU_LAYERS", 0);
 }
@@ -0,0 +1,370 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "nrvna/media_cache.hpp"
+#include "nrvna/hash.hpp"
+#include "nrvna/logger.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace nrvna {
+
+namespace {
+
+constexpr char kMagic[8] = {'N', 'R', 'V', 'E', 'M', '0', '0', '2'};
+constexpr const char* kEntryExt = ".emb";
+constexpr std::size_t kDigestSize = 64;
+constexpr std::size_t kMaxKeySize = kDigestSize + 21;
+constexpr std::size_t kMaxRememberedHashes = 4096;
+
+std::size_t entryBytes(const std::vector<float>& embedding) noexcept {
+    return embedding.size() * sizeof(float);
+}
+
+// <sha256 hex>-<ordinal>, as chunkKey makes them; also a safe file name.
+bool validKey(const std::string& key) noexcept {
+    if (key.size() <= kDigestSize + 1 || key.size() > kMaxKeySize || key[kDigestSize] != '-') return false;
+    for (std::size_t i = 0; i < key.size(); ++i) {
+        const char c = key[i];
+        const bool ok = i < kDigestSize ? (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f')
+                                        : i == kDigestSize || (c >= '0' && c <= '9');
+        if (!ok) return false;
+    }
+    return true;
+}
+
+}
+
+MediaCache::MediaCache(std::size_t budgetBytes) noexcept : budget_(budgetBytes) {}
+
+MediaCache::~MediaCache() {
+    {
+        std::lock_guard<std::mutex> lock(diskMutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+}
+
+std::string MediaCache::hashFile(const std::filesystem::path& path) noexcept {
+    try {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return {};
+        Sha256 hash;
+        char buf[64 * 1024];
+        while (file.read(buf, sizeof(buf)) || file.gcount() > 0) {
+            hash.update(buf, static_cast<std::size_t>(file.gcount()));
+        }
+        return file.bad() ? std::string{} : hash.hexDigest();
+    } catch (...) {
+        return {};
+    }
+}
+
+std::string MediaCache::contentHash(const std::filesystem::path& path) {
+    struct stat st {};
+    std::error_code ec;
+    const auto mtime = std::filesystem::last_write_time(path, ec);
+    if (ec || ::stat(path.c_str(), &st) != 0) {
+        return hashFile(path);
+    }
+    const FileIdentity identity{static_cast<uint64_t>(st.st_dev), static_cast<uint64_t>(st.st_ino),
+                                static_cast<uint64_t>(st.st_size),
+                                static_cast<int64_t>(mtime.time_since_epoch().count())};
+    {
+        std::lock_guard<std::mutex> lock(hashMutex_);
+        auto found = hashes_.find(identity);
+        if (found != hashes_.end()) return found->second;
+    }
+
+    auto hash = hashFile(path);
+    if (!hash.empty()) {
+        std::lock_guard<std::mutex> lock(hashMutex_);
+        if (hashes_.size() >= kMaxRememberedHashes) hashes_.clear();
+        hashes_.emplace(identity, hash);
+    }
+    return hash;
+}
+
+std::string MediaCache::chunkKey(const std::string& contentHash, std::size_t ordinal) {
+    return contentHash + "-" + std::to_string(ordinal);
+}
+
+void MediaCache::attachDirectory(std::filesystem::path dir, std::size_t diskBudgetBytes) {
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (ec) {
+        throw std::runtime_error("Cannot create media cache directory " + dir.string() + ": " + ec.message());
+    }
+
+    std::lock_guard<std::mutex> lock(diskMutex_);
+    dir_ = std::move(dir);
+    diskBudget_ = diskBudgetBytes;
+    onDisk_.clear();
+    diskBytes_ = 0;
+    for (const auto& item : std::filesystem::directory_iterator(dir_, ec)) {
+        const auto& path = item.path();
+        if (path.extension() != kEntryExt) {
+            // Leftover temp files from an interrupted write.
+            if (path.extension() == ".tmp") std::filesystem::remove(path, ec);
+            continue;
+        }
+        if (!validKey(path.stem().string())) {
+            // Written by an older version under a 64-bit key.
+            std::filesystem::remove(path, ec);
+            continue;
+        }
+        std::error_code sizeEc;
+        const auto size = item.file_size(sizeEc);
+        if (sizeEc) continue;
+        onDisk_.emplace(path.stem().string(), size);
+        diskBytes_ += size;
+    }
+    if (!writer_.joinable()) {
+        writer_ = std::thread(&MediaCache::writerLoop, this);
+    }
+    LOG_INFO("Media cache: " + std::to_string(onDisk_.size()) + " encodings in " + dir_.string());
+}
+
+std::filesystem::path MediaCache::pathFor(const std::string& key) const {
+    return dir_ / (key + kEntryExt);
+}
+
+std::shared_ptr<const std::vector<float>> MediaCache::lookup(const std::string& key, std::size_t floats) {
+    if (!validKey(key)) return nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = entries_.find(key);
+        if (found != entries_.end() && found->second.embedding->size() == floats) {
+            lru_.splice(lru_.begin(), lru_, found->second.lru);
+            return found->second.embedding;
+        }
+    }
+
+    // Memory miss: an encoding spilled earlier, possibly by a previous run.
+    auto loaded = readFile(key, floats);
+    if (loaded && entryBytes(*loaded) <= budget_) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        storeLocked(key, loaded);
+    }
+    return loaded;
+}
+
+bool MediaCache::insert(const std::string& key, std::vector<float> embedding) {
+    if (!validKey(key) || embedding.empty() || entryBytes(embedding) > budget_) return false;
+    auto entry = std::make_shared<const std::vector<float>>(std::move(embedding));
+
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> lock(diskMutex_);
+        if (writer_.joinable() && !stopping_ && onDisk_.count(key) == 0 && pending_.count(key) == 0 &&
+            entryBytes(*entry) <= diskBudget_) {
+            if (queue_.size() < kMaxPending) {
+                pending_.emplace(key, entry);
+                queue_.push_back(key);
+                queued = true;
+            } else {
+                LOG_DEBUG("Media cache writer busy; keeping " + key + " in memory only");
+            }
+        }
+    }
+    if (queued) {
+        wake_.notify_one();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    storeLocked(key, std::move(entry));
+    return entries_.count(key) > 0;
+}
+
+void MediaCache::flush() noexcept {
+    std::unique_lock<std::mutex> lock(diskMutex_);
+    drained_.wait(lock, [&] { return pending_.empty(); });
+}
+
+void MediaCache::storeLocked(const std::string& key, Embedding embedding) {
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+        bytes_ -= entryBytes(*it->second.embedding);
+        lru_.erase(it->second.lru);
+        entries_.erase(it);
+    }
+    bytes_ += entryBytes(*embedding);
+    lru_.push_front(key);
+    entries_[key] = Slot{std::move(embedding), lru_.begin()};
+
+    while (bytes_ > budget_ && !lru_.empty()) {
+        auto victim = entries_.find(lru_.back());
+        bytes_ -= entryBytes(*victim->second.embedding);
+        entries_.erase(victim);
+        lru_.pop_back();
+    }
+}
+
+MediaCache::Embedding MediaCache::readFile(const std::string& key, std::size_t floats) noexcept {
+    std::filesystem::path path;
+    {
+        std::lock_guard<std::mutex> lock(diskMutex_);
+        auto queued = pending_.find(key);
+        if (queued != pending_.end()) {
+            return queued->second->size() == floats ? queued->second : nullptr;
+        }
+        if (dir_.empty() || onDisk_.count(key) == 0) return nullptr;
+        path = pathFor(key);
+    }
+    try {
+        std::ifstream file(path, std::ios::binary);
+        char magic[sizeof(kMagic)] = {};
+        uint64_t keySize = 0;
+        std::string stored;
+        uint64_t count = 0;
+        if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+            !file.read(reinterpret_cast<char*>(&keySize), sizeof(keySize)) || keySize > kMaxKeySize) {
+            return nullptr;
+        }
+        stored.resize(keySize);
+        if (!file.read(stored.data(), static_cast<std::streamsize>(keySize)) || stored != key) {
+            LOG_WARN("Media cache entry holds another key: " + path.string());
+            return nullptr;
+        }
+        if (!file.read(reinterpret_cast<char*>(&count), sizeof(count)) || count != floats) {
+            return nullptr;
+        }
+        auto embedding = std::make_shared<std::vector<float>>(floats);
+        if (!file.read(reinterpret_cast<char*>(embedding->data()),
+                       static_cast<std::streamsize>(floats * sizeof(float)))) {
+            LOG_WARN("Truncated media cache entry: " + path.string());
+            return nullptr;
+        }
+        // Touch the file so budget eviction keeps recently used entries.
+        std::error_code ec;
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+        return embedding;
+    } catch (const std::exception& e) {
+        LOG_WARN("Failed to read media cache entry: " + std::string(e.what()));
+        return nullptr;
+    }
+}
+
+bool MediaCache::writeFile(const std::string& key, const std::vector<float>& embedding) noexcept {
+    const auto path = pathFor(key);
+    std::uintmax_t size = 0;
+    try {
+        auto tmpPath = path;
+        tmpPath += "." + std::to_string(::getpid()) + ".tmp";
+        {
+            std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+            const uint64_t keySize = key.size();
+            const uint64_t count = embedding.size();
+            file.write(kMagic, sizeof(kMagic));
+            file.write(reinterpret_cast<const char*>(&keySize), sizeof(keySize));
+            file.write(key.data(), static_cast<std::streamsize>(keySize));
+            file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+            file.write(reinterpret_cast<const char*>(embedding.data()),
+                       static_cast<std::streamsize>(entryBytes(embedding)));
+            file.flush();
+            size = static_cast<std::uintmax_t>(file.tellp());
+            if (!file) {
+                std::error_code ec;
+                std::filesystem::remove(tmpPath, ec);
+                return false;
+            }
+        }
+        std::filesystem::rename(tmpPath, path);
+    } catch (const std::exception& e) {
+        LOG_WARN("Failed to write media cache entry: " + std::string(e.what()));
+        return false;
+    }
+
+    bool over = false;
+    {
+        std::lock_guard<std::mutex> lock(diskMutex_);
+        if (onDisk_.emplace(key, size).second) diskBytes_ += size;
+        over = diskBytes_ > diskBudget_;
+    }
+    // The directory is only scanned once the running total is over budget.
+    if (over) {
+        enforceDiskBudget();
+    }
+    return true;
+}
+
+void MediaCache::enforceDiskBudget() noexcept {
+    struct Entry {
+        std::filesystem::path path;
+        std::filesystem::file_time_type mtime;
+        std::uintmax_t size;
+    };
+
+    // Only the index is shared; the directory scan runs unlocked.
+    std::error_code ec;
+    std::vector<Entry> files;
+    std::uintmax_t total = 0;
+    for (const auto& item : std::filesystem::directory_iterator(dir_, ec)) {
+        if (item.path().extension() != kEntryExt) continue;
+        const auto size = item.file_size(ec);
+        if (ec) continue;
+        files.push_back({item.path(), item.last_write_time(ec), size});
+        total += size;
+    }
+
+    std::sort(files.begin(), files.end(), [](const Entry& a, const Entry& b) { return a.mtime < b.mtime; });
+    std::vector<std::string> removed;
+    for (const auto& file : files) {
+        if (total <= diskBudget_) break;
+        if (!std::filesystem::remove(file.path, ec)) continue;
+        total -= file.size;
+        removed.push_back(file.path.stem().string());
+    }
+
+    std::lock_guard<std::mutex> lock(diskMutex_);
+    for (const auto& key : removed) {
+        onDisk_.erase(key);
+    }
+    diskBytes_ = total;
+}
+
+void MediaCache::writerLoop() {
+    setThreadName("MediaWrite");
+
+    while (true) {
+        std::string key;
+        Embedding embedding;
+        {
+            std::unique_lock<std::mutex> lock(diskMutex_);
+            wake_.wait(lock, [&] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                break;  // stopping with nothing left to write
+            }
+            key = std::move(queue_.front());
+            queue_.pop_front();
+            embedding = pending_.at(key);
+        }
+        (void)writeFile(key, *embedding);
+        {
+            std::lock_guard<std::mutex> lock(diskMutex_);
+            pending_.erase(key);
+        }
+        drained_.notify_all();
+    }
+}
+
+std::size_t MediaCache::bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+}
+
+std::size_t MediaCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+}
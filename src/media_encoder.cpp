@@ -0,0 +1,205 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "nrvna/media_encoder.hpp"
+#include "nrvna/logger.hpp"
+#include "nrvna/media_cache.hpp"
+#include "llama.h"
+#include "mtmd.h"
+#include "mtmd-helper.h"
+#include <exception>
+#include <future>
+#include <unordered_map>
+
+namespace nrvna {
+
+void MediaChunksDeleter::operator()(mtmd_input_chunks* chunks) const noexcept {
+    if (chunks) mtmd_input_chunks_free(chunks);
+}
+
+MediaEncoder::MediaEncoder(mtmd_context* ctx, std::shared_ptr<llama_model> model)
+    : ctx_(ctx, mtmd_free), model_(std::move(model)), audio_(mtmd_support_audio(ctx)) {}
+
+MediaEncoder::~MediaEncoder() {
+    stop();
+}
+
+bool MediaEncoder::start() noexcept {
+    try {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (thread_.joinable()) {
+            return true;
+        }
+        stopping_ = false;
+        thread_ = std::thread(&MediaEncoder::loop, this);
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to start media encoder: " + std::string(e.what()));
+        return false;
+    }
+}
+
+void MediaEncoder::stop() noexcept {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+bool MediaEncoder::run(std::function<void(mtmd_context*)> task) {
+    std::promise<void> done;
+    auto finished = done.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_ || !thread_.joinable()) {
+            return false;
+        }
+        queue_.emplace_back([&task, &done](mtmd_context* ctx) {
+            try {
+                task(ctx);
+                done.set_value();
+            } catch (...) {
+                done.set_exception(std::current_exception());
+            }
+        });
+    }
+    wake_.notify_one();
+    finished.get();
+    return true;
+}
+
+void MediaEncoder::loop() {
+    setThreadName("Media");
+
+    while (true) {
+        std::deque<std::function<void(mtmd_context*)>> tasks;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                break;  // stopping with nothing left to run
+            }
+            tasks.swap(queue_);
+        }
+        // Everything queued runs back to back with the context's full thread count.
+        for (auto& task : tasks) {
+            task(ctx_.get());
+        }
+    }
+}
+
+MediaChunks MediaEncoder::tokenize(const std::string& prompt, const std::vector<std::filesystem::path>& files,
+                                   bool audio, std::string& error) {
+    // Content hashes become the bitmap IDs that the chunks carry to eval().
+    std::vector<std::string> hashes;
+    if (cache_) {
+        for (const auto& path : files) hashes.push_back(cache_->contentHash(path));
+    }
+
+    MediaChunks chunks;
+    const bool ran = run([&](mtmd_context* ctx) {
+        std::vector<mtmd_bitmap*> bitmaps;
+        auto release = [&] {
+            for (auto* bitmap : bitmaps) mtmd_bitmap_free(bitmap);
+        };
+        for (const auto& path : files) {
+            auto res = mtmd_helper_bitmap_init_from_file(ctx, path.c_str(), false);
+            if (!res.bitmap || mtmd_bitmap_is_audio(res.bitmap) != audio) {
+                if (res.bitmap) mtmd_bitmap_free(res.bitmap);
+                release();
+                error = audio ? "Failed to load audio file(s)" : "Failed to load image(s)";
+                return;
+            }
+            bitmaps.push_back(res.bitmap);
+            if (!hashes.empty() && !hashes[bitmaps.size() - 1].empty()) {
+                mtmd_bitmap_set_id(res.bitmap, hashes[bitmaps.size() - 1].c_str());
+            }
+        }
+
+        MediaChunks tokenized(mtmd_input_chunks_init());
+        if (!tokenized) {
+            release();
+            error = audio ? "Failed to init audio chunks" : "Failed to init image chunks";
+            return;
+        }
+        mtmd_input_text text{prompt.c_str(), prompt.size(), true, true};
+        std::vector<const mtmd_bitmap*> bitmapPtrs(bitmaps.begin(), bitmaps.end());
+        const int32_t res = mtmd_tokenize(ctx, tokenized.get(), &text, bitmapPtrs.data(), bitmapPtrs.size());
+        // Chunks keep their own preprocessed copy of each file.
+        release();
+        if (res != 0) {
+            error = audio ? "Failed to tokenize audio prompt" : "Failed to tokenize multimodal prompt";
+            return;
+        }
+        chunks = std::move(tokenized);
+    });
+    if (!ran) {
+        error = "Media encoder is stopped";
+    }
+    return chunks;
+}
+
+bool MediaEncoder::eval(llama_context* ctx, const mtmd_input_chunks* chunks, std::size_t first, int32_t& n_past) {
+    const int32_t n_batch = static_cast<int32_t>(llama_n_batch(ctx));
+    const std::size_t n_embd = static_cast<std::size_t>(llama_model_n_embd(model_.get()));
+    const std::size_t n_chunks = mtmd_input_chunks_size(chunks);
+    std::unordered_map<std::string, std::size_t> seen;  // chunks so far per source file
+    for (std::size_t c = 0; c < n_chunks; ++c) {
+        const mtmd_input_chunk* chunk = mtmd_input_chunks_get(chunks, c);
+        const bool last = c + 1 == n_chunks;
+        // Text chunks and embedding decodes only read the mtmd context's
+        // settings, so they run here alongside the encoder thread.
+        if (mtmd_input_chunk_get_type(chunk) == MTMD_INPUT_CHUNK_TYPE_TEXT) {
+            if (c >= first &&
+                mtmd_helper_eval_chunk_single(ctx_.get(), ctx, chunk, n_past, 0, n_batch, last, &n_past) != 0) {
+                return false;
+            }
+            continue;
+        }
+
+        std::string key;
+        if (cache_) {
+            const char* id = mtmd_input_chunk_get_id(chunk);
+            if (id && *id) {
+                const std::string content(id);
+                key = MediaCache::chunkKey(content, seen[content]++);
+            }
+        }
+        if (c < first) continue;
+
+        const std::size_t floats = mtmd_input_chunk_get_n_tokens(chunk) * n_embd;
+        std::vector<float> embd;
+        if (auto cached = !key.empty() ? cache_->lookup(key, floats) : nullptr) {
+            embd = *cached;
+            LOG_DEBUG("Media encoding reused from cache");
+        } else {
+            embd = encode(chunk, floats);
+            if (embd.empty()) return false;
+            if (!key.empty()) cache_->insert(key, embd);
+        }
+        if (mtmd_helper_decode_image_chunk(ctx_.get(), ctx, chunk, embd.data(), n_past, 0, n_batch, &n_past) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<float> MediaEncoder::encode(const mtmd_input_chunk* chunk, std::size_t floats) {
+    std::vector<float> embd;
+    const bool ran = run([&](mtmd_context* mctx) {
+        if (mtmd_encode_chunk(mctx, chunk) != 0) {
+            return;
+        }
+        if (const float* out = mtmd_get_output_embd(mctx)) embd.assign(out, out + floats);
+    });
+    return ran ? embd : std::vector<float>();
+}
+
+}
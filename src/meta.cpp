@@ -10,6 +10,7 @@
 #include <cmath>
 #include <ctime>
 #include <fstream>
+#include <iterator>
 #include <limits>
 #include <nlohmann/json.hpp>
 
@@ -75,6 +76,22 @@ bool writeMetaJson(const std::filesystem::path& dir, const JobMeta& meta) {
             document["output_format"] = meta.output_format;
         }
 
+        if (!meta.speculate.empty()) {
+            document["speculate"] = meta.speculate;
+        }
+
+        if (meta.continuation) {
+            document["continue"] = true;
+        }
+
+        if (meta.timeout_s > 0.0) {
+            document["timeout_s"] = meta.timeout_s;
+        }
+
+        if (!meta.priority.empty()) {
+            document["priority"] = meta.priority;
+        }
+
         if (meta.recovery_attempts > 0) {
             document["recovery_attempts"] = meta.recovery_attempts;
         }
@@ -86,6 +103,18 @@ bool writeMetaJson(const std::filesystem::path& dir, const JobMeta& meta) {
             document["status"] = meta.status;
         }
 
+        if (!meta.cached_from.empty()) {
+            document["cached_from"] = meta.cached_from;
+        }
+
+        if (!meta.metrics.empty()) {
+            auto& metrics = document["metrics"];
+            metrics = nlohmann::json::object();
+            for (const auto& [name, value] : meta.metrics) {
+                metrics[name] = std::round(value * 10000.0) / 10000.0;
+            }
+        }
+
         auto tmpPath = dir / (std::string(contract::kMetaFile) + ".tmp");
         auto finalPath = dir / contract::kMetaFile;
 
@@ -112,7 +141,15 @@ std::optional<JobMeta> readMetaJson(const std::filesystem::path& dir) {
         std::ifstream file(metaPath, std::ios::binary);
         if (!file) return std::nullopt;
 
-        auto document = nlohmann::json::parse(file);
+        return parseMetaJson(std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()));
+    } catch (...) {
+        return std::nullopt;
+    }
+}
+
+std::optional<JobMeta> parseMetaJson(const std::string& text) {
+    try {
+        auto document = nlohmann::json::parse(text);
         if (!document.is_object()) return std::nullopt;
         if (!document.contains("submitted_at") ||
             !document["submitted_at"].is_string() ||
@@ -145,12 +182,25 @@ std::optional<JobMeta> readMetaJson(const std::filesystem::path& dir) {
         if (!readString("parent", meta.parent) ||
             !readStrings("tags", meta.tags) ||
             !readString("output_format", meta.output_format) ||
+            !readString("speculate", meta.speculate) ||
+            !readString("priority", meta.priority) ||
             !readString("completed_at", meta.completed_at) ||
             !readStrings("artifacts", meta.artifacts) ||
-            !readString("status", meta.status)) {
+            !readString("status", meta.status) ||
+            !readString("cached_from", meta.cached_from)) {
             return std::nullopt;
         }
 
+        if (document.contains("continue")) {
+            if (!document["continue"].is_boolean()) return std::nullopt;
+            meta.continuation = document["continue"].get<bool>();
+        }
+
+        if (document.contains("timeout_s")) {
+            if (!document["timeout_s"].is_number()) return std::nullopt;
+            meta.timeout_s = document["timeout_s"].get<double>();
+        }
+
         if (document.contains("recovery_attempts")) {
             const auto& value = document["recovery_attempts"];
             if (!value.is_number_unsigned()) return std::nullopt;
@@ -166,6 +216,15 @@ std::optional<JobMeta> readMetaJson(const std::filesystem::path& dir) {
             meta.duration_s = document["duration_s"].get<double>();
         }
 
+        if (document.contains("metrics")) {
+            const auto& metrics = document["metrics"];
+            if (!metrics.is_object()) return std::nullopt;
+            for (const auto& [name, value] : metrics.items()) {
+                if (!value.is_number()) return std::nullopt;
+                meta.metrics[name] = value.get<double>();
+            }
+        }
+
         return meta;
     } catch (...) {
         return std::nullopt;
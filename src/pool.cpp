@@ -5,12 +5,14 @@
  */
 
 #include "nrvna/pool.hpp"
+#include "nrvna/contract.hpp"
 #include "nrvna/logger.hpp"
 #include <chrono>
 
 namespace nrvna {
 
-Pool::Pool(int workers) noexcept : workers_(workers) {
+Pool::Pool(int workers, SchedulerConfig config, int mediaWorkers) noexcept
+    : workers_(workers), mediaWorkers_(mediaWorkers), scheduler_(std::move(config)) {
     LOG_DEBUG("Pool created with " + std::to_string(workers) + " workers");
 }
 
@@ -55,6 +57,11 @@ bool Pool::start(JobProcessor processor) {
     }
 }
 
+void Pool::setLookahead(std::size_t jobs, JobHint hint) noexcept {
+    lookahead_ = hint ? jobs : 0;
+    hint_ = std::move(hint);
+}
+
 void Pool::stop() noexcept {
     if (!running_.load()) {
         return;
@@ -81,35 +88,40 @@ void Pool::stop() noexcept {
     // Clear remaining jobs
     {
         std::lock_guard<std::mutex> lock(queueMutex_);
-        while (!jobQueue_.empty()) {
-            jobQueue_.pop();
-        }
-        enqueuedJobs_.clear();
+        scheduler_.clear();
     }
     
     LOG_INFO("Pool stopped");
 }
 
-bool Pool::submit(const JobId& jobId) noexcept {
+bool Pool::submit(const JobId& jobId, const JobTraits& traits) noexcept {
     if (!running_.load() || shutdown_.load()) {
         LOG_DEBUG("Cannot submit job to stopped pool: " + jobId);
         return false;
     }
 
     try {
-        std::lock_guard<std::mutex> lock(queueMutex_);
-        
-        // Check if job is already in the queue to prevent duplicates
-        if (isJobInQueue(jobId)) {
-            LOG_DEBUG("Job already in queue, skipping duplicate: " + jobId);
-            return false;
+        bool upcoming = false;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex_);
+
+            // Check if job is already in the queue to prevent duplicates
+            if (!scheduler_.push(jobId, traits)) {
+                LOG_DEBUG("Job already in queue, skipping duplicate: " + jobId);
+                return false;
+            }
+            // Idle workers take the first jobs at once; the next few are
+            // worth reading ahead.
+            const auto waiting = static_cast<std::size_t>(idle_);
+            upcoming = scheduler_.size() > waiting && scheduler_.size() <= waiting + lookahead_;
+
+            jobAvailable_.notify_one();
+            LOG_DEBUG("Job queued: " + jobId + " (" + contract::toString(traits.priority) +
+                      (traits.group.empty() ? "" : ", " + traits.group) + ")");
+        }
+        if (upcoming) {
+            hint_({jobId});
         }
-        
-        jobQueue_.push(jobId);
-        enqueuedJobs_.insert(jobId);
-        
-        jobAvailable_.notify_one();
-        LOG_DEBUG("Job queued: " + jobId);
         return true;
     } catch (...) {
         LOG_ERROR("Failed to queue job: " + jobId);
@@ -117,10 +129,6 @@ bool Pool::submit(const JobId& jobId) noexcept {
     }
 }
 
-bool Pool::isJobInQueue(const JobId& jobId) const {
-    return enqueuedJobs_.find(jobId) != enqueuedJobs_.end();
-}
-
 void Pool::workerLoop(int workerId) {
     // Name this thread for logging
     setThreadName("Worker-" + std::to_string(workerId));
@@ -129,27 +137,39 @@ void Pool::workerLoop(int workerId) {
     try {
         while (!shutdown_.load()) {
             JobId jobId;
+            bool media = false;
+            std::vector<JobId> upcoming;
             
             // Get next job
             {
                 std::unique_lock<std::mutex> lock(queueMutex_);
                 
-                // Wait for job or shutdown signal
+                // Wait for a job this worker may run, or shutdown. Media
+                // jobs wait in the queue while the encoder cap is reached.
+                ++idle_;
                 jobAvailable_.wait(lock, [this] { 
-                    return !jobQueue_.empty() || shutdown_.load(); 
+                    return scheduler_.runnable(mediaAllowed()) || shutdown_.load(); 
                 });
+                --idle_;
                 
                 if (shutdown_.load()) {
                     break;
                 }
                 
-                if (jobQueue_.empty()) {
+                auto next = scheduler_.pop(Scheduler::Clock::now(), mediaAllowed());
+                if (!next) {
                     continue;
                 }
-                
-                jobId = jobQueue_.front();
-                jobQueue_.pop();
-                enqueuedJobs_.erase(jobId);
+                jobId = std::move(next->id);
+                media = next->media;
+                if (media) ++activeMedia_;
+                if (lookahead_ > 0) {
+                    upcoming = scheduler_.upcoming(lookahead_);
+                }
+            }
+            if (!upcoming.empty()) {
+                hint_(upcoming);
+                upcoming.clear();
             }
             
             // Process job outside of lock
@@ -165,6 +185,15 @@ void Pool::workerLoop(int workerId) {
                     LOG_ERROR("Worker " + std::to_string(workerId) + " unknown job processing error (job: " + jobId + ")");
                 }
             }
+
+            // A freed encoder slot may make a queued media job runnable.
+            if (media) {
+                {
+                    std::lock_guard<std::mutex> lock(queueMutex_);
+                    --activeMedia_;
+                }
+                jobAvailable_.notify_one();
+            }
         }
     } catch (const std::exception& e) {
         LOG_ERROR("Worker " + std::to_string(workerId) + " fatal error: " + std::string(e.what()));
@@ -0,0 +1,126 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "nrvna/prefetcher.hpp"
+#include "nrvna/logger.hpp"
+#include <algorithm>
+#include <string>
+
+namespace nrvna {
+
+Prefetcher::Prefetcher(Loader loader, std::size_t capacity) noexcept
+    : loader_(std::move(loader)), capacity_(std::max<std::size_t>(1, capacity)) {}
+
+Prefetcher::~Prefetcher() {
+    stop();
+}
+
+bool Prefetcher::start() noexcept {
+    try {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (thread_.joinable()) {
+            return true;
+        }
+        stopping_ = false;
+        thread_ = std::thread(&Prefetcher::loop, this);
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to start prefetcher: " + std::string(e.what()));
+        return false;
+    }
+}
+
+void Prefetcher::stop() noexcept {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        pending_.clear();
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void Prefetcher::hint(const std::vector<JobId>& ids) {
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) return;
+        for (const auto& id : ids) {
+            if (pending_.size() >= capacity_) break;
+            if (known_.insert(id).second) {
+                pending_.push_back(id);
+                queued = true;
+            }
+        }
+    }
+    if (queued) {
+        wake_.notify_one();
+    }
+}
+
+std::shared_ptr<const JobInputs> Prefetcher::take(const JobId& id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (known_.erase(id) == 0) {
+        return nullptr;
+    }
+    auto found = loaded_.find(id);
+    if (found == loaded_.end()) {
+        // Pending or loading: the worker reads it itself.
+        pending_.erase(std::remove(pending_.begin(), pending_.end(), id), pending_.end());
+        return nullptr;
+    }
+    auto inputs = std::move(found->second);
+    loaded_.erase(found);
+    order_.erase(std::find(order_.begin(), order_.end(), id));
+    return inputs;
+}
+
+std::size_t Prefetcher::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return loaded_.size();
+}
+
+void Prefetcher::loop() {
+    setThreadName("Prefetch");
+
+    while (true) {
+        JobId id;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return stopping_ || !pending_.empty(); });
+            if (stopping_) {
+                break;
+            }
+            id = std::move(pending_.front());
+            pending_.pop_front();
+        }
+
+        std::shared_ptr<const JobInputs> inputs;
+        try {
+            inputs = loader_(id);
+        } catch (const std::exception& e) {
+            LOG_WARN("Prefetch failed for " + id + ": " + std::string(e.what()));
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Claimed while loading, or not readable ahead.
+        if (known_.count(id) == 0 || !inputs) {
+            known_.erase(id);
+            continue;
+        }
+        loaded_[id] = std::move(inputs);
+        order_.push_back(id);
+        while (loaded_.size() > capacity_) {
+            known_.erase(order_.front());
+            loaded_.erase(order_.front());
+            order_.pop_front();
+        }
+    }
+}
+
+}
@@ -0,0 +1,159 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "nrvna/prefix_cache.hpp"
+#include "nrvna/hash.hpp"
+#include "nrvna/kv_store.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace nrvna {
+
+namespace {
+constexpr std::size_t kMaxSightings = 4096;
+}
+
+PrefixCache::PrefixCache(std::size_t budgetBytes) noexcept : budget_(budgetBytes) {}
+
+uint64_t PrefixCache::extendHash(uint64_t hash, const int32_t* tokens, std::size_t count) noexcept {
+    // FNV-1a over the token bytes
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto value = static_cast<uint32_t>(tokens[i]);
+        for (int b = 0; b < 4; ++b) {
+            hash ^= (value >> (8 * b)) & 0xffu;
+            hash *= kFnvPrime;
+        }
+    }
+    return hash;
+}
+
+uint64_t PrefixCache::hashTokens(const int32_t* tokens, std::size_t count) noexcept {
+    return extendHash(kFnvOffset, tokens, count);
+}
+
+std::shared_ptr<const PrefixEntry> PrefixCache::lookup(const std::vector<int32_t>& tokens,
+                                                       const std::vector<std::size_t>& lengths) {
+    std::vector<std::size_t> sorted(lengths);
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    // One pass over the tokens yields the hash of every candidate prefix.
+    std::vector<std::pair<std::size_t, uint64_t>> candidates;
+    uint64_t hash = hashTokens(nullptr, 0);
+    std::size_t hashed = 0;
+    for (std::size_t length : sorted) {
+        if (length == 0 || length > tokens.size()) continue;
+        hash = extendHash(hash, tokens.data() + hashed, length - hashed);
+        hashed = length;
+        candidates.emplace_back(length, hash);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = candidates.rbegin(); it != candidates.rend(); ++it) {
+            auto found = entries_.find(it->second);
+            if (found == entries_.end()) continue;
+            const auto& entry = found->second.entry;
+            // Guard against hash collisions before handing out KV state.
+            if (entry->tokens.size() != it->first ||
+                std::memcmp(entry->tokens.data(), tokens.data(), it->first * sizeof(int32_t)) != 0) {
+                continue;
+            }
+            lru_.splice(lru_.begin(), lru_, found->second.lru);
+            return entry;
+        }
+    }
+
+    if (!store_) {
+        return nullptr;
+    }
+    // Memory miss: the longest snapshot on disk is loaded back into memory.
+    for (auto it = candidates.rbegin(); it != candidates.rend(); ++it) {
+        auto entry = store_->load(it->second, tokens, it->first);
+        if (!entry) continue;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (entries_.count(it->second) == 0 && entry->bytes() <= budget_) {
+            lru_.push_front(it->second);
+            entries_[it->second] = Slot{entry, lru_.begin()};
+            bytes_ += entry->bytes();
+            evictLocked();
+        }
+        return entry;
+    }
+    return nullptr;
+}
+
+bool PrefixCache::contains(const std::vector<int32_t>& tokens, std::size_t length) const {
+    if (length == 0 || length > tokens.size()) return false;
+    const uint64_t key = hashTokens(tokens.data(), length);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (entries_.count(key) > 0) return true;
+    }
+    return store_ && store_->contains(key);
+}
+
+bool PrefixCache::insert(std::vector<int32_t> tokens, std::vector<uint8_t> state, bool pinned, bool persist) {
+    if (tokens.empty() || state.empty()) return false;
+
+    auto entry = std::make_shared<PrefixEntry>();
+    entry->tokens = std::move(tokens);
+    entry->state = std::move(state);
+    entry->pinned = pinned;
+    const std::size_t entryBytes = entry->bytes();
+    if (!pinned && entryBytes > budget_) return false;
+
+    const uint64_t key = hashTokens(entry->tokens.data(), entry->tokens.size());
+    if (store_ && persist) {
+        store_->saveAsync(key, entry);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+        bytes_ -= it->second.entry->bytes();
+        lru_.erase(it->second.lru);
+        entries_.erase(it);
+    }
+    lru_.push_front(key);
+    entries_[key] = Slot{std::move(entry), lru_.begin()};
+    bytes_ += entryBytes;
+    evictLocked();
+    return entries_.count(key) > 0;
+}
+
+unsigned PrefixCache::noteSighting(const std::vector<int32_t>& tokens, std::size_t length) {
+    if (length == 0 || length > tokens.size()) return 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (sightings_.size() >= kMaxSightings) {
+        sightings_.clear();
+    }
+    return ++sightings_[hashTokens(tokens.data(), length)];
+}
+
+void PrefixCache::evictLocked() {
+    auto it = lru_.end();
+    while (bytes_ > budget_ && it != lru_.begin()) {
+        --it;
+        auto slot = entries_.find(*it);
+        if (slot->second.entry->pinned) continue;
+        bytes_ -= slot->second.entry->bytes();
+        entries_.erase(slot);
+        it = lru_.erase(it);
+    }
+}
+
+std::size_t PrefixCache::bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+}
+
+std::size_t PrefixCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+}
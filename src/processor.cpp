@@ -5,8 +5,23 @@
  */
 
 #include "nrvna/processor.hpp"
+#include "nrvna/archive.hpp"
+#include "nrvna/batch_engine.hpp"
 #include "nrvna/contract.hpp"
+#include "nrvna/cost_model.hpp"
+#include "nrvna/durability.hpp"
+#include "nrvna/embed_batcher.hpp"
+#include "nrvna/finalizer.hpp"
+#include "nrvna/hash.hpp"
+#include "nrvna/job_index.hpp"
+#include "nrvna/job_control.hpp"
+#include "nrvna/kv_store.hpp"
+#include "nrvna/lifecycle.hpp"
+#include "nrvna/media_cache.hpp"
 #include "nrvna/meta.hpp"
+#include "nrvna/prefetcher.hpp"
+#include "nrvna/prefix_cache.hpp"
+#include "nrvna/result_cache.hpp"
 #include "nrvna/runner.hpp"
 #include "nrvna/runner_tts.hpp"
 #include "nrvna/structured_output.hpp"
@@ -17,14 +32,33 @@
 #include <cstdio>
 #include <ctime>
 #include <algorithm>
+#include <cctype>
 #include <cmath>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <mutex>
+#include <stdexcept>
 
 namespace {
+constexpr std::size_t kMaxConversationTurns = 1000;
 std::mutex g_output_mutex;
 
+// Text a failed run produced before it stopped, kept as response.txt.
+std::optional<std::string> partialOutput(const nrvna::RunResult& result) {
+    if (result.output.empty()) {
+        return std::nullopt;
+    }
+    return result.output;
+}
+
+std::vector<std::string> failureArtifacts(const std::optional<std::string>& partial) {
+    if (partial) {
+        return {nrvna::contract::kErrorFile, nrvna::contract::kResponseFile};
+    }
+    return {nrvna::contract::kErrorFile};
+}
+
 std::string timestamp() {
     auto now = std::chrono::system_clock::now();
     auto time = std::chrono::system_clock::to_time_t(now);
@@ -38,7 +72,9 @@ std::string timestamp() {
 void writeCompletionMeta(const std::filesystem::path& jobPath,
                          double elapsed_s,
                          const std::vector<std::string>& artifacts,
-                         const std::string& status) {
+                         const std::string& status,
+                         const std::map<std::string, double>& metrics,
+                         const nrvna::JobId& cachedFrom = {}) {
     auto parsed = nrvna::readMetaJson(jobPath);
     if (!parsed) {
         LOG_WARN("Missing or invalid job metadata at completion: " + jobPath.string());
@@ -54,6 +90,10 @@ void writeCompletionMeta(const std::filesystem::path& jobPath,
     meta.duration_s = elapsed_s;
     meta.artifacts = artifacts;
     meta.status = status;
+    for (const auto& [name, value] : metrics) {
+        meta.metrics[name] = value;
+    }
+    meta.cached_from = cachedFrom;
     if (!nrvna::writeMetaJson(jobPath, meta)) {
         LOG_ERROR("Failed to write completion metadata: " + jobPath.string());
     }
@@ -85,20 +125,125 @@ void printJobStatus(const nrvna::JobId& id, const std::string& status, double el
     std::cerr << "\n" << std::flush;
 }
 
-void completeJob(const std::filesystem::path& jobPath,
-                 double elapsed,
-                 const std::vector<std::string>& artifacts,
-                 const std::string& status) {
-    writeCompletionMeta(jobPath, elapsed, artifacts, status);
+// Artifacts are written to a temp file and renamed, so a reader never sees
+// a partial file.
+bool writeTextArtifact(const std::filesystem::path& jobPath, const std::string& name, const std::string& text,
+                       bool endWithNewline) {
+    auto tempPath = jobPath / (name + ".tmp");
+    {
+        std::ofstream file(tempPath, std::ios::binary);
+        if (!file) return false;
+        file << text;
+        if (endWithNewline && !text.empty() && text.back() != '\n') {
+            file << '\n';
+        }
+        file.flush();
+        if (!file.good()) return false;
+    }
+    std::filesystem::rename(tempPath, jobPath / name);
+    return true;
+}
+
+bool writeEmbeddingArtifact(const std::filesystem::path& jobPath, const std::vector<float>& embedding) {
+    if (!std::all_of(embedding.begin(), embedding.end(), [](float value) {
+            return std::isfinite(value);
+        })) {
+        LOG_ERROR("Refusing to write non-finite embedding: " + jobPath.string());
+        return false;
+    }
+
+    auto tempPath = jobPath / (std::string(nrvna::contract::kEmbeddingFile) + ".tmp");
+    {
+        std::ofstream file(tempPath, std::ios::binary);
+        if (!file) return false;
+
+        file << "{\n  \"dim\": " << embedding.size() << ",\n  \"vector\": [";
+        for (size_t i = 0; i < embedding.size(); ++i) {
+            if (i > 0) file << ", ";
+            if (i % 10 == 0 && i > 0) file << "\n    ";
+            file << embedding[i];
+        }
+        file << "\n  ]\n}\n";
+        file.flush();
+        if (!file.good()) return false;
+    }
+    std::filesystem::rename(tempPath, jobPath / nrvna::contract::kEmbeddingFile);
+    return true;
+}
+
+bool writeAudioArtifact(const std::filesystem::path& jobPath, const std::vector<float>& audio, int sampleRate) {
+    auto tempPath = jobPath / (std::string(nrvna::contract::kAudioFile) + ".tmp");
+    {
+        std::ofstream file(tempPath, std::ios::binary);
+        if (!file) return false;
+
+        // WAV header
+        struct {
+            char riff[4] = {'R', 'I', 'F', 'F'};
+            uint32_t chunk_size;
+            char wave[4] = {'W', 'A', 'V', 'E'};
+            char fmt[4] = {'f', 'm', 't', ' '};
+            uint32_t fmt_chunk_size = 16;
+            uint16_t audio_format = 1;
+            uint16_t num_channels = 1;
+            uint32_t sample_rate;
+            uint32_t byte_rate;
+            uint16_t block_align;
+            uint16_t bits_per_sample = 16;
+            char data[4] = {'d', 'a', 't', 'a'};
+            uint32_t data_size;
+        } header;
+        static_assert(sizeof(header) == 44, "WAV header struct has unexpected padding");
+
+        header.sample_rate = static_cast<uint32_t>(sampleRate);
+        header.byte_rate = header.sample_rate * header.num_channels * (header.bits_per_sample / 8);
+        header.block_align = header.num_channels * (header.bits_per_sample / 8);
+        header.data_size = static_cast<uint32_t>(audio.size() * (header.bits_per_sample / 8));
+        header.chunk_size = 36 + header.data_size;
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const auto& sample : audio) {
+            int16_t pcm = static_cast<int16_t>(std::max(-32768.0, std::min(32767.0, sample * 32767.0)));
+            file.write(reinterpret_cast<const char*>(&pcm), sizeof(pcm));
+        }
+        file.flush();
+        if (!file.good()) return false;
+    }
+    std::filesystem::rename(tempPath, jobPath / nrvna::contract::kAudioFile);
+    return true;
 }
 
 }
 
 namespace nrvna {
 
-Processor::Processor(const std::filesystem::path& workspace, const std::string& modelPath, const std::string& mmprojPath, const std::string& vocoderPath)
-    : workspace_(workspace), modelPath_(modelPath), mmprojPath_(mmprojPath), vocoderPath_(vocoderPath) {
+Processor::Processor(const std::filesystem::path& workspace, const std::string& modelPath, const std::string& mmprojPath, const std::string& vocoderPath,
+                     const std::string& draftPath)
+    : workspace_(workspace), modelPath_(modelPath), mmprojPath_(mmprojPath), vocoderPath_(vocoderPath),
+      draftPath_(draftPath) {
     LOG_DEBUG("Processor created for workspace: " + workspace_.string() + " with model: " + modelPath_);
+    const int finalizeThreads = env_int("NRVNA_FINALIZE_THREADS", 2);
+    if (finalizeThreads > 0) {
+        finalizer_ = std::make_unique<Finalizer>(static_cast<size_t>(finalizeThreads),
+                                                 static_cast<size_t>(std::max(1, env_int("NRVNA_FINALIZE_QUEUE", 64))));
+        if (!finalizer_->start()) {
+            finalizer_.reset();
+        }
+    }
+}
+
+Processor::~Processor() {
+    if (prefetcher_) {
+        prefetcher_->stop();
+    }
+    // Workers have stopped; finish the embedding jobs they handed over, then
+    // publish everything still queued.
+    if (embedBatcher_) {
+        embedBatcher_->stop();
+    }
+    if (finalizer_) {
+        finalizer_->stop();
+    }
 }
 
 ProcessResult Processor::process(const JobId& jobId, int workerId) noexcept {
@@ -113,36 +258,52 @@ ProcessResult Processor::process(const JobId& jobId, int workerId) noexcept {
 
         printJobStatus(jobId, contract::toString(Status::Running));
         auto startTime = std::chrono::steady_clock::now();
-
-        // Step 2: Read prompt and route metadata
-        PromptReadResult promptRead = readPrompt(jobId);
-        PromptReadResult grammarRead = readGrammar(jobId);
-        const auto jobMeta = readMetaJson(getJobPath(contract::kProcessingDir, jobId));
-        if (grammarRead.ok && grammarRead.content.empty() && jobMeta && !jobMeta->output_format.empty()) {
-            grammarRead = {false, "", "Structured job is missing grammar.gbnf"};
+        auto secondsElapsed = [&] {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        };
+
+        // Step 2: Read prompt and route metadata, unless the prefetcher
+        // already read them while the job was queued.
+        const auto processingPath = getJobPath(contract::kProcessingDir, jobId);
+        JobInputs inputs;
+        if (auto ahead = prefetcher_ ? prefetcher_->take(jobId) : nullptr) {
+            inputs = *ahead;
+            const auto readyPath = getJobPath(contract::kReadyDir, jobId);
+            for (auto* paths : {&inputs.images, &inputs.audio}) {
+                for (auto& path : *paths) {
+                    path = processingPath / path.lexically_relative(readyPath);
+                }
+            }
+        } else {
+            inputs = readInputs(processingPath);
         }
-        auto jobTypeRead = readJobType(jobId);
-        std::vector<std::filesystem::path> imagePaths = readImages(jobId);
-        std::vector<std::filesystem::path> audioPaths = readAudio(jobId);
+        const PromptReadResult& promptRead = inputs.prompt;
+        const PromptReadResult& grammarRead = inputs.grammar;
+        const auto& jobMeta = inputs.meta;
+        const auto& jobTypeRead = inputs.type;
+        const auto& imagePaths = inputs.images;
+        const auto& audioPaths = inputs.audio;
+        journal::append(workspace_, jobId, Status::Running, jobMeta);
+
+        // The deadline counts from the claim. A job cancelled while queued
+        // fails here without touching a model.
+        const double timeout = jobMeta && jobMeta->timeout_s > 0.0
+            ? jobMeta->timeout_s : env_float("NRVNA_JOB_TIMEOUT", 0.0f);
+        JobControl control(processingPath / contract::kCancelFile, timeout);
+        if (control.stopRequested()) {
+            return fail(jobId, 0.0, control.reason(), "cancelled");
+        }
+
         if (!promptRead.ok) {
-            completeJob(getJobPath(contract::kProcessingDir, jobId), 0.0, {contract::kErrorFile}, contract::toString(Status::Failed));
-            printJobStatus(jobId, contract::toString(Status::Failed), 0.0, "prompt read error");
-            (void)finalizeFailure(jobId, promptRead.error);
-            return ProcessResult::Failed;
+            return fail(jobId, 0.0, promptRead.error, "prompt read error");
         }
 
         if (!grammarRead.ok) {
-            completeJob(getJobPath(contract::kProcessingDir, jobId), 0.0, {contract::kErrorFile}, contract::toString(Status::Failed));
-            printJobStatus(jobId, contract::toString(Status::Failed), 0.0, "grammar read error");
-            (void)finalizeFailure(jobId, grammarRead.error);
-            return ProcessResult::Failed;
+            return fail(jobId, 0.0, grammarRead.error, "grammar read error");
         }
 
         if (!jobTypeRead) {
-            completeJob(getJobPath(contract::kProcessingDir, jobId), 0.0, {contract::kErrorFile}, contract::toString(Status::Failed));
-            printJobStatus(jobId, contract::toString(Status::Failed), 0.0, "invalid type.txt");
-            (void)finalizeFailure(jobId, "Invalid job type in type.txt");
-            return ProcessResult::Failed;
+            return fail(jobId, 0.0, "Invalid job type in type.txt", "invalid type.txt");
         }
 
         const JobType jobType = *jobTypeRead;
@@ -151,166 +312,147 @@ ProcessResult Processor::process(const JobId& jobId, int workerId) noexcept {
         const bool allowEmptyPrompt = prompt.empty() &&
             ((jobType == JobType::Embed && !imagePaths.empty()) || (jobType == JobType::Stt && !audioPaths.empty()));
         if (prompt.empty() && !allowEmptyPrompt) {
-            completeJob(getJobPath(contract::kProcessingDir, jobId), 0.0, {contract::kErrorFile}, contract::toString(Status::Failed));
-            printJobStatus(jobId, contract::toString(Status::Failed), 0.0, "empty prompt");
-            (void)finalizeFailure(jobId, "Empty prompt");
-            return ProcessResult::Failed;
+            return fail(jobId, 0.0, "Empty prompt", "empty prompt");
+        }
+
+        Completion completion;
+        completion.jobId = jobId;
+
+        // An identical earlier job answers this one without a model.
+        const std::string cacheKey = resultCache_ ? resultKey(jobType, inputs) : "";
+        if (!cacheKey.empty()) {
+            auto cached = resultCache_->lookup(cacheKey);
+            // The artifact name becomes a path under output/.
+            if (cached && cached->artifact != contract::kResultFile &&
+                cached->artifact != contract::kTranscriptFile && cached->artifact != contract::kEmbeddingFile) {
+                LOG_WARN("Result cache entry for " + jobId + " names artifact \"" + cached->artifact +
+                         "\"; ignoring it");
+                cached.reset();
+            }
+            if (cached) {
+                completion.ok = true;
+                completion.elapsed = secondsElapsed();
+                completion.artifact = std::move(cached->artifact);
+                completion.text = std::move(cached->text);
+                completion.values = std::move(cached->values);
+                completion.cachedFrom = std::move(cached->source);
+                LOG_INFO("Result cache hit: " + jobId + " reuses " + completion.cachedFrom);
+                return finish(std::move(completion));
+            }
+            completion.cacheKey = cacheKey;
         }
 
         // TTS uses its own runner and does not need a text Runner.
         if (jobType == JobType::Tts) {
             if (vocoderPath_.empty()) {
-                auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
-                completeJob(getJobPath(contract::kProcessingDir, jobId), elapsed, {contract::kErrorFile}, contract::toString(Status::Failed));
-                printJobStatus(jobId, contract::toString(Status::Failed), elapsed);
-                (void)finalizeFailure(jobId, "TTS requires --vocoder flag");
-                return ProcessResult::Failed;
+                return fail(jobId, secondsElapsed(), "TTS requires --vocoder flag");
             }
 
             TtsRunner* ttsRunner = getTtsRunnerForWorker(workerId);
             if (!ttsRunner) {
-                auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
-                completeJob(getJobPath(contract::kProcessingDir, jobId), elapsed, {contract::kErrorFile}, contract::toString(Status::Failed));
-                printJobStatus(jobId, contract::toString(Status::Failed), elapsed, "no TTS runner");
-                (void)finalizeFailure(jobId, "No TTS runner available");
+                (void)fail(jobId, secondsElapsed(), "No TTS runner available", "no TTS runner");
                 return ProcessResult::SystemError;
             }
 
-            auto ttsResult = ttsRunner->run(prompt);
-            auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
-            if (ttsResult.ok) {
-                completeJob(getJobPath(contract::kProcessingDir, jobId), elapsed, {contract::kAudioFile}, contract::toString(Status::Done));
-                if (finalizeAudio(jobId, ttsResult.audio, ttsResult.sample_rate)) {
-                    printJobStatus(jobId, contract::toString(Status::Done), elapsed);
-                    LOG_INFO("TTS COMPLETED: " + jobId + " -> " + std::to_string(ttsResult.audio.size()) + " samples");
-                    return ProcessResult::Success;
-                } else {
-                    LOG_ERROR("Failed to finalize TTS job: " + jobId);
-                    completeJob(getJobPath(contract::kProcessingDir, jobId), elapsed, {contract::kErrorFile}, contract::toString(Status::Failed));
-                    if (!finalizeFailure(jobId, "Failed to write audio to output directory")) {
-                        LOG_ERROR("STUCK JOB: " + jobId + " remains in processing/. The next daemon will try recovery.");
-                    }
-                    return ProcessResult::SystemError;
-                }
-            } else {
-                printJobStatus(jobId, contract::toString(Status::Failed), elapsed);
-                completeJob(getJobPath(contract::kProcessingDir, jobId), elapsed, {contract::kErrorFile}, contract::toString(Status::Failed));
-                (void)finalizeFailure(jobId, ttsResult.error);
-                LOG_WARN("TTS job failed: " + jobId + " - " + ttsResult.error);
-                return ProcessResult::Failed;
+            auto ttsResult = ttsRunner->run(prompt, &control);
+            completion.elapsed = secondsElapsed();
+            if (!ttsResult.ok) {
+                return fail(jobId, completion.elapsed, ttsResult.error);
             }
+            completion.ok = true;
+            completion.artifact = contract::kAudioFile;
+            completion.values = std::move(ttsResult.audio);
+            completion.sampleRate = ttsResult.sample_rate;
+            return finish(std::move(completion));
         }
 
         // Text, STT, embedding, and vision jobs use the text Runner.
         Runner* runner = getRunnerForWorker(workerId);
         if (!runner) {
-            auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
-            completeJob(getJobPath(contract::kProcessingDir, jobId), elapsed, {contract::kErrorFile}, contract::toString(Status::Failed));
-            printJobStatus(jobId, contract::toString(Status::Failed), elapsed, "no runner");
-            (void)finalizeFailure(jobId, "No runner available");
+            (void)fail(jobId, secondsElapsed(), "No runner available", "no runner");
             return ProcessResult::SystemError;
         }
 
         if (jobType == JobType::Stt) {
-            auto sttResult = runner->transcribe(prompt, audioPaths);
-            auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
-            if (sttResult.ok) {
-                completeJob(getJobPath(contract::kProcessingDir, jobId), elapsed, {contract::kTranscriptFile}, contract::toString(Status::Done));
-                if (finalizeTranscript(jobId, sttResult.output)) {
-                    printJobStatus(jobId, contract::toString(Status::Done), elapsed);
-                    LOG_INFO("STT COMPLETED: " + jobId + " -> " + std::to_string(sttResult.output.size()) + " chars");
-                    return ProcessResult::Success;
-                } else {
-                    LOG_ERROR("Failed to finalize STT job: " + jobId);
-                    completeJob(getJobPath(contract::kProcessingDir, jobId), elapsed, {contract::kErrorFile}, contract::toString(Status::Failed));
-                    if (!finalizeFailure(jobId, "Failed to write transcript to output directory")) {
-                        LOG_ERROR("STUCK JOB: " + jobId + " remains in processing/. The next daemon will try recovery.");
-                    }
-                    return ProcessResult::SystemError;
-                }
-            } else {
-                printJobStatus(jobId, contract::toString(Status::Failed), elapsed);
-                completeJob(getJobPath(contract::kProcessingDir, jobId), elapsed, {contract::kErrorFile}, contract::toString(Status::Failed));
-                (void)finalizeFailure(jobId, sttResult.error);
-                LOG_WARN("STT job failed: " + jobId + " - " + sttResult.error);
-                return ProcessResult::Failed;
+            auto sttResult = runner->transcribe(prompt, audioPaths, &control);
+            completion.elapsed = secondsElapsed();
+            if (!sttResult.ok) {
+                return fail(jobId, completion.elapsed, sttResult.error, "", partialOutput(sttResult));
             }
+            completion.ok = true;
+            completion.artifact = contract::kTranscriptFile;
+            completion.text = std::move(sttResult.output);
+            completion.metrics = std::move(sttResult.metrics);
+            return finish(std::move(completion));
         }
 
         if (jobType == JobType::Embed) {
+            // Text embeddings are coalesced across workers. The batcher
+            // completes the job; it stays in processing/ until then.
+            if (embedBatcher_ && imagePaths.empty() &&
+                embedBatcher_->submit({jobId, prompt, startTime, cacheKey})) {
+                return ProcessResult::Success;
+            }
             auto embedResult = imagePaths.empty()
                 ? runner->embed(prompt)
                 : runner->embedVision(prompt, imagePaths);
-            auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
-            if (embedResult.ok) {
-                completeJob(getJobPath(contract::kProcessingDir, jobId), elapsed, {contract::kEmbeddingFile}, contract::toString(Status::Done));
-                if (finalizeEmbedding(jobId, embedResult.embedding)) {
-                    printJobStatus(jobId, contract::toString(Status::Done), elapsed);
-                    LOG_INFO("EMBED COMPLETED: " + jobId + " -> " + std::to_string(embedResult.embedding.size()) + " dims");
-                    return ProcessResult::Success;
-                } else {
-                    LOG_ERROR("Failed to finalize embedding job: " + jobId);
-                    completeJob(getJobPath(contract::kProcessingDir, jobId), elapsed, {contract::kErrorFile}, contract::toString(Status::Failed));
-                    if (!finalizeFailure(jobId, "Failed to write embedding to output directory")) {
-                        LOG_ERROR("STUCK JOB: " + jobId + " remains in processing/. The next daemon will try recovery.");
-                    }
-                    return ProcessResult::SystemError;
-                }
-            } else {
-                printJobStatus(jobId, contract::toString(Status::Failed), elapsed);
-                completeJob(getJobPath(contract::kProcessingDir, jobId), elapsed, {contract::kErrorFile}, contract::toString(Status::Failed));
-                (void)finalizeFailure(jobId, embedResult.error);
-                LOG_WARN("Embed job failed: " + jobId + " - " + embedResult.error);
-                return ProcessResult::Failed;
-            }
+            return completeEmbedding(jobId, startTime, embedResult, cacheKey);
         }
 
         RunResult result;
-        GenerationOptions generationOptions{grammarRead.content};
+        GenerationOptions generationOptions;
+        generationOptions.grammar = grammarRead.content;
+        generationOptions.control = &control;
+        if (jobMeta) {
+            generationOptions.speculate = jobMeta->speculate;
+        }
+        std::shared_ptr<std::ofstream> streamed;
+        if (env_int("NRVNA_STREAM_TOKENS", 16) > 0) {
+            streamed = std::make_shared<std::ofstream>(
+                processingPath / contract::kPartialFile,
+                std::ios::binary | std::ios::trunc);
+            if (*streamed) {
+                generationOptions.onText = [streamed](const std::string& text) {
+                    *streamed << text;
+                    streamed->flush();
+                };
+            }
+        }
+        if (jobMeta && jobMeta->continuation && jobType == JobType::Text) {
+            std::string conversationError;
+            if (!readConversation(jobMeta->parent, generationOptions.history, conversationError)) {
+                return fail(jobId, 0.0, conversationError, "conversation read error");
+            }
+            if (!jobMeta->parent.empty()) {
+                generationOptions.resumeState =
+                    contract::jobDir(workspace_, Status::Done, jobMeta->parent) / contract::kStateFile;
+            }
+            generationOptions.saveState = processingPath / contract::kStateFile;
+        }
         if (imagePaths.empty()) {
             result = runner->run(prompt, generationOptions);
         } else {
             result = runner->run(prompt, imagePaths, generationOptions);
         }
+        generationOptions.onText = nullptr;
+        streamed.reset();
 
-        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
-        if (result.ok) {
-            if (jobMeta && jobMeta->output_format == "json_schema") {
-                auto structuredError = validateStructuredOutput(result.output, jobMeta->output_format);
-                if (structuredError) {
-                    printJobStatus(jobId, contract::toString(Status::Failed), elapsed, "invalid structured output");
-                    completeJob(getJobPath(contract::kProcessingDir, jobId), elapsed,
-                                {contract::kErrorFile, contract::kResponseFile},
-                                contract::toString(Status::Failed));
-                    if (!finalizeFailure(jobId, *structuredError, result.output)) {
-                        LOG_ERROR("STUCK JOB: " + jobId + " remains in processing/. The next daemon will try recovery.");
-                    }
-                    return ProcessResult::Failed;
-                }
-            }
-            completeJob(getJobPath(contract::kProcessingDir, jobId), elapsed, {contract::kResultFile}, contract::toString(Status::Done));
-            if (finalizeSuccess(jobId, result.output)) {
-                printJobStatus(jobId, contract::toString(Status::Done), elapsed);
-                LOG_INFO("JOB COMPLETED: " + jobId + " -> " + std::to_string(result.output.size()) + " chars");
-                return ProcessResult::Success;
-            } else {
-                LOG_ERROR("Failed to finalize successful job: " + jobId);
-                completeJob(getJobPath(contract::kProcessingDir, jobId), elapsed,
-                            {contract::kErrorFile, contract::kResponseFile},
-                            contract::toString(Status::Failed));
-                if (!finalizeFailure(jobId, "Failed to write result to output directory", result.output)) {
-                    LOG_ERROR("STUCK JOB: " + jobId + " remains in processing/. The next daemon will try recovery.");
-                }
-                return ProcessResult::SystemError;
+        completion.elapsed = secondsElapsed();
+        if (!result.ok) {
+            return fail(jobId, completion.elapsed, result.error, "", partialOutput(result));
+        }
+        if (jobMeta && jobMeta->output_format == "json_schema") {
+            auto structuredError = validateStructuredOutput(result.output, jobMeta->output_format);
+            if (structuredError) {
+                return fail(jobId, completion.elapsed, *structuredError, "invalid structured output", result.output);
             }
-        } else {
-            printJobStatus(jobId, contract::toString(Status::Failed), elapsed);
-            completeJob(getJobPath(contract::kProcessingDir, jobId), elapsed, {contract::kErrorFile}, contract::toString(Status::Failed));
-            (void)finalizeFailure(jobId, result.error);
-            LOG_WARN("Job failed during inference: " + jobId + " - " + result.error);
-            return ProcessResult::Failed;
         }
-        
+        completion.ok = true;
+        completion.artifact = contract::kResultFile;
+        completion.text = std::move(result.output);
+        completion.metrics = std::move(result.metrics);
+        return finish(std::move(completion));
+
     } catch (const std::exception& e) {
         LOG_ERROR("Exception processing job " + jobId + ": " + std::string(e.what()));
         (void)finalizeFailure(jobId, "Internal processing error: " + std::string(e.what()));
@@ -322,140 +464,130 @@ ProcessResult Processor::process(const JobId& jobId, int workerId) noexcept {
     }
 }
 
-bool Processor::moveReadyToProcessing(const JobId& jobId) noexcept {
-    try {
-        auto readyPath = getJobPath(contract::kReadyDir, jobId);
-        auto processingPath = getJobPath(contract::kProcessingDir, jobId);
-        
-        // Use std::error_code to handle race condition gracefully
-        std::error_code ec;
-        std::filesystem::rename(readyPath, processingPath, ec);
-        
-        if (ec) {
-            // Another worker already claimed it, or job disappeared
-            LOG_DEBUG("Job already claimed or missing: " + jobId);
-            return false;
-        }
-        
-        LOG_DEBUG("Job moved to processing: " + jobId);
-        return true;
-    } catch (const std::exception& e) {
-        LOG_ERROR("Failed to move job to processing: " + std::string(e.what()));
-        return false;
-    } catch (...) {
-        LOG_ERROR("Unknown error moving job to processing");
-        return false;
-    }
+ProcessResult Processor::fail(const JobId& jobId, double elapsed, std::string error, std::string detail,
+                              std::optional<std::string> partial) noexcept {
+    Completion completion;
+    completion.jobId = jobId;
+    completion.elapsed = elapsed;
+    completion.text = std::move(error);
+    completion.detail = std::move(detail);
+    completion.partial = std::move(partial);
+    return finish(std::move(completion));
 }
 
-bool Processor::finalizeSuccess(const JobId& jobId, const std::string& result) noexcept {
-    try {
-        auto processingPath = getJobPath(contract::kProcessingDir, jobId);
-        auto outputPath = getJobPath(contract::kOutputDir, jobId);
-        
-        // Write result to temporary file first
-        auto tempResultPath = processingPath / (std::string(contract::kResultFile) + ".tmp");
-        {
-            std::ofstream file(tempResultPath, std::ios::binary);
-            if (!file) return false;
-            file << result;
-            file.flush();
-            if (!file.good()) return false;
+ProcessResult Processor::finish(Completion completion) noexcept {
+    const ProcessResult result = completion.ok ? ProcessResult::Success : ProcessResult::Failed;
+    if (finalizer_) {
+        try {
+            auto queued = std::make_shared<Completion>(std::move(completion));
+            if (finalizer_->submit([this, queued] { publish(*queued); })) {
+                return result;
+            }
+            completion = std::move(*queued);
+        } catch (const std::exception& e) {
+            LOG_WARN("Publishing " + completion.jobId + " on the worker: " + std::string(e.what()));
         }
-        
-        // Rename temp file to final name
-        auto finalResultPath = processingPath / contract::kResultFile;
-        std::filesystem::rename(tempResultPath, finalResultPath);
-        
-        // Atomic move entire job to output
-        std::filesystem::rename(processingPath, outputPath);
-        
-        LOG_DEBUG("Job finalized successfully: " + jobId);
-        return true;
-    } catch (const std::exception& e) {
-        LOG_ERROR("Failed to finalize success for job " + jobId + ": " + std::string(e.what()));
-        return false;
-    } catch (...) {
-        LOG_ERROR("Unknown error finalizing success for job: " + jobId);
-        return false;
     }
+    publish(completion);
+    return result;
 }
 
-bool Processor::finalizeEmbedding(const JobId& jobId, const std::vector<float>& embedding) noexcept {
-    try {
-        if (!std::all_of(embedding.begin(), embedding.end(), [](float value) {
-                return std::isfinite(value);
-            })) {
-            LOG_ERROR("Refusing to write non-finite embedding for job: " + jobId);
-            return false;
-        }
-
-        auto processingPath = getJobPath(contract::kProcessingDir, jobId);
-        auto outputPath = getJobPath(contract::kOutputDir, jobId);
-
-        // Write embedding as JSON
-        auto tempPath = processingPath / (std::string(contract::kEmbeddingFile) + ".tmp");
-        {
-            std::ofstream file(tempPath, std::ios::binary);
-            if (!file) return false;
+void Processor::publish(Completion& completion) noexcept {
+    const JobId& jobId = completion.jobId;
+    const auto processingPath = getJobPath(contract::kProcessingDir, jobId);
+    if (completion.ok) {
+        try {
+            if (writeArtifact(completion)) {
+                writeCompletionMeta(processingPath, completion.elapsed, {completion.artifact},
+                                    contract::toString(Status::Done), completion.metrics, completion.cachedFrom);
+                if (costModel_ && completion.cachedFrom.empty()) {
+                    costModel_->observe(CostModel::inspect(processingPath), completion.elapsed);
+                }
+                // The streamed text is superseded by the result.
+                std::error_code ec;
+                std::filesystem::remove(processingPath / contract::kPartialFile, ec);
+                const auto outputPath = getJobPath(contract::kOutputDir, jobId);
+                auto& syncer = Syncer::shared();
+                if (!syncer.beforeRename(processingPath)) {
+                    throw std::runtime_error("fsync of " + completion.artifact + " failed");
+                }
+                std::filesystem::rename(processingPath, outputPath);
+                if (!syncer.afterRename(processingPath, outputPath)) {
+                    LOG_WARN("Job completed but not synced: " + jobId);
+                }
+                journal::append(workspace_, jobId, Status::Done);
+                if (resultCache_ && !completion.cacheKey.empty()) {
+                    resultCache_->insert(completion.cacheKey, {jobId, completion.artifact, completion.text,
+                                                               completion.values});
+                }
 
-            file << "{\n  \"dim\": " << embedding.size() << ",\n  \"vector\": [";
-            for (size_t i = 0; i < embedding.size(); ++i) {
-                if (i > 0) file << ", ";
-                if (i % 10 == 0 && i > 0) file << "\n    ";
-                file << embedding[i];
+                printJobStatus(jobId, contract::toString(Status::Done), completion.elapsed,
+                               completion.cachedFrom.empty() ? "" : "cached");
+                LOG_INFO("JOB COMPLETED: " + jobId + " -> " + completion.artifact);
+                return;
             }
-            file << "\n  ]\n}\n";
-            file.flush();
-            if (!file.good()) return false;
+        } catch (const std::exception& e) {
+            LOG_ERROR("Failed to publish job " + jobId + ": " + std::string(e.what()));
         }
 
-        // Rename temp to final
-        auto finalPath = processingPath / contract::kEmbeddingFile;
-        std::filesystem::rename(tempPath, finalPath);
+        // A result that cannot be written still fails with what was generated.
+        LOG_ERROR("Failed to finalize successful job: " + jobId);
+        if (completion.artifact == contract::kResultFile) {
+            completion.partial = std::move(completion.text);
+        }
+        completion.text = "Failed to write " + completion.artifact.substr(0, completion.artifact.find('.')) +
+                          " to output directory";
+        completion.ok = false;
+    }
 
-        // Atomic move to output
-        std::filesystem::rename(processingPath, outputPath);
+    printJobStatus(jobId, contract::toString(Status::Failed), completion.elapsed, completion.detail);
+    writeCompletionMeta(processingPath, completion.elapsed, failureArtifacts(completion.partial),
+                        contract::toString(Status::Failed), {});
+    if (!finalizeFailure(jobId, completion.text, completion.partial)) {
+        LOG_ERROR("STUCK JOB: " + jobId + " remains in processing/. The next daemon will try recovery.");
+    }
+    LOG_WARN("Job failed: " + jobId + " - " + completion.text);
+}
 
-        LOG_DEBUG("Embedding job finalized: " + jobId);
-        return true;
+bool Processor::writeArtifact(const Completion& completion) const noexcept {
+    try {
+        const auto jobPath = getJobPath(contract::kProcessingDir, completion.jobId);
+        if (completion.artifact == contract::kEmbeddingFile) {
+            return writeEmbeddingArtifact(jobPath, completion.values);
+        }
+        if (completion.artifact == contract::kAudioFile) {
+            return writeAudioArtifact(jobPath, completion.values, completion.sampleRate);
+        }
+        return writeTextArtifact(jobPath, completion.artifact, completion.text,
+                                 completion.artifact == contract::kTranscriptFile);
     } catch (const std::exception& e) {
-        LOG_ERROR("Failed to finalize embedding for job " + jobId + ": " + std::string(e.what()));
-        return false;
-    } catch (...) {
-        LOG_ERROR("Unknown error finalizing embedding for job: " + jobId);
+        LOG_ERROR("Failed to write " + completion.artifact + " for job " + completion.jobId + ": " + e.what());
         return false;
     }
 }
 
-bool Processor::finalizeTranscript(const JobId& jobId, const std::string& transcript) noexcept {
+bool Processor::moveReadyToProcessing(const JobId& jobId) noexcept {
     try {
+        auto readyPath = getJobPath(contract::kReadyDir, jobId);
         auto processingPath = getJobPath(contract::kProcessingDir, jobId);
-        auto outputPath = getJobPath(contract::kOutputDir, jobId);
-
-        auto tempPath = processingPath / (std::string(contract::kTranscriptFile) + ".tmp");
-        {
-            std::ofstream file(tempPath, std::ios::binary);
-            if (!file) return false;
-            file << transcript;
-            if (!transcript.empty() && transcript.back() != '\n') {
-                file << '\n';
-            }
-            file.flush();
-            if (!file.good()) return false;
+        
+        // Use std::error_code to handle race condition gracefully
+        std::error_code ec;
+        std::filesystem::rename(readyPath, processingPath, ec);
+        
+        if (ec) {
+            // Another worker already claimed it, or job disappeared
+            LOG_DEBUG("Job already claimed or missing: " + jobId);
+            return false;
         }
-
-        auto finalPath = processingPath / contract::kTranscriptFile;
-        std::filesystem::rename(tempPath, finalPath);
-        std::filesystem::rename(processingPath, outputPath);
-
-        LOG_DEBUG("Transcript job finalized: " + jobId);
+        
+        LOG_DEBUG("Job moved to processing: " + jobId);
         return true;
     } catch (const std::exception& e) {
-        LOG_ERROR("Failed to finalize transcript for job " + jobId + ": " + std::string(e.what()));
+        LOG_ERROR("Failed to move job to processing: " + std::string(e.what()));
         return false;
     } catch (...) {
-        LOG_ERROR("Unknown error finalizing transcript for job: " + jobId);
+        LOG_ERROR("Unknown error moving job to processing");
         return false;
     }
 }
@@ -496,9 +628,26 @@ bool Processor::finalizeFailure(const JobId& jobId, const std::string& error,
                 return false;
             }
         }
+
+        // Text streamed before the failure becomes the partial artifact.
+        std::error_code ec;
+        const auto streamedPath = processingPath / contract::kPartialFile;
+        if (!partialOutput.has_value() && std::filesystem::file_size(streamedPath, ec) > 0 && !ec) {
+            std::filesystem::rename(streamedPath, processingPath / contract::kResponseFile, ec);
+        }
+        std::filesystem::remove(streamedPath, ec);
         
         // Atomic move to failed directory
+        auto& syncer = Syncer::shared();
+        if (!syncer.beforeRename(processingPath)) {
+            LOG_ERROR("Failed job could not be synced; job remains in processing: " + jobId);
+            return false;
+        }
         std::filesystem::rename(processingPath, failedPath);
+        if (!syncer.afterRename(processingPath, failedPath)) {
+            LOG_WARN("Job failed but not synced: " + jobId);
+        }
+        journal::append(workspace_, jobId, Status::Failed);
         
         LOG_DEBUG("Job moved to failed: " + jobId);
         return true;
@@ -511,10 +660,10 @@ bool Processor::finalizeFailure(const JobId& jobId, const std::string& error,
     }
 }
 
-std::vector<std::filesystem::path> Processor::readImages(const JobId& jobId) const noexcept {
+std::vector<std::filesystem::path> Processor::readImages(const std::filesystem::path& jobDir) const noexcept {
     std::vector<std::filesystem::path> imagePaths;
     try {
-        auto imagesDir = getJobPath(contract::kProcessingDir, jobId) / contract::kImagesDir;
+        auto imagesDir = jobDir / contract::kImagesDir;
         if (!std::filesystem::exists(imagesDir) || !std::filesystem::is_directory(imagesDir)) {
             return imagePaths;
         }
@@ -533,10 +682,10 @@ std::vector<std::filesystem::path> Processor::readImages(const JobId& jobId) con
     return imagePaths;
 }
 
-std::vector<std::filesystem::path> Processor::readAudio(const JobId& jobId) const noexcept {
+std::vector<std::filesystem::path> Processor::readAudio(const std::filesystem::path& jobDir) const noexcept {
     std::vector<std::filesystem::path> audioPaths;
     try {
-        auto audioDir = getJobPath(contract::kProcessingDir, jobId) / contract::kAudioInputDir;
+        auto audioDir = jobDir / contract::kAudioInputDir;
         if (!std::filesystem::exists(audioDir) || !std::filesystem::is_directory(audioDir)) {
             return audioPaths;
         }
@@ -554,9 +703,9 @@ std::vector<std::filesystem::path> Processor::readAudio(const JobId& jobId) cons
     return audioPaths;
 }
 
-std::optional<JobType> Processor::readJobType(const JobId& jobId) const noexcept {
+std::optional<JobType> Processor::readJobType(const std::filesystem::path& jobDir) const noexcept {
     try {
-        auto typePath = getJobPath(contract::kProcessingDir, jobId) / contract::kTypeFile;
+        auto typePath = jobDir / contract::kTypeFile;
 
         // Same guard as prompt.txt: never open a type.txt that isn't a plain
         // regular file (a symlinked or FIFO type file could block a worker).
@@ -582,9 +731,9 @@ std::optional<JobType> Processor::readJobType(const JobId& jobId) const noexcept
     }
 }
 
-PromptReadResult Processor::readPrompt(const JobId& jobId) const noexcept {
+PromptReadResult Processor::readPrompt(const std::filesystem::path& jobDir) const noexcept {
     try {
-        auto promptPath = getJobPath(contract::kProcessingDir, jobId) / contract::kPromptFile;
+        auto promptPath = jobDir / contract::kPromptFile;
         
         std::error_code ec;
         auto st = std::filesystem::symlink_status(promptPath, ec);
@@ -624,17 +773,17 @@ PromptReadResult Processor::readPrompt(const JobId& jobId) const noexcept {
         
         return {true, content, ""};
     } catch (const std::exception& e) {
-        LOG_ERROR("Exception reading prompt for job " + jobId + ": " + std::string(e.what()));
+        LOG_ERROR("Exception reading prompt in " + jobDir.string() + ": " + std::string(e.what()));
         return {false, "", "Failed to read prompt: " + std::string(e.what())};
     } catch (...) {
-        LOG_ERROR("Unknown error reading prompt for job: " + jobId);
+        LOG_ERROR("Unknown error reading prompt in: " + jobDir.string());
         return {false, "", "Unknown error reading prompt"};
     }
 }
 
-PromptReadResult Processor::readGrammar(const JobId& jobId) const noexcept {
+PromptReadResult Processor::readGrammar(const std::filesystem::path& jobDir) const noexcept {
     try {
-        const auto path = getJobPath(contract::kProcessingDir, jobId) / contract::kGrammarFile;
+        const auto path = jobDir / contract::kGrammarFile;
         std::error_code ec;
         const auto st = std::filesystem::symlink_status(path, ec);
         if (ec || !std::filesystem::exists(st)) {
@@ -657,6 +806,56 @@ PromptReadResult Processor::readGrammar(const JobId& jobId) const noexcept {
     }
 }
 
+JobInputs Processor::readInputs(const std::filesystem::path& jobDir) const noexcept {
+    JobInputs inputs;
+    inputs.prompt = readPrompt(jobDir);
+    inputs.grammar = readGrammar(jobDir);
+    inputs.meta = readMetaJson(jobDir);
+    if (inputs.grammar.ok && inputs.grammar.content.empty() && inputs.meta &&
+        !inputs.meta->output_format.empty()) {
+        inputs.grammar = {false, "", "Structured job is missing grammar.gbnf"};
+    }
+    inputs.type = readJobType(jobDir);
+    inputs.images = readImages(jobDir);
+    inputs.audio = readAudio(jobDir);
+    return inputs;
+}
+
+std::shared_ptr<const JobInputs> Processor::readAhead(const JobId& jobId) const noexcept {
+    try {
+        const auto readyPath = getJobPath(contract::kReadyDir, jobId);
+        std::error_code ec;
+        if (!std::filesystem::is_directory(readyPath, ec)) {
+            return nullptr;  // claimed or removed meanwhile
+        }
+        auto inputs = std::make_shared<JobInputs>(readInputs(readyPath));
+        // Failures are reported by the worker, against processing/.
+        if (!inputs->prompt.ok || !inputs->grammar.ok || !inputs->type) {
+            return nullptr;
+        }
+        // Hash media now so the encoder finds it in the cache without
+        // reading the files again; this also pulls them into the page cache.
+        if (mediaCache_) {
+            for (const auto* paths : {&inputs->images, &inputs->audio}) {
+                for (const auto& path : *paths) (void)mediaCache_->contentHash(path);
+            }
+        }
+        return inputs;
+    } catch (const std::exception& e) {
+        LOG_DEBUG("Prefetch of " + jobId + " failed: " + std::string(e.what()));
+        return nullptr;
+    }
+}
+
+void Processor::prefetch(const std::vector<JobId>& jobIds) noexcept {
+    if (!prefetcher_) return;
+    try {
+        prefetcher_->hint(jobIds);
+    } catch (const std::exception& e) {
+        LOG_DEBUG("Prefetch hint dropped: " + std::string(e.what()));
+    }
+}
+
 std::filesystem::path Processor::getJobPath(const char* phase, const JobId& jobId) const noexcept {
     try {
         return workspace_ / phase / jobId;
@@ -673,10 +872,118 @@ bool Processor::initializeRunners(int numWorkers) {
     try {
         for (int i = 0; i < numWorkers; ++i) {
             LOG_DEBUG("Pre-creating Runner instance for worker " + std::to_string(i));
-            // Pass numWorkers so each Runner divides CPU threads appropriately.
-            runners_[i] = std::make_unique<Runner>(modelPath_, mmprojPath_, numWorkers);
+            runners_[i] = std::make_unique<Runner>(modelPath_, mmprojPath_);
         }
         LOG_DEBUG("All " + std::to_string(numWorkers) + " Runner instances initialized");
+
+        if (!draftPath_.empty() && !Runner::loadDraftModel(draftPath_)) {
+            LOG_ERROR("Failed to load draft model: " + draftPath_);
+            return false;
+        }
+        const std::string speculation = Runner::defaultSpeculation();
+        if (!contract::isValidSpeculation(speculation)) {
+            LOG_ERROR("Invalid NRVNA_SPECULATE value: " + speculation + " (expected off, ngram, or draft)");
+            return false;
+        }
+        if (speculation != "off") {
+            LOG_INFO("Default speculation: " + speculation);
+        }
+
+        const std::string systemPrompt = readSystemPrompt();
+        if (!systemPrompt.empty()) {
+            Runner::setSystemPrompt(systemPrompt);
+            LOG_INFO("Workspace system prompt: " + std::to_string(systemPrompt.size()) + " bytes");
+        }
+
+        const int resultCacheMb = env_int("NRVNA_RESULT_CACHE_MB", 0);
+        if (resultCacheMb > 0) {
+            try {
+                resultCache_ = std::make_unique<ResultCache>(workspace_ / lifecycle::kResultDir,
+                                                             static_cast<size_t>(resultCacheMb) * 1024 * 1024);
+                resultKeyPrefix_ = "model " + KvSnapshotStore::modelIdentity(modelPath_) + "\n" +
+                                   "mmproj " + (mmprojPath_.empty() ? "-" : KvSnapshotStore::modelIdentity(mmprojPath_)) + "\n" +
+                                   "system " + sha256Hex(systemPrompt) + "\n";
+            } catch (const std::exception& e) {
+                LOG_WARN("Result cache disabled: " + std::string(e.what()));
+            }
+        }
+
+        const int cacheMb = env_int("NRVNA_PREFIX_CACHE_MB", 256);
+        if (cacheMb > 0) {
+            prefixCache_ = std::make_shared<PrefixCache>(static_cast<size_t>(cacheMb) * 1024 * 1024);
+            const int snapshotMb = env_int("NRVNA_KV_SNAPSHOT_MB", 1024);
+            if (snapshotMb > 0) {
+                try {
+                    prefixCache_->attachStore(std::make_shared<KvSnapshotStore>(
+                        workspace_ / lifecycle::kKvDir / KvSnapshotStore::modelIdentity(modelPath_),
+                        static_cast<size_t>(snapshotMb) * 1024 * 1024));
+                } catch (const std::exception& e) {
+                    LOG_WARN("KV snapshots disabled: " + std::string(e.what()));
+                }
+            }
+            for (auto& [workerId, runner] : runners_) {
+                runner->attachPrefixCache(prefixCache_);
+            }
+        }
+
+        const int mediaCacheMb = env_int("NRVNA_MEDIA_CACHE_MB", 256);
+        if (!mmprojPath_.empty() && mediaCacheMb > 0) {
+            mediaCache_ = std::make_shared<MediaCache>(static_cast<size_t>(mediaCacheMb) * 1024 * 1024);
+            const int diskMb = env_int("NRVNA_MEDIA_CACHE_DISK_MB", 1024);
+            if (diskMb > 0) {
+                try {
+                    mediaCache_->attachDirectory(
+                        workspace_ / lifecycle::kMediaDir / KvSnapshotStore::modelIdentity(mmprojPath_),
+                        static_cast<size_t>(diskMb) * 1024 * 1024);
+                } catch (const std::exception& e) {
+                    LOG_WARN("Media cache kept in memory only: " + std::string(e.what()));
+                }
+            }
+            for (auto& [workerId, runner] : runners_) {
+                runner->attachMediaCache(mediaCache_);
+            }
+        }
+
+        if (env_int("NRVNA_BATCHING", 0) != 0) {
+            batchEngine_ = Runner::createBatchEngine(numWorkers);
+            if (batchEngine_) {
+                batchEngine_->attachPrefixCache(prefixCache_);
+                for (auto& [workerId, runner] : runners_) {
+                    runner->attachBatchEngine(batchEngine_);
+                }
+                LOG_INFO("Continuous batching enabled for text jobs");
+            }
+        }
+
+        const int embedBatch = env_int("NRVNA_EMBED_BATCH", 0);
+        if (embedBatch > 1) {
+            embedBatcher_ = std::make_unique<EmbedBatcher>(
+                std::make_unique<Runner>(modelPath_, ""),
+                static_cast<size_t>(embedBatch),
+                std::chrono::milliseconds(std::max(0, env_int("NRVNA_EMBED_BATCH_DELAY_MS", 5))),
+                [this](const EmbedBatcher::Job& job, const EmbedResult& result) {
+                    (void)completeEmbedding(job.jobId, job.startTime, result, job.cacheKey);
+                });
+            if (!embedBatcher_->start()) {
+                embedBatcher_.reset();
+            }
+        }
+
+        const int prefetch = env_int("NRVNA_PREFETCH", 1);
+        if (prefetch > 0) {
+            prefetchDepth_ = static_cast<size_t>(prefetch) * static_cast<size_t>(std::max(1, numWorkers));
+            prefetcher_ = std::make_unique<Prefetcher>(
+                [this](const JobId& jobId) { return readAhead(jobId); }, prefetchDepth_ * 2);
+            if (!prefetcher_->start()) {
+                prefetcher_.reset();
+                prefetchDepth_ = 0;
+            }
+        }
+
+        // Prefill the system prompt once so no job pays for it.
+        if (prefixCache_ && !runners_.empty()) {
+            runners_.begin()->second->warmPrefixCache();
+        }
         return true;
     } catch (const std::exception& e) {
         LOG_ERROR("Failed to initialize runners: " + std::string(e.what()));
@@ -684,6 +991,130 @@ bool Processor::initializeRunners(int numWorkers) {
     }
 }
 
+ProcessResult Processor::completeEmbedding(const JobId& jobId, std::chrono::steady_clock::time_point startTime,
+                                           const EmbedResult& embedResult, std::string cacheKey) noexcept {
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    if (!embedResult.ok) {
+        return fail(jobId, elapsed, embedResult.error);
+    }
+    Completion completion;
+    completion.jobId = jobId;
+    completion.ok = true;
+    completion.elapsed = elapsed;
+    completion.artifact = contract::kEmbeddingFile;
+    completion.values = embedResult.embedding;
+    completion.metrics = embedResult.metrics;
+    completion.cacheKey = std::move(cacheKey);
+    return finish(std::move(completion));
+}
+
+std::string Processor::resultKey(JobType type, const JobInputs& inputs) const {
+    // Continuations depend on their parent's turns and keep KV state; speech
+    // synthesis samples with its own settings.
+    if (type == JobType::Tts || (inputs.meta && inputs.meta->continuation)) {
+        return "";
+    }
+    const JobType decoding = type == JobType::Stt ? JobType::Stt
+                           : !inputs.images.empty() ? JobType::Vision : JobType::Text;
+    const std::string sampling = Runner::samplingFingerprint(decoding);
+    if (sampling.empty() && type != JobType::Embed) {
+        return "";
+    }
+    const std::string speculate = inputs.meta && !inputs.meta->speculate.empty()
+        ? inputs.meta->speculate : Runner::defaultSpeculation();
+
+    std::string key = resultKeyPrefix_;
+    key += "type " + std::string(contract::toString(type)) + "\n";
+    key += "sampling " + sampling + "\n";
+    key += "speculate " + speculate + "\n";
+    key += "format " + (inputs.meta ? inputs.meta->output_format : std::string()) + "\n";
+    // SHA-256, like the attachments: a prompt crafted to collide must not
+    // be answered with another job's result.
+    key += "grammar " + sha256Hex(inputs.grammar.content) + "\n";
+    key += "prompt " + sha256Hex(inputs.prompt.content) + "\n";
+    for (const auto* paths : {&inputs.images, &inputs.audio}) {
+        for (const auto& path : *paths) {
+            const auto hash = mediaCache_ ? mediaCache_->contentHash(path) : MediaCache::hashFile(path);
+            if (hash.empty()) {
+                return "";
+            }
+            key += (paths == &inputs.images ? "image " : "audio ") + hash + "\n";
+        }
+    }
+    return key;
+}
+
+bool Processor::readConversation(const JobId& parent, std::vector<ChatTurn>& turns,
+                                 std::string& error) const noexcept {
+    try {
+        const auto readText = [](const std::filesystem::path& path, std::string& content) {
+            std::error_code ec;
+            if (!std::filesystem::is_regular_file(path, ec)) return false;
+            std::ifstream file(path, std::ios::binary);
+            content.assign((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            return static_cast<bool>(file) || file.eof();
+        };
+
+        // Earlier turns may have been compacted out of output/.
+        std::optional<Archive> archive;
+        const auto readTurnFile = [&](const JobId& id, const char* name, std::string& content) {
+            if (readText(contract::jobDir(workspace_, Status::Done, id) / name, content)) return true;
+            if (!archive) {
+                archive.emplace(workspace_);
+                archive->refresh();
+            }
+            auto data = archive->readFile(id, name);
+            if (!data) return false;
+            content = std::move(*data);
+            return true;
+        };
+
+        // Walk up the chain of continuation jobs; the root turn is the first
+        // job without --continue or without a parent.
+        JobId current = parent;
+        for (std::size_t depth = 0; !current.empty(); ++depth) {
+            if (depth >= kMaxConversationTurns) {
+                error = "Conversation exceeds " + std::to_string(kMaxConversationTurns) + " turns";
+                return false;
+            }
+            ChatTurn turn;
+            if (!readTurnFile(current, contract::kPromptFile, turn.user) ||
+                !readTurnFile(current, contract::kResultFile, turn.assistant)) {
+                error = "Parent job " + current + " has no completed result";
+                return false;
+            }
+            turns.insert(turns.begin(), std::move(turn));
+            std::string metaText;
+            const auto meta = readTurnFile(current, contract::kMetaFile, metaText) ? parseMetaJson(metaText)
+                                                                                    : std::nullopt;
+            current = meta && meta->continuation ? meta->parent : JobId();
+        }
+        return true;
+    } catch (const std::exception& e) {
+        error = "Failed to read conversation: " + std::string(e.what());
+        return false;
+    }
+}
+
+std::string Processor::readSystemPrompt() const noexcept {
+    try {
+        const auto path = workspace_ / contract::kSystemPromptFile;
+        std::error_code ec;
+        if (!std::filesystem::is_regular_file(path, ec)) {
+            return "";
+        }
+        std::ifstream file(path, std::ios::binary);
+        std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        while (!content.empty() && std::isspace(static_cast<unsigned char>(content.back()))) {
+            content.pop_back();
+        }
+        return content;
+    } catch (const std::exception& e) {
+        LOG_WARN("Failed to read system prompt: " + std::string(e.what()));
+        return "";
+    }
+}
+
 // CRITICAL: Metal-compatible per-thread Runner management
 Runner* Processor::getRunnerForWorker(int workerId) {
     std::lock_guard<std::mutex> lock(runnersMutex_);
@@ -729,66 +1160,4 @@ TtsRunner* Processor::getTtsRunnerForWorker(int workerId) {
     return it->second.get();
 }
 
-bool Processor::finalizeAudio(const JobId& jobId, const std::vector<float>& audio, int sampleRate) noexcept {
-    try {
-        auto processingPath = getJobPath(contract::kProcessingDir, jobId);
-        auto outputPath = getJobPath(contract::kOutputDir, jobId);
-
-        // Write WAV to temp file first
-        auto tempPath = processingPath / (std::string(contract::kAudioFile) + ".tmp");
-        {
-            std::ofstream file(tempPath, std::ios::binary);
-            if (!file) return false;
-
-            // WAV header
-            struct {
-                char riff[4] = {'R', 'I', 'F', 'F'};
-                uint32_t chunk_size;
-                char wave[4] = {'W', 'A', 'V', 'E'};
-                char fmt[4] = {'f', 'm', 't', ' '};
-                uint32_t fmt_chunk_size = 16;
-                uint16_t audio_format = 1;
-                uint16_t num_channels = 1;
-                uint32_t sample_rate;
-                uint32_t byte_rate;
-                uint16_t block_align;
-                uint16_t bits_per_sample = 16;
-                char data[4] = {'d', 'a', 't', 'a'};
-                uint32_t data_size;
-            } header;
-            static_assert(sizeof(header) == 44, "WAV header struct has unexpected padding");
-
-            header.sample_rate = static_cast<uint32_t>(sampleRate);
-            header.byte_rate = header.sample_rate * header.num_channels * (header.bits_per_sample / 8);
-            header.block_align = header.num_channels * (header.bits_per_sample / 8);
-            header.data_size = static_cast<uint32_t>(audio.size() * (header.bits_per_sample / 8));
-            header.chunk_size = 36 + header.data_size;
-
-            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
-            for (const auto& sample : audio) {
-                int16_t pcm = static_cast<int16_t>(std::max(-32768.0, std::min(32767.0, sample * 32767.0)));
-                file.write(reinterpret_cast<const char*>(&pcm), sizeof(pcm));
-            }
-            file.flush();
-            if (!file.good()) return false;
-        }
-
-        // Rename temp to final
-        auto finalPath = processingPath / contract::kAudioFile;
-        std::filesystem::rename(tempPath, finalPath);
-
-        // Atomic move to output
-        std::filesystem::rename(processingPath, outputPath);
-
-        LOG_DEBUG("TTS job finalized: " + jobId);
-        return true;
-    } catch (const std::exception& e) {
-        LOG_ERROR("Failed to finalize audio for job " + jobId + ": " + std::string(e.what()));
-        return false;
-    } catch (...) {
-        LOG_ERROR("Unknown error finalizing audio for job: " + jobId);
-        return false;
-    }
-}
-
 }
@@ -0,0 +1,148 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "nrvna/ready_watcher.hpp"
+#include "nrvna/logger.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <thread>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/inotify.h>
+#elif defined(__APPLE__)
+#include <sys/event.h>
+#endif
+
+namespace nrvna {
+
+namespace {
+void closeFd(int& fd) noexcept {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+bool setNonBlocking(int fd) noexcept {
+    const int flags = ::fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0 &&
+           ::fcntl(fd, F_SETFD, FD_CLOEXEC) == 0;
+}
+}
+
+ReadyWatcher::ReadyWatcher(const std::filesystem::path& readyDir) noexcept {
+    int fds[2];
+    if (::pipe(fds) == 0) {
+        wakeRead_ = fds[0];
+        wakeWrite_ = fds[1];
+        if (!setNonBlocking(wakeRead_) || !setNonBlocking(wakeWrite_)) {
+            closeFd(wakeRead_);
+            closeFd(wakeWrite_);
+        }
+    }
+    if (wakeRead_ < 0) {
+        LOG_WARN("Cannot create scanner wake pipe; polling " + readyDir.string());
+        return;
+    }
+
+#if defined(__linux__)
+    // Work::submit publishes with a rename, so IN_MOVED_TO is the arrival.
+    watchFd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watchFd_ >= 0 &&
+        ::inotify_add_watch(watchFd_, readyDir.c_str(), IN_MOVED_TO | IN_CREATE | IN_ONLYDIR) < 0) {
+        closeFd(watchFd_);
+    }
+#elif defined(__APPLE__)
+    // kqueue reports that the directory changed, not which entry arrived.
+    dirFd_ = ::open(readyDir.c_str(), O_EVTONLY | O_CLOEXEC);
+    if (dirFd_ >= 0) {
+        watchFd_ = ::kqueue();
+        struct kevent change;
+        EV_SET(&change, dirFd_, EVFILT_VNODE, EV_ADD | EV_CLEAR, NOTE_WRITE, 0, nullptr);
+        if (watchFd_ >= 0 && ::kevent(watchFd_, &change, 1, nullptr, 0, nullptr) < 0) {
+            closeFd(watchFd_);
+        }
+    }
+    if (watchFd_ < 0) {
+        closeFd(dirFd_);
+    }
+#endif
+
+    if (watchFd_ < 0) {
+        LOG_WARN("Cannot watch " + readyDir.string() + "; falling back to polling");
+    } else {
+        LOG_DEBUG("Watching " + readyDir.string() + " for new jobs");
+    }
+}
+
+ReadyWatcher::~ReadyWatcher() {
+    closeFd(watchFd_);
+    closeFd(dirFd_);
+    closeFd(wakeRead_);
+    closeFd(wakeWrite_);
+}
+
+WatchEvents ReadyWatcher::wait(std::chrono::milliseconds timeout) noexcept {
+    WatchEvents events;
+    if (timeout.count() < 0) {
+        timeout = std::chrono::milliseconds(0);
+    }
+    if (wakeRead_ < 0) {
+        std::this_thread::sleep_for(std::min(timeout, std::chrono::milliseconds(100)));
+        return events;
+    }
+
+    struct pollfd fds[2] = {{wakeRead_, POLLIN, 0}, {watchFd_, POLLIN, 0}};
+    const nfds_t count = watchFd_ >= 0 ? 2 : 1;
+    const int ready = ::poll(fds, count, static_cast<int>(timeout.count()));
+    if (ready <= 0) {
+        return events;
+    }
+
+    if (fds[0].revents & POLLIN) {
+        char drain[64];
+        while (::read(wakeRead_, drain, sizeof(drain)) > 0) {
+        }
+    }
+    if (count < 2 || !(fds[1].revents & POLLIN)) {
+        return events;
+    }
+
+#if defined(__linux__)
+    alignas(struct inotify_event) char buffer[4096];
+    while (true) {
+        const ssize_t n = ::read(watchFd_, buffer, sizeof(buffer));
+        if (n <= 0) break;
+        for (ssize_t offset = 0; offset < n; ) {
+            const auto* event = reinterpret_cast<const struct inotify_event*>(buffer + offset);
+            if (event->mask & IN_Q_OVERFLOW) {
+                events.rescan = true;
+            } else if (event->len > 0) {
+                events.arrived.emplace_back(event->name);
+            }
+            offset += static_cast<ssize_t>(sizeof(struct inotify_event) + event->len);
+        }
+    }
+#elif defined(__APPLE__)
+    struct kevent change;
+    const struct timespec zero = {0, 0};
+    while (::kevent(watchFd_, nullptr, 0, &change, 1, &zero) > 0) {
+        events.rescan = true;
+    }
+#endif
+    return events;
+}
+
+void ReadyWatcher::wake() noexcept {
+    if (wakeWrite_ >= 0) {
+        const char byte = 1;
+        (void)!::write(wakeWrite_, &byte, 1);
+    }
+}
+
+}
@@ -0,0 +1,209 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "nrvna/result_cache.hpp"
+#include "nrvna/hash.hpp"
+#include "nrvna/logger.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace nrvna {
+
+namespace {
+
+constexpr char kMagic[8] = {'N', 'R', 'V', 'R', 'E', 'S', '0', '1'};
+constexpr const char* kEntryExt = ".res";
+
+uint64_t hashText(const std::string& text) noexcept {
+    return fnv1a(text.data(), text.size());
+}
+
+void writeString(std::ostream& out, const std::string& s) {
+    const uint64_t size = s.size();
+    out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    out.write(s.data(), static_cast<std::streamsize>(s.size()));
+}
+
+bool readString(std::istream& in, std::string& s, uint64_t limit) {
+    uint64_t size = 0;
+    if (!in.read(reinterpret_cast<char*>(&size), sizeof(size)) || size > limit) return false;
+    s.resize(size);
+    return static_cast<bool>(in.read(s.data(), static_cast<std::streamsize>(size)));
+}
+
+}
+
+ResultCache::ResultCache(std::filesystem::path dir, std::size_t budgetBytes)
+    : dir_(std::move(dir)), budget_(budgetBytes) {
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+    if (ec) {
+        throw std::runtime_error("Cannot create result cache directory " + dir_.string() + ": " + ec.message());
+    }
+
+    // Rebuild the LRU order from the files' mtimes.
+    struct Found {
+        uint64_t hash;
+        std::filesystem::file_time_type mtime;
+        std::uintmax_t bytes;
+    };
+    std::vector<Found> found;
+    for (const auto& item : std::filesystem::directory_iterator(dir_, ec)) {
+        const auto& path = item.path();
+        if (path.extension() != kEntryExt) {
+            // Leftover temp files from an interrupted write.
+            if (path.extension() == ".tmp") std::filesystem::remove(path, ec);
+            continue;
+        }
+        try {
+            std::error_code fileEc;
+            found.push_back({std::stoull(path.stem().string(), nullptr, 16), item.last_write_time(fileEc),
+                             item.file_size(fileEc)});
+        } catch (const std::exception&) {
+            continue;
+        }
+    }
+    std::sort(found.begin(), found.end(), [](const Found& a, const Found& b) { return a.mtime < b.mtime; });
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : found) {
+        storeLocked(entry.hash, entry.bytes);
+    }
+    LOG_INFO("Result cache: " + std::to_string(entries_.size()) + " results in " + dir_.string());
+}
+
+std::filesystem::path ResultCache::pathFor(uint64_t hash) const {
+    return dir_ / (hex64(hash) + kEntryExt);
+}
+
+std::optional<ResultCache::Entry> ResultCache::lookup(const std::string& key) noexcept {
+    const uint64_t hash = hashText(key);
+    std::uintmax_t bytes = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = entries_.find(hash);
+        if (found == entries_.end()) return std::nullopt;
+        bytes = found->second.bytes;
+    }
+    const auto path = pathFor(hash);
+    try {
+        std::ifstream file(path, std::ios::binary);
+        char magic[sizeof(kMagic)] = {};
+        std::string storedKey;
+        Entry entry;
+        uint64_t floats = 0;
+        if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+            !readString(file, storedKey, bytes) || !readString(file, entry.source, bytes) ||
+            !readString(file, entry.artifact, bytes) || !readString(file, entry.text, bytes) ||
+            !file.read(reinterpret_cast<char*>(&floats), sizeof(floats)) || floats > bytes / sizeof(float)) {
+            // Missing or damaged: drop it.
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+            std::lock_guard<std::mutex> lock(mutex_);
+            forgetLocked(hash);
+            return std::nullopt;
+        }
+        if (storedKey != key) {
+            return std::nullopt;  // another key with the same hash
+        }
+        entry.values.resize(floats);
+        if (!file.read(reinterpret_cast<char*>(entry.values.data()),
+                       static_cast<std::streamsize>(floats * sizeof(float)))) {
+            LOG_WARN("Truncated result cache entry: " + path.string());
+            return std::nullopt;
+        }
+
+        std::error_code ec;
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = entries_.find(hash);
+        if (found != entries_.end()) {
+            lru_.splice(lru_.begin(), lru_, found->second.lru);
+        }
+        return entry;
+    } catch (const std::exception& e) {
+        LOG_WARN("Failed to read result cache entry: " + std::string(e.what()));
+        return std::nullopt;
+    }
+}
+
+bool ResultCache::insert(const std::string& key, const Entry& entry) noexcept {
+    const uint64_t hash = hashText(key);
+    const auto path = pathFor(hash);
+    std::uintmax_t bytes = 0;
+    try {
+        auto tmpPath = path;
+        tmpPath += "." + std::to_string(::getpid()) + "." + hex64(hashText(entry.source)) + ".tmp";
+        {
+            std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+            file.write(kMagic, sizeof(kMagic));
+            writeString(file, key);
+            writeString(file, entry.source);
+            writeString(file, entry.artifact);
+            writeString(file, entry.text);
+            const uint64_t floats = entry.values.size();
+            file.write(reinterpret_cast<const char*>(&floats), sizeof(floats));
+            file.write(reinterpret_cast<const char*>(entry.values.data()),
+                       static_cast<std::streamsize>(floats * sizeof(float)));
+            file.flush();
+            bytes = static_cast<std::uintmax_t>(file.tellp());
+            if (!file || bytes > budget_) {
+                std::error_code ec;
+                std::filesystem::remove(tmpPath, ec);
+                return false;
+            }
+        }
+        std::filesystem::rename(tmpPath, path);
+    } catch (const std::exception& e) {
+        LOG_WARN("Failed to write result cache entry: " + std::string(e.what()));
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    storeLocked(hash, bytes);
+    return true;
+}
+
+void ResultCache::storeLocked(uint64_t hash, std::uintmax_t bytes) {
+    auto it = entries_.find(hash);
+    if (it != entries_.end()) {
+        bytes_ -= it->second.bytes;
+        lru_.erase(it->second.lru);
+        entries_.erase(it);
+    }
+    bytes_ += bytes;
+    lru_.push_front(hash);
+    entries_[hash] = Slot{bytes, lru_.begin()};
+
+    while (bytes_ > budget_ && !lru_.empty()) {
+        const uint64_t victim = lru_.back();
+        std::error_code ec;
+        std::filesystem::remove(pathFor(victim), ec);
+        forgetLocked(victim);
+    }
+}
+
+void ResultCache::forgetLocked(uint64_t hash) {
+    auto it = entries_.find(hash);
+    if (it == entries_.end()) return;
+    bytes_ -= it->second.bytes;
+    lru_.erase(it->second.lru);
+    entries_.erase(it);
+}
+
+std::size_t ResultCache::bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<std::size_t>(bytes_);
+}
+
+std::size_t ResultCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+}
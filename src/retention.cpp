@@ -0,0 +1,344 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "nrvna/retention.hpp"
+#include "nrvna/contract.hpp"
+#include "nrvna/logger.hpp"
+#include "nrvna/meta.hpp"
+#include <algorithm>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <set>
+#include <stdexcept>
+
+#if defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(__APPLE__)
+#include <pthread/qos.h>
+#endif
+
+namespace nrvna {
+
+namespace {
+
+constexpr int64_t kMicrosPerSecond = 1'000'000;
+constexpr std::chrono::seconds kForever = std::chrono::seconds::max();
+constexpr int64_t kMaxHours = 100 * 365 * 24;
+
+// Zero in a policy means no limit.
+std::chrono::seconds limit(std::chrono::seconds ttl) {
+    return ttl.count() > 0 ? ttl : kForever;
+}
+
+int64_t nowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::chrono::seconds hours(const nlohmann::json& value, const std::string& name) {
+    if (!value.is_number() || !(value.get<double>() >= 0.0)) {
+        throw std::runtime_error("\"" + name + "\" is not a non-negative number of hours");
+    }
+    // Anything longer is a typo, and would overflow the conversion below.
+    if (value.get<double>() > kMaxHours) {
+        throw std::runtime_error("\"" + name + "\" exceeds " + std::to_string(kMaxHours) + " hours; use 0 for no limit");
+    }
+    return std::chrono::seconds(static_cast<int64_t>(value.get<double>() * 3600.0));
+}
+
+// Idle CPU and I/O class for the calling thread only.
+void lowerPriority() noexcept {
+#if defined(__linux__)
+    constexpr int kIoprioWhoProcess = 1;  // with id 0: the calling thread
+    constexpr int kIoprioClassIdle = 3;
+    constexpr int kIoprioClassShift = 13;
+    (void)::setpriority(PRIO_PROCESS, static_cast<id_t>(::syscall(SYS_gettid)), 19);
+    (void)::syscall(SYS_ioprio_set, kIoprioWhoProcess, 0, kIoprioClassIdle << kIoprioClassShift);
+#elif defined(__APPLE__)
+    (void)pthread_set_qos_class_self_np(QOS_CLASS_BACKGROUND, 0);
+#endif
+}
+
+// Bytes of a job directory's files, and its inodes including itself.
+Reclaimed measure(const std::filesystem::path& dir) {
+    Reclaimed size;
+    size.inodes = 1;
+    std::error_code ec;
+    for (std::filesystem::recursive_directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        ++size.inodes;
+        std::error_code fileEc;
+        if (it->is_regular_file(fileEc)) {
+            const auto bytes = it->file_size(fileEc);
+            if (!fileEc) size.bytes += bytes;
+        }
+    }
+    return size;
+}
+
+bool writeReclaimStats(const std::filesystem::path& workspace, const ReclaimStats& stats) noexcept {
+    const auto path = workspace / contract::kGcStatsFile;
+    const auto tmpPath = path.string() + ".tmp";
+    try {
+        nlohmann::json document = {
+            {"jobs", stats.jobs},
+            {"bytes", stats.bytes},
+            {"inodes", stats.inodes},
+            {"last_run", stats.last_run},
+        };
+        {
+            std::ofstream out(tmpPath, std::ios::trunc);
+            out << document.dump() << '\n';
+            out.flush();
+            if (!out) {
+                LOG_WARN("Cannot write " + tmpPath);
+                return false;
+            }
+        }
+        std::filesystem::rename(tmpPath, path);
+        return true;
+    } catch (const std::exception& e) {
+        LOG_WARN("Cannot save reclaim totals: " + std::string(e.what()));
+        return false;
+    }
+}
+
+}
+
+std::optional<RetentionPolicy> loadRetentionPolicy(const std::filesystem::path& workspace) {
+    RetentionPolicy policy;
+    const auto path = workspace / contract::kConfigFile;
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec)) {
+        return policy;
+    }
+    try {
+        std::ifstream file(path, std::ios::binary);
+        auto document = nlohmann::json::parse(file);
+        if (!document.is_object()) throw std::runtime_error("not an object");
+        if (!document.contains("retention")) return policy;
+        const auto& section = document["retention"];
+        if (!section.is_object()) throw std::runtime_error("\"retention\" is not an object");
+        for (const auto& [key, value] : section.items()) {
+            if (key == "max_age_hours") {
+                policy.maxAge = hours(value, key);
+            } else if (key == "keep_failed_hours") {
+                policy.keepFailed = hours(value, key);
+            } else if (key == "max_count") {
+                if (!value.is_number_unsigned()) throw std::runtime_error("\"max_count\" is not a non-negative integer");
+                policy.maxCount = value.get<std::size_t>();
+            } else if (key == "tag_ttl_hours") {
+                if (!value.is_object()) throw std::runtime_error("\"tag_ttl_hours\" is not an object");
+                for (const auto& [tag, ttl] : value.items()) {
+                    policy.tagTtl[tag] = hours(ttl, tag);
+                }
+            } else {
+                throw std::runtime_error("unknown retention setting \"" + key + "\"");
+            }
+        }
+        return policy;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Invalid " + path.string() + ": " + e.what());
+        return std::nullopt;
+    }
+}
+
+std::vector<JobId> expiredJobs(const JobIndex& index, const RetentionPolicy& policy, int64_t now_us) {
+    struct Finished {
+        int64_t time_us;
+        JobId id;
+        const JobIndex::Entry* entry;
+    };
+    std::vector<Finished> finished;
+    std::set<JobId> inUse;
+    for (const auto& [id, entry] : index.entries()) {
+        if (entry.state == Status::Done || entry.state == Status::Failed) {
+            finished.push_back({entry.time_us, id, &entry});
+            continue;
+        }
+        // A continuation reads every turn before it.
+        for (JobId parent = entry.parent; !parent.empty() && inUse.insert(parent).second;) {
+            const auto* ancestor = index.find(parent);
+            parent = ancestor ? ancestor->parent : JobId{};
+        }
+    }
+    // Newest first, so the count limit keeps the front.
+    std::sort(finished.begin(), finished.end(), [](const Finished& a, const Finished& b) {
+        return a.time_us != b.time_us ? a.time_us > b.time_us : a.id > b.id;
+    });
+
+    std::vector<JobId> expired;
+    for (std::size_t rank = 0; rank < finished.size(); ++rank) {
+        const auto& job = finished[rank];
+        auto ttl = limit(job.entry->state == Status::Failed && policy.keepFailed.count() > 0 ? policy.keepFailed
+                                                                                             : policy.maxAge);
+        bool tagged = false;
+        for (const auto& tag : job.entry->tags) {
+            auto found = policy.tagTtl.find(tag);
+            if (found == policy.tagTtl.end()) continue;
+            ttl = tagged ? std::min(ttl, limit(found->second)) : limit(found->second);
+            tagged = true;
+        }
+        const bool tooOld = ttl != kForever && now_us - job.time_us > ttl.count() * kMicrosPerSecond;
+        const bool tooMany = policy.maxCount > 0 && rank >= policy.maxCount;
+        if ((tooOld || tooMany) && inUse.count(job.id) == 0) {
+            expired.push_back(job.id);
+        }
+    }
+    std::reverse(expired.begin(), expired.end());
+    return expired;
+}
+
+std::optional<ReclaimStats> readReclaimStats(const std::filesystem::path& workspace) noexcept {
+    try {
+        std::ifstream file(workspace / contract::kGcStatsFile, std::ios::binary);
+        if (!file) return std::nullopt;
+        auto document = nlohmann::json::parse(file);
+        ReclaimStats stats;
+        stats.jobs = document.value("jobs", uint64_t{0});
+        stats.bytes = document.value("bytes", uint64_t{0});
+        stats.inodes = document.value("inodes", uint64_t{0});
+        stats.last_run = document.value("last_run", std::string{});
+        return stats;
+    } catch (...) {
+        return std::nullopt;
+    }
+}
+
+GarbageCollector::GarbageCollector(std::filesystem::path workspace, RetentionPolicy policy,
+                                   std::chrono::seconds interval, std::size_t batchSize,
+                                   std::chrono::milliseconds pause) noexcept
+    : workspace_(workspace), policy_(std::move(policy)), interval_(interval),
+      batchSize_(std::max<std::size_t>(1, batchSize)), pause_(pause), index_(workspace),
+      archive_(std::move(workspace)) {}
+
+GarbageCollector::~GarbageCollector() {
+    stop();
+}
+
+bool GarbageCollector::start() noexcept {
+    try {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (thread_.joinable()) {
+            return true;
+        }
+        stopping_ = false;
+        thread_ = std::thread(&GarbageCollector::loop, this);
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to start garbage collector: " + std::string(e.what()));
+        return false;
+    }
+}
+
+void GarbageCollector::stop() noexcept {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+bool GarbageCollector::rest() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return !wake_.wait_for(lock, pause_, [&] { return stopping_; });
+}
+
+ReclaimStats GarbageCollector::collect() {
+    ReclaimStats pass;
+    if (!loaded_) {
+        loaded_ = index_.load();
+        if (!loaded_) return pass;
+    } else {
+        index_.refresh();
+    }
+    archive_.refresh();
+
+    auto totals = readReclaimStats(workspace_).value_or(ReclaimStats{});
+    const auto due = expiredJobs(index_, policy_, nowMicros());
+    for (std::size_t i = 0; i < due.size(); i += batchSize_) {
+        const auto last = std::min(due.size(), i + batchSize_);
+        std::vector<JobId> packed;
+        std::vector<JobId> removed;
+        {
+            // Keeps the compactor from packing a directory being removed.
+            std::lock_guard<std::mutex> lock(Archive::writeMutex());
+            for (std::size_t j = i; j < last; ++j) {
+                const auto& id = due[j];
+                const auto* entry = index_.find(id);
+                const auto dir = contract::jobDir(workspace_, entry->state, id);
+                std::error_code ec;
+                if (!std::filesystem::is_directory(dir, ec)) {
+                    packed.push_back(id);
+                    continue;
+                }
+                const auto size = measure(dir);
+                std::filesystem::remove_all(dir, ec);
+                if (ec) {
+                    LOG_WARN("Cannot remove expired job " + id + ": " + ec.message());
+                    continue;
+                }
+                pass.bytes += size.bytes;
+                pass.inodes += size.inodes;
+                ++pass.jobs;
+                removed.push_back(id);
+            }
+        }
+
+        archive_.refresh();
+        std::vector<JobId> archived;
+        for (const auto& id : packed) {
+            if (archive_.contains(id)) archived.push_back(id);
+        }
+        const auto segments = archive_.remove(archived);
+        pass.bytes += segments.bytes;
+        pass.inodes += segments.inodes;
+        pass.jobs += archived.size();
+        // Entries for jobs already gone elsewhere are dropped as well.
+        for (const auto* list : {&removed, &packed}) {
+            for (const auto& id : *list) {
+                journal::append(workspace_, id, Status::Missing);
+            }
+        }
+
+        if (last < due.size() && !rest()) break;
+    }
+
+    totals.jobs += pass.jobs;
+    totals.bytes += pass.bytes;
+    totals.inodes += pass.inodes;
+    totals.last_run = formatTimestamp();
+    pass.last_run = totals.last_run;
+    (void)writeReclaimStats(workspace_, totals);
+    if (pass.jobs > 0) {
+        LOG_INFO("Retention removed " + std::to_string(pass.jobs) + " job(s), " +
+                 std::to_string(pass.bytes) + " bytes, " + std::to_string(pass.inodes) + " inodes");
+    }
+    return pass;
+}
+
+void GarbageCollector::loop() {
+    setThreadName("GC");
+    lowerPriority();
+
+    while (true) {
+        try {
+            collect();
+        } catch (const std::exception& e) {
+            LOG_WARN("Retention pass failed: " + std::string(e.what()));
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (wake_.wait_for(lock, interval_, [&] { return stopping_; })) {
+            break;
+        }
+    }
+}
+
+}
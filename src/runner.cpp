@@ -5,8 +5,15 @@
  */
 
 #include "nrvna/runner.hpp"
+#include "nrvna/batch_engine.hpp"
+#include "nrvna/job_control.hpp"
 #include "nrvna/logger.hpp"
+#include "nrvna/media_encoder.hpp"
+#include "nrvna/prefix_cache.hpp"
 #include "llama_util.hpp"
+#include "speculative.hpp"
+#include "text_stream.hpp"
+#include "nrvna/kv_store.hpp"
 #include "chat.h"
 #include "llama.h"
 #include "mtmd.h"
@@ -20,13 +27,22 @@
 
 namespace nrvna {
 
-// Static member definitions (model is shared, mtmd context is per-worker)
+// Static member definitions (model and media encoder are shared)
 std::shared_ptr<llama_model> Runner::shared_model_ = nullptr;
 std::string Runner::current_model_path_ = "";
+std::string Runner::current_model_identity_;
 std::mutex Runner::model_mutex_;
+std::shared_ptr<llama_model> Runner::draft_model_ = nullptr;
+std::weak_ptr<MediaEncoder> Runner::shared_media_;
+std::string Runner::media_path_;
 
 common_chat_templates* Runner::chat_templates_ = nullptr;
 
+std::string Runner::system_prompt_;
+std::vector<int32_t> Runner::template_head_;
+bool Runner::template_head_ready_ = false;
+std::mutex Runner::template_head_mutex_;
+
 // Use these sampling fallbacks when GGUF sampling metadata is not available.
 float Runner::gguf_temp_           = 0.8f;
 int   Runner::gguf_top_k_          = 40;
@@ -35,48 +51,41 @@ float Runner::gguf_min_p_          = 0.05f;
 float Runner::gguf_repeat_penalty_ = 1.1f;
 int   Runner::gguf_repeat_last_n_  = 64;
 
-// Vision encoding mutex - serializes mtmd_helper_eval_chunks across all workers
-// because the underlying GGML compute graph has shared state that corrupts
-// when multiple vision encodings run simultaneously
-static std::mutex vision_encoding_mutex_;
-
-struct LlamaContextDeleter {
-    void operator()(llama_context* ctx) const noexcept {
-        if (ctx) llama_free(ctx);
-    }
-};
-using LlamaContextPtr = std::unique_ptr<llama_context, LlamaContextDeleter>;
-
-struct LlamaSamplerDeleter {
-    void operator()(llama_sampler* smpl) const noexcept {
-        if (smpl) llama_sampler_free(smpl);
+// Apply the same L2 normalization as common_embd_normalize(, , , 2).
+// Non-zero stored vectors have unit length. Zero vectors remain zero.
+// This supports direct dot-product comparison without reader-side normalization.
+static void normalizeEmbedding(std::vector<float>& embedding) {
+    double norm = 0.0;
+    for (float v : embedding) { norm += v * v; }
+    norm = std::sqrt(norm);
+    if (norm > 0.0) {
+        for (float& v : embedding) { v /= norm; }
     }
-};
-using LlamaSamplerPtr = std::unique_ptr<llama_sampler, LlamaSamplerDeleter>;
+}
 
-struct MtmdChunksDeleter {
-    void operator()(mtmd_input_chunks* chunks) const noexcept {
-        if (chunks) mtmd_input_chunks_free(chunks);
-    }
+struct LlamaBatchOwner {
+    llama_batch value;
+    explicit LlamaBatchOwner(int nTokens) : value(llama_batch_init(nTokens, 0, 1)) {}
+    ~LlamaBatchOwner() { llama_batch_free(value); }
 };
-using MtmdChunksPtr = std::unique_ptr<mtmd_input_chunks, MtmdChunksDeleter>;
 
-struct BitmapList {
-    std::vector<mtmd_bitmap*> values;
-    ~BitmapList() {
-        for (auto* bitmap : values) mtmd_bitmap_free(bitmap);
+// Lets ggml abort a long prefill or decode on this context once the job stops.
+struct AbortScope {
+    llama_context* ctx;
+    AbortScope(llama_context* ctx_, JobControl* control) : ctx(control ? ctx_ : nullptr) {
+        if (ctx) llama_set_abort_callback(ctx, JobControl::abortCallback, control);
     }
-    void clear() {
-        for (auto* bitmap : values) mtmd_bitmap_free(bitmap);
-        values.clear();
+    ~AbortScope() {
+        if (ctx) llama_set_abort_callback(ctx, nullptr, nullptr);
     }
+    AbortScope(const AbortScope&) = delete;
+    AbortScope& operator=(const AbortScope&) = delete;
 };
 
-struct LlamaBatchOwner {
-    llama_batch value;
-    explicit LlamaBatchOwner(int nTokens) : value(llama_batch_init(nTokens, 0, 1)) {}
-    ~LlamaBatchOwner() { llama_batch_free(value); }
-};
+// The stop reason when the job was cancelled or expired, else the fallback.
+static std::string stopError(JobControl* control, const char* fallback) {
+    return control && control->stopRequested() ? control->reason() : fallback;
+}
 
 // Remove closed and unclosed <think> blocks from reasoning model output.
 // A block can remain open when the model reaches n_predict during reasoning.
@@ -160,15 +169,43 @@ static std::string extractAsrText(const std::string& text) {
     return trimWhitespace(result);
 }
 
-static std::optional<std::string> tokenPiece(const llama_vocab* vocab, llama_token token) {
-    char stack[128];
-    int n = llama_token_to_piece(vocab, token, stack, sizeof(stack), 0, true);
-    if (n >= 0) return std::string(stack, static_cast<size_t>(n));
+// Round a context request up to a power-of-two size class (>= 512) so pooled
+// contexts are reused across jobs of similar size. Never exceed cap unless the
+// request itself does.
+static uint32_t contextSizeClass(uint32_t n_ctx, uint32_t cap) {
+    uint32_t bucket = 512;
+    while (bucket < n_ctx && bucket < (1u << 30)) bucket <<= 1;
+    return std::max(n_ctx, std::min(bucket, cap));
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
 
-    std::vector<char> buffer(static_cast<size_t>(-n));
-    n = llama_token_to_piece(vocab, token, buffer.data(), buffer.size(), 0, true);
-    if (n < 0) return std::nullopt;
-    return std::string(buffer.data(), static_cast<size_t>(n));
+static void recordDecodeMetrics(std::map<std::string, double>& metrics, int generated, int drafted,
+                                int accepted, double seconds) {
+    if (generated > 0 && seconds > 0.0) {
+        metrics["tokens_per_s"] = generated / seconds;
+    }
+    if (drafted > 0) {
+        metrics["draft_tokens"] = drafted;
+        metrics["draft_accepted"] = accepted;
+        metrics["draft_acceptance"] = static_cast<double>(accepted) / drafted;
+    }
+}
+
+// Text tokens of every text chunk, in order. Drafters condition on these
+// because they cannot see media embeddings.
+static std::vector<llama_token> chunkTextTokens(mtmd_input_chunks* chunks) {
+    std::vector<llama_token> tokens;
+    for (size_t i = 0; i < mtmd_input_chunks_size(chunks); ++i) {
+        const mtmd_input_chunk* chunk = mtmd_input_chunks_get(chunks, i);
+        if (mtmd_input_chunk_get_type(chunk) != MTMD_INPUT_CHUNK_TYPE_TEXT) continue;
+        size_t n_tokens = 0;
+        const llama_token* text = mtmd_input_chunk_get_tokens_text(chunk, &n_tokens);
+        tokens.insert(tokens.end(), text, text + n_tokens);
+    }
+    return tokens;
 }
 
 // Read GGUF metadata helpers
@@ -247,8 +284,62 @@ ModelInfo Runner::probeModelInfo(const std::string& modelPath) {
     return info;
 }
 
-Runner::Runner(const std::string& modelPath, const std::string& mmprojPath, int numWorkers)
-    : mmproj_path_(mmprojPath) {
+std::shared_ptr<BatchEngine> Runner::createBatchEngine(int maxSequences) {
+    std::lock_guard<std::mutex> lock(model_mutex_);
+    if (!shared_model_) {
+        return nullptr;
+    }
+    if (llama_model_has_encoder(shared_model_.get())) {
+        LOG_WARN("Batching engine does not support encoder-decoder models; using per-job contexts");
+        return nullptr;
+    }
+
+    const int max_ctx = std::min(llama_model_n_ctx_train(shared_model_.get()), env_positive_int("NRVNA_MAX_CTX", 8192));
+    try {
+        auto engine = std::make_shared<BatchEngine>(shared_model_, maxSequences, max_ctx);
+        if (!engine->start()) {
+            return nullptr;
+        }
+        return engine;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Batching engine unavailable: " + std::string(e.what()));
+        return nullptr;
+    }
+}
+
+bool Runner::loadDraftModel(const std::string& draftPath) {
+    std::lock_guard<std::mutex> lock(model_mutex_);
+    if (!shared_model_) {
+        return false;
+    }
+    if (llama_model_has_encoder(shared_model_.get())) {
+        LOG_ERROR("Speculative decoding does not support encoder-decoder models");
+        return false;
+    }
+
+    LOG_INFO("Loading draft model: " + draftPath);
+    llama_model_params model_params = llama_model_default_params();
+    model_params.n_gpu_layers = effective_gpu_layers();
+    if (model_params.n_gpu_layers <= 0) {
+        restrictModelToCpu(model_params);
+    }
+    llama_model* model = llama_model_load_from_file(draftPath.c_str(), model_params);
+    if (!model) {
+        LOG_ERROR("Failed to load draft model: " + draftPath);
+        return false;
+    }
+    if (!vocabsCompatible(shared_model_.get(), model)) {
+        LOG_ERROR("Draft model vocabulary does not match the main model: " + draftPath);
+        llama_model_free(model);
+        return false;
+    }
+    draft_model_ = std::shared_ptr<llama_model>(model, llama_model_free);
+    LOG_INFO("Speculative decoding enabled, up to " + std::to_string(env_int("NRVNA_DRAFT_MAX", 8)) +
+             " draft tokens per step");
+    return true;
+}
+
+Runner::Runner(const std::string& modelPath, const std::string& mmprojPath) {
     llama_log_set(filtered_llama_log, nullptr);
     ggml_backend_load_all();
 
@@ -279,6 +370,7 @@ Runner::Runner(const std::string& modelPath, const std::string& mmprojPath, int
 
             shared_model_ = std::shared_ptr<llama_model>(model, llama_model_free);
             current_model_path_ = modelPath;
+            current_model_identity_ = KvSnapshotStore::modelIdentity(modelPath);
 
             // Resolve GGUF sampling defaults once. Log values from the model.
             auto resolveGgufFloat = [&](const char* key, float hardcoded, float& out) {
@@ -326,44 +418,54 @@ Runner::Runner(const std::string& modelPath, const std::string& mmprojPath, int
         }
     }
 
-    // Each worker gets its own mtmd context (NOT thread-safe, so per-instance)
-    // CRITICAL: Divide CPU threads among workers to prevent contention
+    // One mtmd context serves every worker. The GGML graph behind it is not
+    // safe to run concurrently, so its encoder thread does all image and audio
+    // encoding, with every CPU thread.
     if (!mmprojPath.empty()) {
-        LOG_INFO("Loading mmproj: " + mmprojPath);
-        mtmd_context_params mparams = mtmd_context_params_default();
-        mparams.use_gpu = effective_gpu_layers() > 0;
-
-        // Divide threads among workers to prevent parallel vision corruption
-        int total_threads = std::thread::hardware_concurrency();
-        mparams.n_threads = std::max(1, total_threads / std::max(1, numWorkers));
-        LOG_INFO("Vision threads per worker: " + std::to_string(mparams.n_threads) +
-                 " (total: " + std::to_string(total_threads) + ", workers: " + std::to_string(numWorkers) + ")");
-        mparams.print_timings = false;
-        mparams.warmup = env_int("NRVNA_WARMUP", 0) != 0;
+        std::lock_guard<std::mutex> lock(model_mutex_);
+        if (media_path_ == mmprojPath) {
+            media_ = shared_media_.lock();
+        }
+        if (!media_) {
+            LOG_INFO("Loading mmproj: " + mmprojPath);
+            mtmd_context_params mparams = mtmd_context_params_default();
+            mparams.use_gpu = effective_gpu_layers() > 0;
+            mparams.n_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+            LOG_INFO("Media encoder threads: " + std::to_string(mparams.n_threads));
+            mparams.print_timings = false;
+            mparams.warmup = env_int("NRVNA_WARMUP", 0) != 0;
+
+            int image_max_tokens = env_int("NRVNA_IMAGE_MAX_TOKENS", 0);
+            if (image_max_tokens > 0) {
+                mparams.image_max_tokens = image_max_tokens;
+                LOG_INFO("Image max tokens: " + std::to_string(image_max_tokens));
+            }
 
-        int image_max_tokens = env_int("NRVNA_IMAGE_MAX_TOKENS", 0);
-        if (image_max_tokens > 0) {
-            mparams.image_max_tokens = image_max_tokens;
-            LOG_INFO("Image max tokens: " + std::to_string(image_max_tokens));
-        }
+            int flash_attn = env_int("NRVNA_FLASH_ATTN", -1);
+            if (flash_attn >= 0) {
+                mparams.flash_attn_type = static_cast<llama_flash_attn_type>(flash_attn);
+                LOG_INFO("Flash attention: " + std::to_string(flash_attn));
+            }
 
-        int flash_attn = env_int("NRVNA_FLASH_ATTN", -1);
-        if (flash_attn >= 0) {
-            mparams.flash_attn_type = static_cast<llama_flash_attn_type>(flash_attn);
-            LOG_INFO("Flash attention: " + std::to_string(flash_attn));
+            mtmd_context* ctx = mtmd_init_from_file(mmprojPath.c_str(), shared_model_.get(), mparams);
+            if (!ctx) {
+                LOG_WARN("Failed to load mmproj: " + mmprojPath + " - running in text-only mode");
+            } else {
+                auto encoder = std::make_shared<MediaEncoder>(ctx, shared_model_);
+                if (encoder->start()) {
+                    media_ = encoder;
+                    shared_media_ = encoder;
+                    media_path_ = mmprojPath;
+                    LOG_INFO("Multimodal support enabled");
+                }
+            }
         }
+    }
+}
 
-        mtmd_context* ctx = mtmd_init_from_file(mmprojPath.c_str(), shared_model_.get(), mparams);
-        if (!ctx) {
-            LOG_WARN("Failed to load mmproj: " + mmprojPath + " - running in text-only mode");
-            mtmd_ctx_ = nullptr;
-        } else {
-            mtmd_owned_ = std::shared_ptr<mtmd_context>(ctx, mtmd_free);
-            mtmd_ctx_ = ctx;
-            LOG_INFO("Multimodal support enabled");
-        }
-    } else {
-        mtmd_ctx_ = nullptr;
+void Runner::attachMediaCache(std::shared_ptr<MediaCache> cache) noexcept {
+    if (media_) {
+        media_->attachCache(std::move(cache));
     }
 }
 
@@ -371,10 +473,9 @@ Runner::~Runner() {
     // chat_templates_ is shared. Free it only when the model changes.
 }
 
-Runner::SamplingConfig Runner::buildSamplingConfig() const {
+Runner::SamplingConfig Runner::samplingConfig(JobType type) {
     SamplingConfig config;
-    const llama_model* model = shared_model_.get();
-    const int n_ctx_train = llama_model_n_ctx_train(model);
+    const int n_ctx_train = llama_model_n_ctx_train(shared_model_.get());
 
     // Precedence: env var > GGUF metadata (cached at model load) > hardcoded default
     config.temp           = env_float("NRVNA_TEMP",           gguf_temp_);
@@ -392,6 +493,38 @@ Runner::SamplingConfig Runner::buildSamplingConfig() const {
     }
     config.n_predict = n_predict;
 
+    if (type == JobType::Vision) {
+        // Lower temperature for vision tasks (more accurate OCR/descriptions)
+        config.temp = env_float("NRVNA_VISION_TEMP", 0.3f);
+    } else if (type == JobType::Stt) {
+        config.temp = env_float("NRVNA_STT_TEMP", config.temp);
+        config.n_predict = env_int("NRVNA_STT_PREDICT", config.n_predict);
+    }
+    return config;
+}
+
+std::string Runner::samplingFingerprint(JobType type) {
+    if (!shared_model_) {
+        return "";
+    }
+    const SamplingConfig config = samplingConfig(type);
+    // LLAMA_DEFAULT_SEED draws a new seed per sampler; greedy decoding ignores it.
+    if (config.seed == LLAMA_DEFAULT_SEED && config.temp > 0.0f) {
+        return "";
+    }
+    const char* thinking = std::getenv("NRVNA_THINKING");
+    return std::to_string(config.temp) + "/" + std::to_string(config.top_k) + "/" +
+           std::to_string(config.top_p) + "/" + std::to_string(config.min_p) + "/" +
+           std::to_string(config.repeat_penalty) + "/" + std::to_string(config.repeat_last_n) + "/" +
+           std::to_string(config.seed) + "/" + std::to_string(config.n_predict) + "/" +
+           std::to_string(config.max_ctx) + "/" + (thinking && std::string(thinking) == "0" ? "nothink" : "think") +
+           "/" + std::to_string(env_int("NRVNA_IMAGE_MAX_TOKENS", 0));
+}
+
+Runner::SamplingConfig Runner::buildSamplingConfig(JobType type) const {
+    SamplingConfig config = samplingConfig(type);
+    const int n_ctx_train = llama_model_n_ctx_train(shared_model_.get());
+
     const int batch = env_positive_int("NRVNA_BATCH", 2048);
     const int ubatch = env_positive_int("NRVNA_UBATCH", batch);
     const int image_max_tokens = env_int("NRVNA_IMAGE_MAX_TOKENS", 0);
@@ -455,12 +588,83 @@ llama_sampler* Runner::buildSampler(const SamplingConfig& config, const llama_vo
     return smpl;
 }
 
+std::shared_ptr<llama_context> Runner::acquireContext(llama_context_params params) {
+    const int poolSize = env_int("NRVNA_CONTEXT_POOL", 2);
+    if (poolSize <= 0) {
+        llama_context* ctx = llama_init_from_model(shared_model_.get(), params);
+        return ctx ? std::shared_ptr<llama_context>(ctx, llama_free) : nullptr;
+    }
+
+    const auto cap = static_cast<uint32_t>(std::min(llama_model_n_ctx_train(shared_model_.get()),
+                                                    env_positive_int("NRVNA_MAX_CTX", 8192)));
+    params.n_ctx = contextSizeClass(params.n_ctx, cap);
+    if (params.embeddings && params.pooling_type == LLAMA_POOLING_TYPE_UNSPECIFIED) {
+        // Encoder-style embedding models need the whole input in one ubatch.
+        params.n_batch = params.n_ctx;
+        params.n_ubatch = params.n_ctx;
+    } else {
+        params.n_batch = std::min(params.n_ctx, static_cast<uint32_t>(env_positive_int("NRVNA_BATCH", 2048)));
+        params.n_ubatch = std::min(params.n_batch,
+                                   static_cast<uint32_t>(env_positive_int("NRVNA_UBATCH", static_cast<int>(params.n_batch))));
+    }
+
+    std::string key = std::to_string(params.n_ctx) + (params.embeddings ? "/embd/" : "/gen/") +
+                      std::to_string(static_cast<int>(params.pooling_type));
+    if (params.n_seq_max > 1) {
+        key += "/seq" + std::to_string(params.n_seq_max);
+    }
+    auto it = context_pool_.find(key);
+    if (it != context_pool_.end()) {
+        context_lru_.erase(std::find(context_lru_.begin(), context_lru_.end(), key));
+        context_lru_.push_back(key);
+        llama_memory_clear(llama_get_memory(it->second.get()), true);
+        return it->second;
+    }
+
+    llama_context* raw = llama_init_from_model(shared_model_.get(), params);
+    if (!raw) {
+        return nullptr;
+    }
+    std::shared_ptr<llama_context> ctx(raw, llama_free);
+    context_pool_[key] = ctx;
+    context_lru_.push_back(key);
+    while (context_lru_.size() > static_cast<size_t>(poolSize)) {
+        context_pool_.erase(context_lru_.front());
+        context_lru_.erase(context_lru_.begin());
+    }
+    LOG_DEBUG("Pooled context created: n_ctx=" + std::to_string(params.n_ctx) + " (" + key + ")");
+    return ctx;
+}
+
+std::shared_ptr<llama_sampler> Runner::acquireSampler(const SamplingConfig& config, const llama_vocab* vocab,
+                                                      const std::string& grammar) {
+    // Grammar samplers carry per-job parse state, so they are always fresh.
+    if (!grammar.empty() || env_int("NRVNA_CONTEXT_POOL", 2) <= 0) {
+        return std::shared_ptr<llama_sampler>(buildSampler(config, vocab, grammar), llama_sampler_free);
+    }
+
+    const std::string key = std::to_string(config.temp) + "/" + std::to_string(config.top_k) + "/" +
+                            std::to_string(config.top_p) + "/" + std::to_string(config.min_p) + "/" +
+                            std::to_string(config.repeat_penalty) + "/" + std::to_string(config.repeat_last_n) + "/" +
+                            std::to_string(config.seed);
+    auto it = sampler_pool_.find(key);
+    if (it != sampler_pool_.end()) {
+        llama_sampler_reset(it->second.get());
+        return it->second;
+    }
+
+    std::shared_ptr<llama_sampler> smpl(buildSampler(config, vocab, ""), llama_sampler_free);
+    sampler_pool_[key] = smpl;
+    return smpl;
+}
+
 RunResult Runner::run(const std::string& prompt, const GenerationOptions& options) {
     return runText(prompt, options);
 }
 
-RunResult Runner::transcribe(const std::string& prompt, const std::vector<std::filesystem::path>& audioPaths) {
-    return runStt(prompt, audioPaths);
+RunResult Runner::transcribe(const std::string& prompt, const std::vector<std::filesystem::path>& audioPaths,
+                             JobControl* control) {
+    return runStt(prompt, audioPaths, control);
 }
 
 EmbedResult Runner::embed(const std::string& text) {
@@ -489,6 +693,7 @@ EmbedResult Runner::embed(const std::string& text) {
         }
 
         // Create context with embedding mode enabled
+        auto setupStart = std::chrono::steady_clock::now();
         llama_context_params ctx_params = llama_context_default_params();
         ctx_params.n_ctx = n_tokens + 1;
         ctx_params.n_batch = n_tokens;
@@ -500,10 +705,11 @@ EmbedResult Runner::embed(const std::string& text) {
             ctx_params.op_offload = false;
         }
 
-        LlamaContextPtr ctx(llama_init_from_model(shared_model_.get(), ctx_params));
+        auto ctx = acquireContext(ctx_params);
         if (!ctx) {
             return {false, {}, "Failed to create embedding context"};
         }
+        const double setupTime = secondsSince(setupStart);
 
         // Create batch and decode
         llama_batch batch = llama_batch_get_one(tokens.data(), tokens.size());
@@ -524,19 +730,12 @@ EmbedResult Runner::embed(const std::string& text) {
 
         int n_embd = llama_model_n_embd_out(shared_model_.get());
         std::vector<float> embedding(emb, emb + n_embd);
-
-        // Apply the same L2 normalization as common_embd_normalize(, , , 2).
-        // Non-zero stored vectors have unit length. Zero vectors remain zero.
-        // This supports direct dot-product comparison without reader-side normalization.
-        double norm = 0.0;
-        for (float v : embedding) { norm += v * v; }
-        norm = std::sqrt(norm);
-        if (norm > 0.0) {
-            for (float& v : embedding) { v /= norm; }
-        }
+        normalizeEmbedding(embedding);
 
         LOG_INFO("Generated embedding with " + std::to_string(n_embd) + " dimensions (L2 normalized)");
-        return {true, std::move(embedding), ""};
+        EmbedResult result{true, std::move(embedding), ""};
+        result.metrics["setup_s"] = setupTime;
+        return result;
 
     } catch (const std::exception& e) {
         LOG_ERROR("Embedding error: " + std::string(e.what()));
@@ -544,12 +743,135 @@ EmbedResult Runner::embed(const std::string& text) {
     }
 }
 
+std::vector<EmbedResult> Runner::embedBatch(const std::vector<std::string>& texts) {
+    std::vector<EmbedResult> results(texts.size());
+    if (!shared_model_) {
+        for (auto& result : results) result = {false, {}, "Model not loaded"};
+        return results;
+    }
+
+    try {
+        const llama_vocab* vocab = llama_model_get_vocab(shared_model_.get());
+        const int max_ctx = std::min(llama_model_n_ctx_train(shared_model_.get()), env_positive_int("NRVNA_MAX_CTX", 8192));
+
+        std::vector<std::vector<llama_token>> tokens(texts.size());
+        std::vector<size_t> batchable;
+        for (size_t i = 0; i < texts.size(); ++i) {
+            const std::string& text = texts[i];
+            const int n_tokens = -llama_tokenize(vocab, text.c_str(), text.size(), nullptr, 0, true, true);
+            if (n_tokens <= 0) {
+                results[i] = {false, {}, "Failed to tokenize input"};
+                continue;
+            }
+            tokens[i].resize(n_tokens);
+            if (llama_tokenize(vocab, text.c_str(), text.size(), tokens[i].data(), tokens[i].size(), true, true) < 0) {
+                results[i] = {false, {}, "Failed to tokenize input"};
+                continue;
+            }
+            if (n_tokens + 1 > max_ctx) {
+                results[i] = {false, {}, "Embedding input too large for context budget: input_tokens=" +
+                    std::to_string(n_tokens) + " max_ctx=" + std::to_string(max_ctx)};
+                continue;
+            }
+            batchable.push_back(i);
+        }
+
+        // Pack inputs into groups that fit one context, one sequence per input.
+        constexpr size_t kMaxSequences = 64;
+        const int n_embd = llama_model_n_embd_out(shared_model_.get());
+        for (size_t first = 0; first < batchable.size(); ) {
+            size_t last = first;
+            size_t total = 0;
+            while (last < batchable.size() && last - first < kMaxSequences &&
+                   total + tokens[batchable[last]].size() + 1 <= static_cast<size_t>(max_ctx)) {
+                total += tokens[batchable[last]].size();
+                ++last;
+            }
+            const size_t n_seq = last - first;
+
+            auto setupStart = std::chrono::steady_clock::now();
+            llama_context_params ctx_params = llama_context_default_params();
+            ctx_params.n_ctx = static_cast<uint32_t>(total + 1);
+            ctx_params.n_batch = static_cast<uint32_t>(total);
+            ctx_params.n_ubatch = static_cast<uint32_t>(total);  // encoder requires n_ubatch >= n_tokens
+            // Always the maximum, so batches of any size share one pooled context.
+            ctx_params.n_seq_max = static_cast<uint32_t>(kMaxSequences);
+            ctx_params.kv_unified = true;  // sequences share the cells instead of n_ctx / n_seq_max each
+            ctx_params.embeddings = true;
+            ctx_params.pooling_type = LLAMA_POOLING_TYPE_UNSPECIFIED;  // Honor the model's declared pooling strategy.
+            if (effective_gpu_layers() <= 0) {
+                ctx_params.offload_kqv = false;
+                ctx_params.op_offload = false;
+            }
+            auto ctx = acquireContext(ctx_params);
+            const double setupTime = secondsSince(setupStart);
+
+            std::string groupError;
+            if (!ctx) {
+                groupError = "Failed to create embedding context";
+            } else {
+                LlamaBatchOwner batchOwner(static_cast<int>(total));
+                llama_batch& batch = batchOwner.value;
+                batch.n_tokens = 0;
+                for (size_t s = 0; s < n_seq; ++s) {
+                    const auto& seqTokens = tokens[batchable[first + s]];
+                    for (size_t j = 0; j < seqTokens.size(); ++j) {
+                        const int k = batch.n_tokens++;
+                        batch.token[k] = seqTokens[j];
+                        batch.pos[k] = static_cast<llama_pos>(j);
+                        batch.n_seq_id[k] = 1;
+                        batch.seq_id[k][0] = static_cast<llama_seq_id>(s);
+                        batch.logits[k] = true;
+                    }
+                }
+                if (llama_decode(ctx.get(), batch) != 0) {
+                    groupError = "Failed to decode for embeddings";
+                }
+            }
+
+            const bool pooled = ctx && llama_pooling_type(ctx.get()) != LLAMA_POOLING_TYPE_NONE;
+            int32_t offset = 0;
+            for (size_t s = 0; s < n_seq; ++s) {
+                const size_t index = batchable[first + s];
+                const auto n_tokens = static_cast<int32_t>(tokens[index].size());
+                offset += n_tokens;
+                if (!groupError.empty()) {
+                    results[index] = {false, {}, groupError};
+                    continue;
+                }
+                // Without pooling, fall back to the sequence's last token like embed().
+                float* emb = pooled ? llama_get_embeddings_seq(ctx.get(), static_cast<llama_seq_id>(s))
+                                    : llama_get_embeddings_ith(ctx.get(), offset - 1);
+                if (!emb) {
+                    results[index] = {false, {}, "Failed to get embeddings"};
+                    continue;
+                }
+                std::vector<float> embedding(emb, emb + n_embd);
+                normalizeEmbedding(embedding);
+                results[index] = {true, std::move(embedding), ""};
+                results[index].metrics["setup_s"] = setupTime;
+                results[index].metrics["batch_size"] = static_cast<double>(n_seq);
+            }
+            LOG_DEBUG("Embedded " + std::to_string(n_seq) + " input(s), " + std::to_string(total) + " tokens");
+            first = last;
+        }
+        return results;
+
+    } catch (const std::exception& e) {
+        LOG_ERROR("Embedding error: " + std::string(e.what()));
+        for (auto& result : results) {
+            if (!result.ok && result.error.empty()) result = {false, {}, "Embedding error: " + std::string(e.what())};
+        }
+        return results;
+    }
+}
+
 EmbedResult Runner::embedVision(const std::string& prompt, const std::vector<std::filesystem::path>& imagePaths) {
     if (!shared_model_) {
         return {false, {}, "Model not loaded"};
     }
 
-    if (!mtmd_ctx_) {
+    if (!media_) {
         return {false, {}, "Vision embedding requires --mmproj flag"};
     }
 
@@ -557,41 +879,18 @@ EmbedResult Runner::embedVision(const std::string& prompt, const std::vector<std
         return {false, {}, "No images provided for vision embedding"};
     }
 
-    mtmd_input_chunks* chunks = nullptr;
-    std::vector<mtmd_bitmap*> bitmaps;
-    llama_context* ctx = nullptr;
     try {
         const char* marker = mtmd_default_marker();
         std::string formatted_prompt = formatMultimodalPrompt(prompt, imagePaths.size(), marker);
 
-        bitmaps = loadImages(imagePaths);
-        if (bitmaps.empty()) {
-            return {false, {}, "Failed to load image(s)"};
-        }
-
-        mtmd_input_text text{formatted_prompt.c_str(), formatted_prompt.size(), true, true};
-
-        chunks = mtmd_input_chunks_init();
+        std::string error;
+        MediaChunks chunks = media_->tokenize(formatted_prompt, imagePaths, false, error);
         if (!chunks) {
-            freeBitmaps(bitmaps);
-            return {false, {}, "Failed to init image chunks"};
+            return {false, {}, error};
         }
 
-        std::vector<const mtmd_bitmap*> bitmap_ptrs;
-        bitmap_ptrs.reserve(bitmaps.size());
-        for (auto* bmp : bitmaps) {
-            bitmap_ptrs.push_back(bmp);
-        }
-
-        int32_t res = mtmd_tokenize(mtmd_ctx_, chunks, &text, bitmap_ptrs.data(), bitmap_ptrs.size());
-        if (res != 0) {
-            mtmd_input_chunks_free(chunks);
-            chunks = nullptr;
-            freeBitmaps(bitmaps);
-            return {false, {}, "Failed to tokenize multimodal prompt"};
-        }
-
-        const int n_prompt = static_cast<int>(mtmd_helper_get_n_tokens(chunks));
+        const int n_prompt = static_cast<int>(mtmd_helper_get_n_tokens(chunks.get()));
+        auto setupStart = std::chrono::steady_clock::now();
         llama_context_params ctx_params = llama_context_default_params();
         ctx_params.n_ctx = std::max(n_prompt + 8, 128);
         ctx_params.n_batch = std::max(1, std::min(n_prompt, env_int("NRVNA_BATCH", 2048)));
@@ -603,36 +902,23 @@ EmbedResult Runner::embedVision(const std::string& prompt, const std::vector<std
             ctx_params.op_offload = false;
         }
 
-        ctx = llama_init_from_model(shared_model_.get(), ctx_params);
+        auto ctx = acquireContext(ctx_params);
         if (!ctx) {
-            mtmd_input_chunks_free(chunks);
-            chunks = nullptr;
-            freeBitmaps(bitmaps);
             return {false, {}, "Failed to create embedding context"};
         }
+        const double setupTime = secondsSince(setupStart);
 
         llama_pos n_past = 0;
-        {
-            std::lock_guard<std::mutex> vision_lock(vision_encoding_mutex_);
-            if (mtmd_helper_eval_chunks(mtmd_ctx_, ctx, chunks, 0, 0, ctx_params.n_batch, true, &n_past) != 0) {
-                llama_free(ctx);
-                mtmd_input_chunks_free(chunks);
-                chunks = nullptr;
-                freeBitmaps(bitmaps);
-                return {false, {}, "Failed to eval multimodal prompt"};
-            }
+        if (!media_->eval(ctx.get(), chunks.get(), 0, n_past)) {
+            return {false, {}, "Failed to eval multimodal prompt"};
         }
+        chunks.reset();
 
-        mtmd_input_chunks_free(chunks);
-        chunks = nullptr;
-        freeBitmaps(bitmaps);
-
-        float* emb = llama_get_embeddings_seq(ctx, 0);
+        float* emb = llama_get_embeddings_seq(ctx.get(), 0);
         if (!emb) {
-            emb = llama_get_embeddings_ith(ctx, -1);
+            emb = llama_get_embeddings_ith(ctx.get(), -1);
         }
         if (!emb) {
-            llama_free(ctx);
             return {false, {}, "Failed to get multimodal embeddings"};
         }
 
@@ -641,33 +927,19 @@ EmbedResult Runner::embedVision(const std::string& prompt, const std::vector<std
             n_embd = llama_model_n_embd(shared_model_.get());
         }
         if (n_embd <= 0) {
-            llama_free(ctx);
             return {false, {}, "Invalid embedding dimension"};
         }
 
         std::vector<float> embedding(emb, emb + n_embd);
-        llama_free(ctx);
-
-        // Match embed() and upstream common_embd_normalize(, , , 2).
-        double norm = 0.0;
-        for (float v : embedding) { norm += v * v; }
-        norm = std::sqrt(norm);
-        if (norm > 0.0) {
-            for (float& v : embedding) { v /= norm; }
-        }
+        normalizeEmbedding(embedding);
 
         LOG_INFO("Generated multimodal embedding with " + std::to_string(n_embd) +
                  " dimensions from " + std::to_string(imagePaths.size()) + " image(s)");
-        return {true, std::move(embedding), ""};
+        EmbedResult result{true, std::move(embedding), ""};
+        result.metrics["setup_s"] = setupTime;
+        return result;
 
     } catch (const std::exception& e) {
-        if (ctx) {
-            llama_free(ctx);
-        }
-        if (chunks) {
-            mtmd_input_chunks_free(chunks);
-        }
-        freeBitmaps(bitmaps);
         LOG_ERROR("Vision embedding error: " + std::string(e.what()));
         return {false, {}, "Vision embedding error: " + std::string(e.what())};
     }
@@ -688,7 +960,7 @@ RunResult Runner::runText(const std::string& prompt, const GenerationOptions& op
 
     try {
         SamplingConfig config = buildSamplingConfig();
-        std::string formatted_prompt = formatPrompt(prompt);
+        std::string formatted_prompt = formatPrompt(prompt, options.history);
         const llama_vocab* vocab = llama_model_get_vocab(shared_model_.get());
         const int n_prompt = -llama_tokenize(vocab, formatted_prompt.c_str(), formatted_prompt.size(), NULL, 0, true, true);
         if (n_prompt <= 0) {
@@ -712,23 +984,47 @@ RunResult Runner::runText(const std::string& prompt, const GenerationOptions& op
             return {false, "", "Failed to tokenize the prompt"};
         }
 
+        auto setupStart = std::chrono::steady_clock::now();
+        const bool continuation = !options.resumeState.empty() || !options.saveState.empty();
+        if (batch_engine_ && !continuation) {
+            // The engine owns the sampler and decodes this job alongside every
+            // other live sequence.
+            llama_sampler* engineSampler = buildSampler(config, vocab, options.grammar);
+            const auto bounds = prefixBoundaries(prompt_tokens, prompt_tokens.size() - 1);
+            auto prefix = bounds.empty() ? nullptr : prefix_cache_->lookup(prompt_tokens, bounds);
+            const size_t snapshotAt = chooseSnapshot(prompt_tokens, bounds, prefix ? prefix->tokens.size() : 0);
+            const double setupTime = secondsSince(setupStart);
+            RunResult result = batch_engine_->generate(std::move(prompt_tokens), engineSampler, config.n_predict,
+                                                       std::move(prefix), snapshotAt, options.onText,
+                                                       options.control);
+            if (!result.ok) {
+                return result;
+            }
+            LOG_INFO("Generated " + std::to_string(result.output.size()) + " bytes (batched)");
+            result.output = stripThinkBlocks(result.output);
+            result.metrics["setup_s"] = setupTime;
+            return result;
+        }
+
         llama_context_params ctx_params;
         buildContextParams(n_prompt, config, ctx_params);
-        LlamaContextPtr ctx(llama_init_from_model(shared_model_.get(), ctx_params));
+        auto ctx = acquireContext(ctx_params);
         if (!ctx) {
             return {false, "", "Failed to create context"};
         }
 
-        LOG_DEBUG("Context: " + std::to_string(ctx_params.n_ctx) + " tokens");
+        LOG_DEBUG("Context: " + std::to_string(llama_n_ctx(ctx.get())) + " tokens");
 
-        LlamaSamplerPtr smpl(buildSampler(config, vocab, options.grammar));
+        auto smpl = acquireSampler(config, vocab, options.grammar);
+        const double setupTime = secondsSince(setupStart);
+        AbortScope abortScope(ctx.get(), options.control);
 
         llama_token decoder_start_token_id = 0;
         if (llama_model_has_encoder(shared_model_.get())) {
             llama_batch enc_batch = llama_batch_get_one(prompt_tokens.data(), prompt_tokens.size());
             if (llama_encode(ctx.get(), enc_batch)) {
                 LOG_ERROR("Failed to encode");
-                return {false, "", "Failed to encode"};
+                return {false, "", stopError(options.control, "Failed to encode")};
             }
 
             decoder_start_token_id = llama_model_decoder_start_token(shared_model_.get());
@@ -738,56 +1034,65 @@ RunResult Runner::runText(const std::string& prompt, const GenerationOptions& op
         }
 
         // Decode prompt in n_batch-sized chunks (reference: simple.cpp)
-        int n_batch = ctx_params.n_batch;
+        const int n_batch = static_cast<int>(llama_n_batch(ctx.get()));
+        size_t reused = 0;
 
         if (decoder_start_token_id != 0) {
             // Encoder model: decode the start token
             llama_batch start_batch = llama_batch_get_one(&decoder_start_token_id, 1);
             if (llama_decode(ctx.get(), start_batch)) {
                 LOG_ERROR("Failed to decode start token");
-                return {false, "", "Failed to decode start token"};
+                return {false, "", stopError(options.control, "Failed to decode start token")};
             }
         } else {
-            // Standard model: decode prompt in chunks
-            for (int i = 0; i < n_prompt; i += n_batch) {
-                int n_eval = std::min(n_batch, n_prompt - i);
-                llama_batch batch = llama_batch_get_one(prompt_tokens.data() + i, n_eval);
+            // Standard model: restore a cached prefix, then decode the rest in chunks.
+            // A chunk ends early at the snapshot point so the prefix state can be saved.
+            const auto bounds = prefixBoundaries(prompt_tokens, prompt_tokens.size() - 1);
+            reused = restorePrefix(ctx.get(), prompt_tokens, bounds);
+            if (!options.resumeState.empty()) {
+                reused = resumeConversation(ctx.get(), prompt_tokens, options.resumeState, reused);
+            }
+            const size_t snapshotAt = chooseSnapshot(prompt_tokens, bounds, reused);
+            for (size_t i = reused; i < prompt_tokens.size(); ) {
+                size_t end = std::min(i + static_cast<size_t>(n_batch), prompt_tokens.size());
+                if (snapshotAt > i && snapshotAt < end) {
+                    end = snapshotAt;
+                }
+                llama_batch batch = llama_batch_get_one(prompt_tokens.data() + i, static_cast<int32_t>(end - i));
                 if (llama_decode(ctx.get(), batch)) {
                     LOG_ERROR("Failed to decode prompt chunk");
-                    return {false, "", "Failed to decode prompt"};
+                    return {false, "", stopError(options.control, "Failed to decode prompt")};
+                }
+                i = end;
+                if (i == snapshotAt) {
+                    savePrefix(ctx.get(), prompt_tokens, snapshotAt);
                 }
             }
         }
 
         std::string output;
-        llama_token new_token_id;
-
-        int generated = 0;
-        for (; generated < config.n_predict; ) {
-            new_token_id = llama_sampler_sample(smpl.get(), ctx.get(), -1);
-
-            if (llama_vocab_is_eog(vocab, new_token_id)) {
-                break;
-            }
-
-            auto piece = tokenPiece(vocab, new_token_id);
-            if (!piece) {
-                LOG_ERROR("Failed to convert token to piece");
-                return {false, "", "Failed to convert generated token to text"};
-            }
-            output += *piece;
-
-            llama_batch gen_batch = llama_batch_get_one(&new_token_id, 1);
-            if (llama_decode(ctx.get(), gen_batch)) {
-                LOG_ERROR("Failed to decode generated token");
-                return {false, "", "Failed to decode generated token"};
-            }
-            generated += 1;
+        std::string generationError;
+        DecodeStats stats;
+        Drafter* drafter = decoder_start_token_id == 0 ? acquireDrafter(options, config.max_ctx) : nullptr;
+        const llama_pos n_past = decoder_start_token_id != 0 ? 1 : static_cast<llama_pos>(prompt_tokens.size());
+        if (!generateTokens(ctx.get(), smpl.get(), n_past, config.n_predict, drafter, options.onText,
+                            options.control, prompt_tokens, output, generationError, stats)) {
+            LOG_ERROR(generationError);
+            return {false, output, generationError};
+        }
+        if (!options.saveState.empty() && decoder_start_token_id == 0) {
+            saveConversation(ctx.get(), std::move(prompt_tokens), static_cast<size_t>(stats.n_past),
+                             options.saveState);
         }
 
         LOG_INFO("Generated " + std::to_string(output.size()) + " bytes");
-        output = stripThinkBlocks(output);
-        return {true, output, ""};
+        RunResult result{true, stripThinkBlocks(output), ""};
+        result.metrics["setup_s"] = setupTime;
+        if (reused > 0) {
+            result.metrics["prefix_reused_tokens"] = static_cast<double>(reused);
+        }
+        recordDecodeMetrics(result.metrics, stats.generated, stats.drafted, stats.accepted, stats.seconds);
+        return result;
 
     } catch (const std::exception& e) {
         LOG_ERROR("Inference error: " + std::string(e.what()));
@@ -801,47 +1106,27 @@ RunResult Runner::runVision(const std::string& prompt, const std::vector<std::fi
         return {false, "", "Model not loaded"};
     }
 
-    if (!mtmd_ctx_) {
+    if (!media_) {
         return {false, "", "Vision job requires --mmproj flag"};
     }
 
     try {
-        SamplingConfig config = buildSamplingConfig();
-
-        // Lower temperature for vision tasks (more accurate OCR/descriptions)
-        config.temp = env_float("NRVNA_VISION_TEMP", 0.3f);
+        SamplingConfig config = buildSamplingConfig(JobType::Vision);
 
         LOG_INFO("Vision job: " + std::to_string(imagePaths.size()) + " image(s), temp=" + std::to_string(config.temp));
 
         const char* marker = mtmd_default_marker();
-        std::string formatted_prompt = formatMultimodalPrompt(prompt, imagePaths.size(), marker);
+        std::string formatted_prompt = formatMultimodalPrompt(prompt, imagePaths.size(), marker, true);
 
         auto loadStart = std::chrono::steady_clock::now();
-        BitmapList bitmaps{loadImages(imagePaths)};
-        if (bitmaps.values.empty()) {
-            return {false, "", "Failed to load image(s)"};
+        std::string error;
+        MediaChunks chunks = media_->tokenize(formatted_prompt, imagePaths, false, error);
+        if (!chunks) {
+            return {false, "", error};
         }
         auto loadTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
         LOG_DEBUG("Image load time: " + std::to_string(loadTime) + "s");
 
-        mtmd_input_text text{formatted_prompt.c_str(), formatted_prompt.size(), true, true};
-
-        MtmdChunksPtr chunks(mtmd_input_chunks_init());
-        if (!chunks) {
-            return {false, "", "Failed to init image chunks"};
-        }
-
-        std::vector<const mtmd_bitmap*> bitmap_ptrs;
-        bitmap_ptrs.reserve(bitmaps.values.size());
-        for (auto* bmp : bitmaps.values) {
-            bitmap_ptrs.push_back(bmp);
-        }
-
-        int32_t res = mtmd_tokenize(mtmd_ctx_, chunks.get(), &text, bitmap_ptrs.data(), bitmap_ptrs.size());
-        if (res != 0) {
-            return {false, "", "Failed to tokenize multimodal prompt"};
-        }
-
         size_t n_prompt = mtmd_helper_get_n_tokens(chunks.get());
         constexpr int kContextOverhead = 64;
         int max_predict = config.max_ctx - static_cast<int>(n_prompt) - kContextOverhead;
@@ -854,92 +1139,65 @@ RunResult Runner::runVision(const std::string& prompt, const std::vector<std::fi
         if (config.n_predict > max_predict) {
             config.n_predict = max_predict;
         }
+        auto setupStart = std::chrono::steady_clock::now();
         llama_context_params ctx_params;
         buildContextParams(static_cast<int>(n_prompt), config, ctx_params);
-        LlamaContextPtr ctx(llama_init_from_model(shared_model_.get(), ctx_params));
+        auto ctx = acquireContext(ctx_params);
         if (!ctx) {
             return {false, "", "Failed to create context"};
         }
 
         const llama_vocab* vocab = llama_model_get_vocab(shared_model_.get());
-        LlamaSamplerPtr smpl(buildSampler(config, vocab, options.grammar));
+        auto smpl = acquireSampler(config, vocab, options.grammar);
+        const double setupTime = secondsSince(setupStart);
+        AbortScope abortScope(ctx.get(), options.control);
         llama_pos n_past = 0;
+        size_t reused = 0;
+        std::vector<llama_token> history = chunkTextTokens(chunks.get());
 
-        // CRITICAL: Serialize vision encoding across all workers
-        // The GGML compute graph has shared state that corrupts when multiple
-        // vision encodings run simultaneously, even with separate mtmd contexts
+        // Images are encoded on the shared encoder thread and decoded here.
         auto encodeStart = std::chrono::steady_clock::now();
-        {
-            std::lock_guard<std::mutex> vision_lock(vision_encoding_mutex_);
-            if (mtmd_helper_eval_chunks(mtmd_ctx_, ctx.get(), chunks.get(), 0, 0, ctx_params.n_batch, true, &n_past) != 0) {
-                return {false, "", "Failed to eval multimodal prompt"};
-            }
+        if (!evalMediaChunks(ctx.get(), chunks.get(), n_past, reused)) {
+            return {false, "", stopError(options.control, "Failed to eval multimodal prompt")};
         }
-
         chunks.reset();
-        bitmaps.clear();
 
         auto encodeTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - encodeStart).count();
         LOG_INFO("Vision encoding: " + std::to_string(encodeTime) + "s for " + std::to_string(n_past) + " tokens");
 
-        // Token generation loop with explicit position tracking (matches reference)
         std::string output;
-        llama_token new_token_id;
-        LlamaBatchOwner batchOwner(1);
-        llama_batch& batch = batchOwner.value;
         std::string generationError;
-
-        for (int i = 0; i < config.n_predict; ++i) {
-            new_token_id = llama_sampler_sample(smpl.get(), ctx.get(), -1);
-
-            if (llama_vocab_is_eog(vocab, new_token_id)) {
-                break;
-            }
-
-            auto piece = tokenPiece(vocab, new_token_id);
-            if (!piece) {
-                generationError = "Failed to convert generated vision token to text";
-                break;
-            }
-            output += *piece;
-
-            // Decode next token with explicit position (like reference)
-            batch.n_tokens = 1;
-            batch.token[0] = new_token_id;
-            batch.pos[0] = n_past++;
-            batch.n_seq_id[0] = 1;
-            batch.seq_id[0][0] = 0;
-            batch.logits[0] = true;
-
-            if (llama_decode(ctx.get(), batch)) {
-                generationError = "Failed to decode generated vision token";
-                break;
-            }
-        }
-
-        if (!generationError.empty()) {
-            return {false, "", generationError};
+        DecodeStats stats;
+        if (!generateTokens(ctx.get(), smpl.get(), n_past, config.n_predict, acquireDrafter(options, config.max_ctx),
+                            options.onText, options.control, history, output, generationError, stats)) {
+            return {false, output, generationError};
         }
 
         LOG_INFO("Generated " + std::to_string(output.size()) + " bytes before strip");
-        output = stripThinkBlocks(output);
-        return {true, output, ""};
+        RunResult result{true, stripThinkBlocks(output), ""};
+        result.metrics["setup_s"] = setupTime;
+        if (reused > 0) {
+            result.metrics["prefix_reused_tokens"] = static_cast<double>(reused);
+        }
+        recordDecodeMetrics(result.metrics, stats.generated, stats.drafted, stats.accepted, stats.seconds);
+        return result;
 
     } catch (const std::exception& e) {
         return {false, "", "Multimodal inference error: " + std::string(e.what())};
     }
 }
 
-RunResult Runner::runStt(const std::string& prompt, const std::vector<std::filesystem::path>& audioPaths) {
+RunResult Runner::runStt(const std::string& prompt, const std::vector<std::filesystem::path>& audioPaths,
+                         JobControl* control) {
     if (!shared_model_) {
         return {false, "", "Model not loaded"};
     }
 
-    if (!mtmd_ctx_) {
+    if (!media_) {
         return {false, "", "STT job requires --mmproj flag"};
     }
 
-    if (!mtmd_support_audio(mtmd_ctx_)) {
+    if (!media_->supportsAudio()) {
         return {false, "", "Current mmproj does not support audio input"};
     }
 
@@ -948,9 +1206,7 @@ RunResult Runner::runStt(const std::string& prompt, const std::vector<std::files
     }
 
     try {
-        SamplingConfig config = buildSamplingConfig();
-        config.temp = env_float("NRVNA_STT_TEMP", config.temp);
-        config.n_predict = env_int("NRVNA_STT_PREDICT", config.n_predict);
+        SamplingConfig config = buildSamplingConfig(JobType::Stt);
 
         LOG_INFO("STT job: " + std::to_string(audioPaths.size()) + " audio file(s), temp=" + std::to_string(config.temp));
 
@@ -958,27 +1214,10 @@ RunResult Runner::runStt(const std::string& prompt, const std::vector<std::files
         const std::string task = prompt.empty() ? "Transcribe the audio." : prompt;
         std::string formatted_prompt = formatMultimodalPrompt(task, audioPaths.size(), marker);
 
-        BitmapList audioBitmaps{loadAudio(audioPaths)};
-        if (audioBitmaps.values.empty()) {
-            return {false, "", "Failed to load audio file(s)"};
-        }
-
-        mtmd_input_text text{formatted_prompt.c_str(), formatted_prompt.size(), true, true};
-
-        MtmdChunksPtr chunks(mtmd_input_chunks_init());
+        std::string error;
+        MediaChunks chunks = media_->tokenize(formatted_prompt, audioPaths, true, error);
         if (!chunks) {
-            return {false, "", "Failed to init audio chunks"};
-        }
-
-        std::vector<const mtmd_bitmap*> bitmap_ptrs;
-        bitmap_ptrs.reserve(audioBitmaps.values.size());
-        for (auto* bmp : audioBitmaps.values) {
-            bitmap_ptrs.push_back(bmp);
-        }
-
-        int32_t res = mtmd_tokenize(mtmd_ctx_, chunks.get(), &text, bitmap_ptrs.data(), bitmap_ptrs.size());
-        if (res != 0) {
-            return {false, "", "Failed to tokenize audio prompt"};
+            return {false, "", error};
         }
 
         size_t n_prompt = mtmd_helper_get_n_tokens(chunks.get());
@@ -994,60 +1233,32 @@ RunResult Runner::runStt(const std::string& prompt, const std::vector<std::files
             config.n_predict = max_predict;
         }
 
+        auto setupStart = std::chrono::steady_clock::now();
         llama_context_params ctx_params;
         buildContextParams(static_cast<int>(n_prompt), config, ctx_params);
-        LlamaContextPtr ctx(llama_init_from_model(shared_model_.get(), ctx_params));
+        auto ctx = acquireContext(ctx_params);
         if (!ctx) {
             return {false, "", "Failed to create STT context"};
         }
 
         const llama_vocab* vocab = llama_model_get_vocab(shared_model_.get());
-        LlamaSamplerPtr smpl(buildSampler(config, vocab, ""));
+        auto smpl = acquireSampler(config, vocab, "");
+        const double setupTime = secondsSince(setupStart);
+        AbortScope abortScope(ctx.get(), control);
         llama_pos n_past = 0;
-        {
-            std::lock_guard<std::mutex> media_lock(vision_encoding_mutex_);
-            if (mtmd_helper_eval_chunks(mtmd_ctx_, ctx.get(), chunks.get(), 0, 0, ctx_params.n_batch, true, &n_past) != 0) {
-                return {false, "", "Failed to eval audio prompt"};
-            }
+        size_t reused = 0;
+        if (!evalMediaChunks(ctx.get(), chunks.get(), n_past, reused)) {
+            return {false, "", stopError(control, "Failed to eval audio prompt")};
         }
-
         chunks.reset();
-        audioBitmaps.clear();
 
         std::string output;
-        LlamaBatchOwner batchOwner(1);
-        llama_batch& batch = batchOwner.value;
         std::string generationError;
-
-        for (int i = 0; i < config.n_predict; ++i) {
-            llama_token new_token_id = llama_sampler_sample(smpl.get(), ctx.get(), -1);
-
-            if (llama_vocab_is_eog(vocab, new_token_id)) {
-                break;
-            }
-
-            auto piece = tokenPiece(vocab, new_token_id);
-            if (!piece) {
-                generationError = "Failed to convert generated STT token to text";
-                break;
-            }
-            output += *piece;
-
-            batch.n_tokens = 1;
-            batch.token[0] = new_token_id;
-            batch.pos[0] = n_past++;
-            batch.n_seq_id[0] = 1;
-            batch.seq_id[0][0] = 0;
-            batch.logits[0] = true;
-
-            if (llama_decode(ctx.get(), batch)) {
-                generationError = "Failed to decode generated STT token";
-                break;
-            }
-        }
-
-        if (!generationError.empty()) {
-            return {false, "", generationError};
+        DecodeStats stats;
+        std::vector<llama_token> history;
+        if (!generateTokens(ctx.get(), smpl.get(), n_past, config.n_predict, nullptr, nullptr, control,
+                            history, output, generationError, stats)) {
+            return {false, extractAsrText(output), generationError};
         }
 
         output = extractAsrText(output);
@@ -1055,16 +1266,26 @@ RunResult Runner::runStt(const std::string& prompt, const std::vector<std::files
         if (output.empty()) {
             return {false, "", "Model produced no transcript content"};
         }
-        return {true, output, ""};
+        RunResult result{true, output, ""};
+        result.metrics["setup_s"] = setupTime;
+        if (reused > 0) {
+            result.metrics["prefix_reused_tokens"] = static_cast<double>(reused);
+        }
+        recordDecodeMetrics(result.metrics, stats.generated, stats.drafted, stats.accepted, stats.seconds);
+        return result;
 
     } catch (const std::exception& e) {
         return {false, "", "STT inference error: " + std::string(e.what())};
     }
 }
 
-std::string Runner::formatPrompt(const std::string& content) {
+std::string Runner::formatPrompt(const std::string& content, const std::vector<ChatTurn>& history) {
     if (!chat_templates_) {
-        return content;
+        std::string text;
+        for (const auto& turn : history) {
+            text += turn.user + turn.assistant;
+        }
+        return text + content;
     }
 
     common_chat_msg msg;
@@ -1072,7 +1293,23 @@ std::string Runner::formatPrompt(const std::string& content) {
     msg.content = content;
 
     common_chat_templates_inputs inputs;
-    inputs.messages = {msg};
+    if (!system_prompt_.empty()) {
+        common_chat_msg system;
+        system.role = "system";
+        system.content = system_prompt_;
+        inputs.messages.push_back(system);
+    }
+    for (const auto& turn : history) {
+        common_chat_msg user;
+        user.role = "user";
+        user.content = turn.user;
+        inputs.messages.push_back(user);
+        common_chat_msg assistant;
+        assistant.role = "assistant";
+        assistant.content = turn.assistant;
+        inputs.messages.push_back(assistant);
+    }
+    inputs.messages.push_back(msg);
     inputs.use_jinja = true;
     inputs.add_generation_prompt = true;
     inputs.enable_thinking = true;
@@ -1086,7 +1323,8 @@ std::string Runner::formatPrompt(const std::string& content) {
     return params.prompt;
 }
 
-std::string Runner::formatMultimodalPrompt(const std::string& prompt, size_t imageCount, const char* marker) {
+std::string Runner::formatMultimodalPrompt(const std::string& prompt, size_t imageCount, const char* marker,
+                                           bool withSystemPrompt) {
     std::string content = prompt;
     if (prompt.find(marker) == std::string::npos) {
         std::string prefix;
@@ -1105,7 +1343,13 @@ std::string Runner::formatMultimodalPrompt(const std::string& prompt, size_t ima
     msg.content = content;
 
     common_chat_templates_inputs inputs;
-    inputs.messages = {msg};
+    if (withSystemPrompt && !system_prompt_.empty()) {
+        common_chat_msg system;
+        system.role = "system";
+        system.content = system_prompt_;
+        inputs.messages.push_back(system);
+    }
+    inputs.messages.push_back(msg);
     inputs.use_jinja = true;
     inputs.add_generation_prompt = true;
     inputs.enable_thinking = true;
@@ -1119,42 +1363,385 @@ std::string Runner::formatMultimodalPrompt(const std::string& prompt, size_t ima
     return params.prompt;
 }
 
-std::vector<mtmd_bitmap*> Runner::loadImages(const std::vector<std::filesystem::path>& imagePaths) const {
-    std::vector<mtmd_bitmap*> bitmaps;
-    bitmaps.reserve(imagePaths.size());
-    for (const auto& path : imagePaths) {
-        auto res = mtmd_helper_bitmap_init_from_file(mtmd_ctx_, path.c_str(), false);
-        if (!res.bitmap) {
-            freeBitmaps(bitmaps);
-            return {};
+std::string Runner::defaultSpeculation() {
+    const char* mode = std::getenv("NRVNA_SPECULATE");
+    if (mode && *mode) {
+        return mode;
+    }
+    return draft_model_ ? "draft" : "off";
+}
+
+Drafter* Runner::acquireDrafter(const GenerationOptions& options, int max_ctx) {
+    const std::string mode = options.speculate.empty() ? defaultSpeculation() : options.speculate;
+    if (mode == "off" || env_int("NRVNA_DRAFT_MAX", 8) <= 0) {
+        return nullptr;
+    }
+    if (mode == "ngram") {
+        if (!ngram_drafter_) {
+            ngram_drafter_ = std::make_unique<NgramDrafter>(env_positive_int("NRVNA_NGRAM_MIN", 2),
+                                                            env_positive_int("NRVNA_NGRAM_MAX", 4));
         }
-        bitmaps.push_back(res.bitmap);
+        return ngram_drafter_.get();
     }
-    return bitmaps;
+    if (mode != "draft" || !draft_model_) {
+        return nullptr;
+    }
+    if (!model_drafter_ || draft_ctx_n_ < max_ctx) {
+        llama_context_params params = llama_context_default_params();
+        params.n_ctx = static_cast<uint32_t>(max_ctx);
+        params.n_batch = static_cast<uint32_t>(std::min(max_ctx, env_positive_int("NRVNA_BATCH", 2048)));
+        params.n_ubatch = std::min(params.n_batch,
+                                   static_cast<uint32_t>(env_positive_int("NRVNA_UBATCH", static_cast<int>(params.n_batch))));
+        if (effective_gpu_layers() <= 0) {
+            params.offload_kqv = false;
+            params.op_offload = false;
+        }
+        llama_context* ctx = llama_init_from_model(draft_model_.get(), params);
+        if (!ctx) {
+            LOG_WARN("Failed to create draft context; decoding without speculation");
+            return nullptr;
+        }
+        model_drafter_ = std::make_unique<ModelDrafter>(std::shared_ptr<llama_context>(ctx, llama_free));
+        draft_ctx_n_ = max_ctx;
+    }
+    return model_drafter_.get();
 }
 
-std::vector<mtmd_bitmap*> Runner::loadAudio(const std::vector<std::filesystem::path>& audioPaths) const {
-    std::vector<mtmd_bitmap*> bitmaps;
-    bitmaps.reserve(audioPaths.size());
-    for (const auto& path : audioPaths) {
-        auto res = mtmd_helper_bitmap_init_from_file(mtmd_ctx_, path.c_str(), false);
-        if (!res.bitmap || !mtmd_bitmap_is_audio(res.bitmap)) {
-            if (res.bitmap) {
-                mtmd_bitmap_free(res.bitmap);
-            }
-            freeBitmaps(bitmaps);
-            return {};
+bool Runner::generateTokens(llama_context* ctx, llama_sampler* smpl, llama_pos n_past, int n_predict,
+                            Drafter* drafter, const TextSink& onText, JobControl* control,
+                            std::vector<llama_token>& history, std::string& output, std::string& error,
+                            DecodeStats& stats) {
+    stats.n_past = n_past;
+    if (n_predict <= 0) {
+        return true;
+    }
+
+    const llama_vocab* vocab = llama_model_get_vocab(shared_model_.get());
+    const size_t maxDraft = drafter ? static_cast<size_t>(std::max(0, env_int("NRVNA_DRAFT_MAX", 8))) : 0;
+    const auto start = std::chrono::steady_clock::now();
+    LlamaBatchOwner batchOwner(static_cast<int>(maxDraft) + 1);
+    TextStream stream(onText);
+    llama_batch& batch = batchOwner.value;
+
+    // Append one sampled token. Returns false once generation is over.
+    auto emit = [&](llama_token token) {
+        if (llama_vocab_is_eog(vocab, token)) {
+            return false;
+        }
+        auto piece = token_piece(vocab, token);
+        if (!piece) {
+            error = "Failed to convert generated token to text";
+            return false;
+        }
+        output += *piece;
+        stream.append(*piece);
+        history.push_back(token);
+        return ++stats.generated < n_predict;
+    };
+
+    llama_token last = llama_sampler_sample(smpl, ctx, -1);
+    bool running = emit(last);
+    while (running) {
+        if (control && control->stopRequested()) {
+            error = control->reason();
+            break;
+        }
+        const size_t budget = std::min(maxDraft, static_cast<size_t>(n_predict - stats.generated));
+        const std::vector<llama_token> draft = budget > 0 ? drafter->propose(history, budget)
+                                                          : std::vector<llama_token>{};
+
+        // Decode the last token and the draft in one batch, with explicit positions.
+        batch.n_tokens = 0;
+        for (size_t i = 0; i <= draft.size(); ++i) {
+            const int k = batch.n_tokens++;
+            batch.token[k] = i == 0 ? last : draft[i - 1];
+            batch.pos[k] = n_past + static_cast<llama_pos>(i);
+            batch.n_seq_id[k] = 1;
+            batch.seq_id[k][0] = 0;
+            batch.logits[k] = true;
+        }
+        if (llama_decode(ctx, batch)) {
+            error = stopError(control, "Failed to decode generated token");
+            break;
+        }
+
+        // Accept draft tokens while the target samples the same token. Sampling
+        // stays exact: every emitted token is the target sampler's choice.
+        size_t accepted = 0;
+        llama_token next = llama_sampler_sample(smpl, ctx, 0);
+        while (accepted < draft.size() && next == draft[accepted]) {
+            ++accepted;
+            running = emit(next);
+            if (!running) break;
+            next = llama_sampler_sample(smpl, ctx, static_cast<int32_t>(accepted));
+        }
+        stats.drafted += static_cast<int>(draft.size());
+        stats.accepted += static_cast<int>(accepted);
+        n_past += 1 + static_cast<llama_pos>(accepted);
+        if (accepted < draft.size()) {
+            llama_memory_seq_rm(llama_get_memory(ctx), 0, n_past, -1);
+        }
+        if (!running) break;
+
+        last = next;
+        running = emit(last);
+    }
+
+    stream.flush();
+    stats.seconds = secondsSince(start);
+    stats.n_past = n_past;
+    return error.empty();
+}
+
+void Runner::setSystemPrompt(std::string prompt) {
+    std::lock_guard<std::mutex> lock(template_head_mutex_);
+    system_prompt_ = std::move(prompt);
+    template_head_ready_ = false;
+}
+
+std::vector<int32_t> Runner::tokenize(const std::string& text) const {
+    const llama_vocab* vocab = llama_model_get_vocab(shared_model_.get());
+    const int n_tokens = -llama_tokenize(vocab, text.c_str(), text.size(), NULL, 0, true, true);
+    if (n_tokens <= 0) {
+        return {};
+    }
+    std::vector<llama_token> tokens(n_tokens);
+    if (llama_tokenize(vocab, text.c_str(), text.size(), tokens.data(), tokens.size(), true, true) < 0) {
+        return {};
+    }
+    return tokens;
+}
+
+std::vector<int32_t> Runner::templateHead() {
+    std::lock_guard<std::mutex> lock(template_head_mutex_);
+    if (!template_head_ready_) {
+        // The head is whatever two different user messages have in common.
+        const auto a = tokenize(formatPrompt("a"));
+        const auto b = tokenize(formatPrompt("b"));
+        size_t n = 0;
+        while (n < a.size() && n < b.size() && a[n] == b[n]) {
+            ++n;
+        }
+        template_head_.assign(a.begin(), a.begin() + static_cast<std::ptrdiff_t>(n));
+        template_head_ready_ = true;
+    }
+    return template_head_;
+}
+
+std::vector<size_t> Runner::prefixBoundaries(const std::vector<int32_t>& tokens, size_t limit) {
+    std::vector<size_t> bounds;
+    if (!prefix_cache_ || limit == 0 || llama_model_has_encoder(shared_model_.get())) {
+        return bounds;
+    }
+
+    const auto head = templateHead();
+    const bool hasHead = !head.empty() && head.size() <= limit &&
+                         std::equal(head.begin(), head.end(), tokens.begin());
+    if (hasHead) {
+        bounds.push_back(head.size());
+    }
+    const size_t block = static_cast<size_t>(env_positive_int("NRVNA_PREFIX_BLOCK", 256));
+    for (size_t length = block; length <= limit; length += block) {
+        if (!hasHead || length != head.size()) {
+            bounds.push_back(length);
+        }
+    }
+    return bounds;
+}
+
+size_t Runner::restorePrefix(llama_context* ctx, const std::vector<int32_t>& tokens,
+                             const std::vector<size_t>& bounds) {
+    if (bounds.empty()) {
+        return 0;
+    }
+    auto entry = prefix_cache_->lookup(tokens, bounds);
+    if (!entry || !seq_state_set(ctx, entry->state, 0)) {
+        return 0;
+    }
+    LOG_DEBUG("Prefix cache hit: " + std::to_string(entry->tokens.size()) + " tokens");
+    return entry->tokens.size();
+}
+
+size_t Runner::chooseSnapshot(const std::vector<int32_t>& tokens, const std::vector<size_t>& bounds,
+                              size_t reused) {
+    size_t snapshot = 0;
+    for (size_t length : bounds) {
+        if (length <= reused || prefix_cache_->contains(tokens, length)) {
+            continue;
+        }
+        // One-off prompts are never cached; a prefix earns a snapshot on its second sighting.
+        if (prefix_cache_->noteSighting(tokens, length) >= 2) {
+            snapshot = std::max(snapshot, length);
         }
-        bitmaps.push_back(res.bitmap);
     }
-    return bitmaps;
+    return snapshot;
+}
+
+void Runner::savePrefix(llama_context* ctx, const std::vector<int32_t>& tokens, size_t length, bool pinned) {
+    auto state = seq_state_get(ctx, 0);
+    if (state.empty()) {
+        return;
+    }
+    std::vector<int32_t> prefix(tokens.begin(), tokens.begin() + static_cast<std::ptrdiff_t>(length));
+    if (prefix_cache_->insert(std::move(prefix), std::move(state), pinned)) {
+        LOG_DEBUG("Prefix cached: " + std::to_string(length) + " tokens, cache " +
+                  std::to_string(prefix_cache_->bytes() / (1024 * 1024)) + " MB");
+    }
 }
 
-void Runner::freeBitmaps(std::vector<mtmd_bitmap*>& bitmaps) const noexcept {
-    for (auto* bmp : bitmaps) {
-        mtmd_bitmap_free(bmp);
+size_t Runner::resumeConversation(llama_context* ctx, const std::vector<int32_t>& tokens,
+                                  const std::filesystem::path& statePath, size_t reused) {
+    std::error_code ec;
+    if (!std::filesystem::is_regular_file(statePath, ec)) {
+        return reused;
+    }
+    // The parent's tokens must be a strict prefix: the template may render
+    // history differently than it was generated (stripped reasoning, say).
+    auto parent = KvSnapshotStore::readFile(statePath, true);
+    if (parent && parent->model != current_model_identity_) {
+        // Another model with the same vocabulary would accept the state silently.
+        LOG_WARN("Parent conversation state is from another model; prefilling");
+        return reused;
+    }
+    if (!parent || parent->tokens.size() <= reused || parent->tokens.size() >= tokens.size() ||
+        !std::equal(parent->tokens.begin(), parent->tokens.end(), tokens.begin())) {
+        LOG_DEBUG("Parent conversation state does not prefix this prompt; prefilling");
+        return reused;
+    }
+
+    // A resident copy is cheaper than reading the file.
+    std::shared_ptr<const PrefixEntry> entry =
+        prefix_cache_ ? prefix_cache_->lookup(tokens, {parent->tokens.size()}) : nullptr;
+    if (!entry) {
+        entry = KvSnapshotStore::readFile(statePath);
+    }
+    if (!entry || entry->tokens.size() != parent->tokens.size() || !seq_state_set(ctx, entry->state, 0)) {
+        llama_memory_clear(llama_get_memory(ctx), true);
+        LOG_WARN("Failed to restore parent conversation state: " + statePath.string());
+        return 0;
+    }
+    LOG_DEBUG("Resumed conversation: " + std::to_string(entry->tokens.size()) + " tokens");
+    return entry->tokens.size();
+}
+
+void Runner::saveConversation(llama_context* ctx, std::vector<int32_t> tokens, size_t length,
+                              const std::filesystem::path& path) {
+    if (length == 0 || length > tokens.size()) {
+        return;
+    }
+    PrefixEntry entry;
+    tokens.resize(length);
+    entry.tokens = std::move(tokens);
+    entry.state = seq_state_get(ctx, 0);
+    entry.model = current_model_identity_;
+    if (entry.state.empty() || !KvSnapshotStore::writeFile(path, entry)) {
+        LOG_WARN("Failed to keep conversation state: " + path.string());
+        return;
+    }
+    if (prefix_cache_) {
+        prefix_cache_->insert(std::move(entry.tokens), std::move(entry.state), false, false);
+    }
+}
+
+bool Runner::evalMediaChunks(llama_context* ctx, mtmd_input_chunks* chunks, llama_pos& n_past, size_t& reused) {
+    const int32_t n_batch = static_cast<int32_t>(llama_n_batch(ctx));
+    const size_t n_chunks = mtmd_input_chunks_size(chunks);
+    n_past = 0;
+    reused = 0;
+
+    const mtmd_input_chunk* first = n_chunks > 0 ? mtmd_input_chunks_get(chunks, 0) : nullptr;
+    if (!prefix_cache_ || !first || mtmd_input_chunk_get_type(first) != MTMD_INPUT_CHUNK_TYPE_TEXT) {
+        return media_->eval(ctx, chunks, 0, n_past);
+    }
+
+    // The leading text chunk (template head, system prompt) is plain tokens and
+    // can come from the prefix cache. Media chunks are always evaluated.
+    size_t n_text = 0;
+    const llama_token* text = mtmd_input_chunk_get_tokens_text(first, &n_text);
+    std::vector<int32_t> tokens(text, text + n_text);
+    const bool textOnly = n_chunks == 1;
+    const auto bounds = prefixBoundaries(tokens, textOnly && n_text > 0 ? n_text - 1 : n_text);
+    reused = restorePrefix(ctx, tokens, bounds);
+    const size_t snapshotAt = chooseSnapshot(tokens, bounds, reused);
+
+    LlamaBatchOwner batchOwner(n_batch);
+    llama_batch& batch = batchOwner.value;
+    for (size_t i = reused; i < n_text; ) {
+        size_t end = std::min(i + static_cast<size_t>(n_batch), n_text);
+        if (snapshotAt > i && snapshotAt < end) {
+            end = snapshotAt;
+        }
+        batch.n_tokens = 0;
+        for (size_t j = i; j < end; ++j) {
+            const int k = batch.n_tokens++;
+            batch.token[k] = tokens[j];
+            batch.pos[k] = static_cast<llama_pos>(j);
+            batch.n_seq_id[k] = 1;
+            batch.seq_id[k][0] = 0;
+            batch.logits[k] = textOnly && j + 1 == n_text;
+        }
+        if (llama_decode(ctx, batch)) {
+            return false;
+        }
+        i = end;
+        if (i == snapshotAt) {
+            savePrefix(ctx, tokens, snapshotAt);
+        }
+    }
+    n_past = static_cast<llama_pos>(n_text);
+    return media_->eval(ctx, chunks, 1, n_past);
+}
+
+bool Runner::warmPrefixCache() noexcept {
+    if (!prefix_cache_ || system_prompt_.empty() || !shared_model_ ||
+        llama_model_has_encoder(shared_model_.get())) {
+        return false;
+    }
+
+    try {
+        const auto head = templateHead();
+        if (head.empty()) {
+            return false;
+        }
+
+        // A snapshot from an earlier run only needs pinning.
+        if (auto cached = prefix_cache_->lookup(head, {head.size()})) {
+            prefix_cache_->insert(cached->tokens, cached->state, true);
+            LOG_INFO("System prompt restored from snapshot: " + std::to_string(head.size()) + " tokens");
+            return true;
+        }
+
+        llama_context_params params = llama_context_default_params();
+        params.n_ctx = static_cast<uint32_t>(head.size()) + 1;
+        params.n_batch = static_cast<uint32_t>(std::min<size_t>(head.size() + 1,
+                                                                env_positive_int("NRVNA_BATCH", 2048)));
+        params.n_ubatch = params.n_batch;
+        params.no_perf = false;
+        if (effective_gpu_layers() <= 0) {
+            params.offload_kqv = false;
+            params.op_offload = false;
+        }
+        auto ctx = acquireContext(params);
+        if (!ctx) {
+            return false;
+        }
+
+        std::vector<llama_token> tokens(head.begin(), head.end());
+        const size_t n_batch = llama_n_batch(ctx.get());
+        for (size_t i = 0; i < tokens.size(); i += n_batch) {
+            const size_t n_eval = std::min(n_batch, tokens.size() - i);
+            if (llama_decode(ctx.get(), llama_batch_get_one(tokens.data() + i, static_cast<int32_t>(n_eval)))) {
+                LOG_WARN("Failed to prefill system prompt");
+                return false;
+            }
+        }
+        savePrefix(ctx.get(), tokens, tokens.size(), true);
+        LOG_INFO("System prompt prefilled: " + std::to_string(tokens.size()) + " tokens");
+        return true;
+    } catch (const std::exception& e) {
+        LOG_WARN("System prompt prefill failed: " + std::string(e.what()));
+        return false;
     }
-    bitmaps.clear();
 }
 
 }
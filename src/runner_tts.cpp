@@ -10,6 +10,7 @@
 #define _USE_MATH_DEFINES
 
 #include "nrvna/runner_tts.hpp"
+#include "nrvna/job_control.hpp"
 #include "nrvna/logger.hpp"
 #include "llama_util.hpp"
 #include "llama.h"
@@ -553,7 +554,7 @@ TtsRunner::TtsRunner(const std::string& modelPath, const std::string& vocoderPat
 
 TtsRunner::~TtsRunner() = default;
 
-TtsResult TtsRunner::run(const std::string& text) {
+TtsResult TtsRunner::run(const std::string& text, JobControl* control) {
     if (!shared_tts_model_ || !shared_vocoder_) {
         return {false, {}, 24000, "TTS models not loaded"};
     }
@@ -610,6 +611,10 @@ TtsResult TtsRunner::run(const std::string& text) {
         // Match the CPU-only TTS context to n_gpu_layers=0.
         ctx_params.offload_kqv = false;
         ctx_params.op_offload = false;
+        if (control) {
+            ctx_params.abort_callback = JobControl::abortCallback;
+            ctx_params.abort_callback_data = control;
+        }
 
         ContextPtr ctx_ttc(llama_init_from_model(shared_tts_model_.get(), ctx_params));
         if (!ctx_ttc) {
@@ -634,6 +639,9 @@ TtsResult TtsRunner::run(const std::string& text) {
         // Eval prompt
         llama_batch batch = llama_batch_get_one(prompt_tokens.data(), prompt_tokens.size());
         if (llama_decode(ctx_ttc.get(), batch) != 0) {
+            if (control && control->stopRequested()) {
+                return {false, {}, 24000, control->reason()};
+            }
             return {false, {}, 24000, "Failed to decode TTS prompt"};
         }
 
@@ -642,6 +650,9 @@ TtsResult TtsRunner::run(const std::string& text) {
         bool decodeFailed = false;
 
         for (int i = 0; i < n_predict; ++i) {
+            if (control && control->stopRequested()) {
+                break;
+            }
             llama_token new_token = llama_sampler_sample(smpl.get(), ctx_ttc.get(), -1);
 
             if (llama_vocab_is_eog(vocab, new_token)) {
@@ -661,6 +672,10 @@ TtsResult TtsRunner::run(const std::string& text) {
         smpl.reset();
         ctx_ttc.reset();
 
+        // Partial codes make no usable audio, so a stopped job just fails.
+        if (control && control->stopRequested()) {
+            return {false, {}, 24000, control->reason()};
+        }
         if (decodeFailed) {
             return {false, {}, 24000, "Failed to decode generated TTS token"};
         }
@@ -7,71 +7,208 @@
 #include "nrvna/scanner.hpp"
 #include "nrvna/contract.hpp"
 #include "nrvna/logger.hpp"
+#include "nrvna/meta.hpp"
 #include "llama_util.hpp"
 #include <algorithm>
+#include <chrono>
 #include <fstream>
+#include <dirent.h>
+#include <sys/stat.h>
 
 namespace nrvna {
 
+namespace {
+int64_t mtimeNanoseconds(const struct stat& st) noexcept {
+#if defined(__APPLE__)
+    return static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1'000'000'000 + st.st_mtimespec.tv_nsec;
+#else
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1'000'000'000 + st.st_mtim.tv_nsec;
+#endif
+}
+}
+
 Scanner::Scanner(const std::filesystem::path& workspace) noexcept 
-    : workspace_(workspace), readyPath_(workspace / contract::kReadyDir) {
+    : workspace_(workspace), readyPath_(workspace / contract::kReadyDir),
+      maxPromptBytes_(static_cast<std::uintmax_t>(env_positive_int("NRVNA_MAX_PROMPT_SIZE", 10'000'000))) {
 }
 
-std::vector<JobId> Scanner::scan() const noexcept {
+std::vector<JobId> Scanner::scan() noexcept {
     std::vector<JobId> jobs;
-    
-    try {
-        if (!std::filesystem::exists(readyPath_)) {
-            LOG_DEBUG("Ready directory does not exist: " + readyPath_.string());
-            return jobs;
-        }
+    refresh(nullptr);
 
-        for (const auto& entry : std::filesystem::directory_iterator(readyPath_)) {
-            if (entry.is_directory()) {
-                JobId jobId = extractJobId(entry.path());
-                if (contract::isValidJobId(jobId) && isValidJobDirectory(entry.path())) {
-                    jobs.push_back(jobId);
-                    LOG_TRACE("Found job: " + jobId);
-                }
+    try {
+        jobs.reserve(validCount_);
+        for (const auto& [id, entry] : entries_) {
+            if (entry.valid) {
+                jobs.push_back(id);
             }
         }
-
         // Sort by job ID for consistent ordering (timestamp is in the ID)
         std::sort(jobs.begin(), jobs.end());
-        
         if (!jobs.empty()) {
             LOG_DEBUG("Scanner found " + std::to_string(jobs.size()) + " ready jobs");
         }
-        
-    } catch (const std::exception& e) {
-        LOG_ERROR("Scanner error: " + std::string(e.what()));
     } catch (...) {
         LOG_ERROR("Unknown scanner error");
     }
-    
     return jobs;
 }
 
-std::size_t Scanner::readyJobCount() const noexcept {
-    std::size_t count = 0;
-    
+ScanDelta Scanner::scanDelta() noexcept {
+    ScanDelta delta;
+    refresh(&delta);
+    std::sort(delta.added.begin(), delta.added.end());
+    std::sort(delta.removed.begin(), delta.removed.end());
+    if (!delta.added.empty()) {
+        LOG_DEBUG("Scanner found " + std::to_string(delta.added.size()) + " new ready jobs");
+    }
+    return delta;
+}
+
+std::size_t Scanner::readyJobCount() noexcept {
+    refresh(nullptr);
+    return validCount_;
+}
+
+bool Scanner::listed(const JobId& id) const noexcept {
+    auto it = entries_.find(id);
+    return it != entries_.end() && it->second.valid;
+}
+
+JobTraits Scanner::traits(const JobId& id, const CostModel* costs) noexcept {
+    auto it = entries_.find(id);
+    if (it != entries_.end() && it->second.traitsKnown) {
+        return it->second.traits;
+    }
+    JobTraits traits;
     try {
-        if (!std::filesystem::exists(readyPath_)) {
-            return 0;
+        const auto dir = readyPath_ / id;
+        if (auto meta = readMetaJson(dir)) {
+            traits = jobTraits(*meta);
+        }
+        const JobShape shape = CostModel::inspect(dir);
+        traits.media = shape.type == JobType::Vision || shape.type == JobType::Stt ||
+                       (shape.type == JobType::Embed && shape.images > 0);
+        if (costs) {
+            traits.cost = costs->estimate(shape);
+        }
+        if (it != entries_.end()) {
+            it->second.traits = traits;
+            it->second.traitsKnown = true;
         }
+    } catch (...) {
+    }
+    return traits;
+}
 
-        for (const auto& entry : std::filesystem::directory_iterator(readyPath_)) {
-            if (entry.is_directory() &&
-                contract::isValidJobId(extractJobId(entry.path())) &&
-                isValidJobDirectory(entry.path())) {
-                ++count;
+void Scanner::refresh(ScanDelta* delta) noexcept {
+    try {
+        struct stat dirSt;
+        if (::stat(readyPath_.c_str(), &dirSt) != 0) {
+            LOG_DEBUG("Ready directory does not exist: " + readyPath_.string());
+            for (const auto& [id, entry] : entries_) {
+                if (entry.valid && delta) delta->removed.push_back(id);
             }
+            entries_.clear();
+            validCount_ = invalidCount_ = 0;
+            stamp_ = {};
+            stampSettled_ = false;
+            return;
         }
+
+        // Renames in or out of input/ready/ change its mtime. Invalid entries
+        // are rechecked every pass, as they may still be being written.
+        const DirStamp stamp{static_cast<uint64_t>(dirSt.st_dev), static_cast<uint64_t>(dirSt.st_ino),
+                             mtimeNanoseconds(dirSt)};
+        if (stampSettled_ && stamp == stamp_ && invalidCount_ == 0) {
+            return;
+        }
+        const int64_t listedAt = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+
+        DIR* dir = ::opendir(readyPath_.c_str());
+        if (!dir) {
+            LOG_ERROR("Scanner cannot open " + readyPath_.string());
+            return;
+        }
+        ++pass_;
+        while (const struct dirent* ent = ::readdir(dir)) {
+            const char* name = ent->d_name;
+            if (name[0] == '.') continue;
+
+            // d_type spares a stat per entry; some filesystems leave it unknown.
+            if (ent->d_type != DT_DIR) {
+                if (ent->d_type != DT_UNKNOWN && ent->d_type != DT_LNK) continue;
+                struct stat st;
+                if (::stat((readyPath_ / name).c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) continue;
+            }
+
+            JobId jobId(name);
+            if (!contract::isValidJobId(jobId)) continue;
+            const auto inode = static_cast<uint64_t>(ent->d_ino);
+            auto it = entries_.find(jobId);
+            if (it != entries_.end() && it->second.valid && it->second.inode == inode) {
+                it->second.pass = pass_;
+                continue;
+            }
+
+            const bool valid = isValidJobDirectory(readyPath_ / jobId);
+            if (it == entries_.end()) {
+                it = entries_.emplace(jobId, Entry{}).first;
+                ++invalidCount_;
+            }
+            Entry& entry = it->second;
+            if (entry.valid != valid) {
+                if (valid) {
+                    ++validCount_;
+                    --invalidCount_;
+                    if (delta) delta->added.push_back(jobId);
+                } else {
+                    --validCount_;
+                    ++invalidCount_;
+                    if (delta) delta->removed.push_back(jobId);
+                }
+            }
+            entry.inode = inode;
+            entry.valid = valid;
+            entry.traitsKnown = false;
+            entry.pass = pass_;
+            LOG_TRACE("Found job: " + jobId);
+        }
+        ::closedir(dir);
+
+        for (auto it = entries_.begin(); it != entries_.end();) {
+            if (it->second.pass == pass_) {
+                ++it;
+                continue;
+            }
+            if (it->second.valid) {
+                --validCount_;
+                if (delta) delta->removed.push_back(it->first);
+            } else {
+                --invalidCount_;
+            }
+            it = entries_.erase(it);
+        }
+
+        // With coarse timestamps, a change made just after the listing can
+        // keep the same mtime. Trust an unchanged mtime only once it is old.
+        constexpr int64_t kSettleNs = 2'000'000'000;
+        stamp_ = stamp;
+        stampSettled_ = listedAt - stamp.mtimeNs > kSettleNs;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Scanner error: " + std::string(e.what()));
     } catch (...) {
-        // Return what we counted so far
+        LOG_ERROR("Unknown scanner error");
+    }
+}
+
+bool Scanner::isReady(const std::string& name) const noexcept {
+    try {
+        return contract::isValidJobId(name) && isValidJobDirectory(readyPath_ / name);
+    } catch (...) {
+        return false;
     }
-    
-    return count;
 }
 
 bool Scanner::isValidJobDirectory(const std::filesystem::path& dir) const noexcept {
@@ -95,8 +232,7 @@ bool Scanner::isValidJobDirectory(const std::filesystem::path& dir) const noexce
             LOG_DEBUG("Invalid job directory (cannot stat prompt.txt): " + dir.string());
             return false;
         }
-        const auto maxPromptBytes = static_cast<std::uintmax_t>(env_positive_int("NRVNA_MAX_PROMPT_SIZE", 10'000'000));
-        if (promptBytes > maxPromptBytes) {
+        if (promptBytes > maxPromptBytes_) {
             LOG_DEBUG("Invalid job directory (prompt.txt too large): " + dir.string());
             return false;
         }
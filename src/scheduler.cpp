@@ -0,0 +1,254 @@
+/*
+ * nrvna - Durable Local Inference Primitives
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "nrvna/scheduler.hpp"
+#include "nrvna/contract.hpp"
+#include "nrvna/logger.hpp"
+#include <algorithm>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+
+namespace nrvna {
+
+namespace {
+// Keeps a tiny weight from spinning the rotation for long.
+constexpr double kMinWeight = 0.01;
+}
+
+std::string fairShareGroup(const JobMeta& meta) {
+    if (!meta.tags.empty()) return meta.tags.front();
+    if (!meta.parent.empty()) return "parent:" + meta.parent;
+    return "";
+}
+
+JobTraits jobTraits(const JobMeta& meta) {
+    JobTraits traits;
+    traits.priority = contract::parsePriority(meta.priority);
+    traits.group = fairShareGroup(meta);
+    return traits;
+}
+
+std::optional<SchedulerConfig> loadSchedulerConfig(const std::filesystem::path& workspace) {
+    SchedulerConfig config;
+    const auto path = workspace / contract::kConfigFile;
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec)) {
+        return config;
+    }
+    try {
+        std::ifstream file(path, std::ios::binary);
+        auto document = nlohmann::json::parse(file);
+        if (!document.is_object()) throw std::runtime_error("not an object");
+        if (!document.contains("scheduler")) return config;
+        const auto& section = document["scheduler"];
+        if (!section.is_object()) throw std::runtime_error("\"scheduler\" is not an object");
+        if (section.contains("weights")) {
+            const auto& weights = section["weights"];
+            if (!weights.is_object()) throw std::runtime_error("\"weights\" is not an object");
+            for (const auto& [group, value] : weights.items()) {
+                if (!value.is_number() || !(value.get<double>() > 0.0)) {
+                    throw std::runtime_error("weight of \"" + group + "\" is not a positive number");
+                }
+                config.weights[group] = value.get<double>();
+            }
+        }
+        return config;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Invalid " + path.string() + ": " + e.what());
+        return std::nullopt;
+    }
+}
+
+Scheduler::Scheduler(SchedulerConfig config) noexcept : config_(std::move(config)) {}
+
+double Scheduler::weight(const std::string& group) const noexcept {
+    auto it = config_.weights.find(group);
+    return it == config_.weights.end() ? 1.0 : std::max(it->second, kMinWeight);
+}
+
+bool Scheduler::push(const JobId& id, const JobTraits& traits, Clock::time_point now) {
+    if (!queued_.insert(id).second) {
+        return false;
+    }
+    auto index = static_cast<std::size_t>(traits.priority);
+    if (index >= kLanes) index = static_cast<std::size_t>(Priority::Normal);
+    if (traits.media) {
+        index += kLanes;
+        ++mediaQueued_;
+    }
+    Lane& lane = lanes_[index];
+    auto [it, added] = lane.groups.try_emplace(traits.group);
+    if (added) {
+        lane.rotation.push_back(traits.group);
+    }
+    const uint64_t seq = seq_++;
+    it->second.bySeq.emplace(seq, Queued{id, now, traits.cost});
+    it->second.byCost.emplace(traits.cost, seq);
+    return true;
+}
+
+std::optional<ScheduledJob> Scheduler::pop(Clock::time_point now, bool allowMedia) {
+    // The oldest job of a lane is the first arrival of one of its groups.
+    const std::size_t lanes = allowMedia ? lanes_.size() : kLanes;
+    std::size_t best = lanes_.size();
+    std::size_t bestRank = kLanes;
+    std::size_t highest = kLanes;  // highest priority with a runnable job
+    Clock::time_point bestSince;
+    std::string oldestGroup;
+    for (std::size_t index = 0; index < lanes; ++index) {
+        const Lane& lane = lanes_[index];
+        if (lane.rotation.empty()) continue;
+        const std::size_t priority = index % kLanes;
+        highest = std::min(highest, priority);
+        const std::string* group = nullptr;
+        Clock::time_point since;
+        for (const auto& name : lane.rotation) {
+            const auto& front = lane.groups.at(name).bySeq.begin()->second;
+            if (!group || front.since < since) {
+                group = &name;
+                since = front.since;
+            }
+        }
+        std::size_t rank = priority;
+        if (config_.aging.count() > 0 && now > since) {
+            const auto steps = static_cast<std::size_t>((now - since) / config_.aging);
+            rank = steps >= priority ? 0 : priority - steps;
+        }
+        if (best == lanes_.size() || rank < bestRank || (rank == bestRank && since < bestSince)) {
+            best = index;
+            bestRank = rank;
+            bestSince = since;
+            oldestGroup = *group;
+        }
+    }
+    if (best == lanes_.size()) {
+        return std::nullopt;
+    }
+
+    // A job that aging moved past a higher lane runs ahead of its own lane.
+    Lane& lane = lanes_[best];
+    ScheduledJob job;
+    job.id = best % kLanes > highest ? take(lane, oldestGroup, now, true) : takeFair(lane, now);
+    job.media = best >= kLanes;
+    queued_.erase(job.id);
+    if (job.media) --mediaQueued_;
+    return job;
+}
+
+std::vector<JobId> Scheduler::upcoming(std::size_t n, Clock::time_point now) const {
+    std::vector<JobId> ids;
+    if (n == 0 || queued_.empty()) {
+        return ids;
+    }
+    ids.reserve(std::min(n, queued_.size()));
+
+    // Lanes in the order pop() drains them at now, ranked as it ranks them.
+    struct Ranked {
+        std::size_t rank;
+        Clock::time_point since;
+        std::size_t index;
+    };
+    std::array<Ranked, kLanes * 2> order{};
+    std::size_t lanes = 0;
+    for (std::size_t index = 0; index < lanes_.size(); ++index) {
+        const Lane& lane = lanes_[index];
+        if (lane.rotation.empty()) continue;
+        Clock::time_point since = Clock::time_point::max();
+        for (const auto& name : lane.rotation) {
+            since = std::min(since, lane.groups.at(name).bySeq.begin()->second.since);
+        }
+        const std::size_t priority = index % kLanes;
+        std::size_t rank = priority;
+        if (config_.aging.count() > 0 && now > since) {
+            const auto steps = static_cast<std::size_t>((now - since) / config_.aging);
+            rank = steps >= priority ? 0 : priority - steps;
+        }
+        order[lanes++] = {rank, since, index};
+    }
+    std::sort(order.begin(), order.begin() + static_cast<std::ptrdiff_t>(lanes), [](const Ranked& a, const Ranked& b) {
+        return a.rank != b.rank ? a.rank < b.rank : a.since < b.since;
+    });
+
+    // Within a lane the groups take turns one job at a time, each in the
+    // order take() uses; weights are ignored, which is close enough for hints.
+    const auto bound = config_.shortestFirstWait;
+    for (std::size_t l = 0; l < lanes && ids.size() < n; ++l) {
+        const Lane& lane = lanes_[order[l].index];
+        for (std::size_t round = 0; ids.size() < n; ++round) {
+            bool found = false;
+            for (const auto& name : lane.rotation) {
+                if (ids.size() >= n) break;
+                const Group& state = lane.groups.at(name);
+                if (round >= state.bySeq.size()) continue;
+                found = true;
+                const auto& first = state.bySeq.begin()->second;
+                if (bound.count() > 0 && now - first.since < bound) {
+                    auto it = std::next(state.byCost.begin(), static_cast<std::ptrdiff_t>(round));
+                    ids.push_back(state.bySeq.at(it->second).id);
+                } else {
+                    ids.push_back(std::next(state.bySeq.begin(), static_cast<std::ptrdiff_t>(round))->second.id);
+                }
+            }
+            if (!found) break;
+        }
+    }
+    return ids;
+}
+
+JobId Scheduler::take(Lane& lane, const std::string& group, Clock::time_point now, bool oldest) {
+    auto it = lane.groups.find(group);
+    Group& state = it->second;
+    auto first = state.bySeq.begin();
+    const auto bound = config_.shortestFirstWait;
+    if (!oldest && bound.count() > 0 && now - first->second.since < bound) {
+        first = state.bySeq.find(state.byCost.begin()->second);
+    }
+    JobId id = std::move(first->second.id);
+    state.byCost.erase({first->second.cost, first->first});
+    state.bySeq.erase(first);
+    if (state.bySeq.empty()) {
+        lane.groups.erase(it);
+        lane.rotation.erase(std::find(lane.rotation.begin(), lane.rotation.end(), group));
+    }
+    return id;
+}
+
+JobId Scheduler::takeFair(Lane& lane, Clock::time_point now) {
+    // Deficit round robin with a unit cost per job: a group's turn adds its
+    // weight to its deficit, and it runs one job per whole unit.
+    while (true) {
+        const std::string group = lane.rotation.front();
+        Group& state = lane.groups.at(group);
+        if (state.deficit < 1.0) {
+            state.deficit += weight(group);
+            if (state.deficit < 1.0) {
+                lane.rotation.pop_front();
+                lane.rotation.push_back(group);
+                continue;
+            }
+        }
+        state.deficit -= 1.0;
+        const bool turnOver = state.deficit < 1.0;
+        JobId id = take(lane, group, now, false);
+        if (turnOver && lane.groups.count(group) > 0) {
+            lane.rotation.pop_front();
+            lane.rotation.push_back(group);
+        }
+        return id;
+    }
+}
+
+void Scheduler::clear() noexcept {
+    for (auto& lane : lanes_) {
+        lane.groups.clear();
+        lane.rotation.clear();
+    }
+    queued_.clear();
+    mediaQueued_ = 0;
+}
+
+}
@@ -5,20 +5,28 @@
  */
 
 #include "nrvna/server.hpp"
+#include "nrvna/archive.hpp"
 #include "nrvna/contract.hpp"
+#include "nrvna/cost_model.hpp"
+#include "nrvna/durability.hpp"
+#include "nrvna/job_index.hpp"
 #include "nrvna/meta.hpp"
 #include "nrvna/scanner.hpp"
 #include "nrvna/pool.hpp"
 #include "nrvna/processor.hpp"
+#include "nrvna/ready_watcher.hpp"
+#include "nrvna/retention.hpp"
 #include "nrvna/runner.hpp"
 #include "nrvna/runner_tts.hpp"
 #include "nrvna/logger.hpp"
+#include "llama_util.hpp"
+#include <algorithm>
 #include <chrono>
 #include <cstdlib>
 #include <fstream>
 #include <thread>
 #include <unordered_map>
-#include <unordered_set>
+#include <vector>
 
 namespace nrvna {
 
@@ -75,6 +83,7 @@ bool writeRecoveryFailure(const std::filesystem::path& jobPath,
             LOG_ERROR("Failed to move recovered job to failed/ for " + jobId + ": " + ec.message());
             return false;
         }
+        journal::append(jobPath.parent_path().parent_path(), jobId, Status::Failed, failedMeta);
 
         return true;
     } catch (const std::exception& e) {
@@ -146,9 +155,11 @@ RecoveryReport recoverOrphanedJobs(const std::filesystem::path& workspace,
                 if (ec2) {
                     LOG_ERROR("Orphan recovery failed for " + jobId + ": ready=" + ec.message() + ", failed=" + ec2.message());
                 } else {
+                    journal::append(workspace, jobId, Status::Failed, meta);
                     report.terminalized++;
                 }
             } else {
+                journal::append(workspace, jobId, Status::Queued, meta);
                 report.recovered++;
             }
         }
@@ -161,8 +172,8 @@ RecoveryReport recoverOrphanedJobs(const std::filesystem::path& workspace,
 }
 
 Server::Server(const std::string& modelPath, const std::filesystem::path& workspace, int workers,
-               const std::string& mmprojPath, const std::string& vocoderPath)
-    : modelPath_(modelPath), mmprojPath_(mmprojPath), vocoderPath_(vocoderPath), workspace_(workspace), workers_(workers) {
+               const std::string& mmprojPath, const std::string& vocoderPath, const std::string& draftPath)
+    : modelPath_(modelPath), mmprojPath_(mmprojPath), vocoderPath_(vocoderPath), draftPath_(draftPath), workspace_(workspace), workers_(workers) {
     LOG_DEBUG("Server created - model: " + modelPath + ", workspace: " + workspace_.string() +
               ", workers: " + std::to_string(workers));
 }
@@ -204,6 +215,9 @@ bool Server::start() {
     if (!mmprojPath_.empty()) {
         LOG_DEBUG("MMProj: " + mmprojPath_);
     }
+    if (!draftPath_.empty()) {
+        LOG_DEBUG("Draft: " + draftPath_);
+    }
     LOG_DEBUG("Workspace: " + workspace_.string());
     LOG_DEBUG("Workers: " + std::to_string(workers_));
     LOG_DEBUG("nrvna Log Level: " + std::string(getenv("NRVNA_LOG_LEVEL") ? getenv("NRVNA_LOG_LEVEL") : "INFO"));
@@ -213,8 +227,59 @@ bool Server::start() {
     // Create components
     try {
         scanner_ = std::make_unique<Scanner>(workspace_);
-        pool_ = std::make_unique<Pool>(workers_);
-        processor_ = std::make_unique<Processor>(workspace_, modelPath_, mmprojPath_, vocoderPath_);
+        watcher_ = std::make_unique<ReadyWatcher>(workspace_ / contract::kReadyDir);
+        auto schedulerConfig = loadSchedulerConfig(workspace_);
+        if (!schedulerConfig) {
+            return false;
+        }
+        auto retention = loadRetentionPolicy(workspace_);
+        if (!retention) {
+            return false;
+        }
+        schedulerConfig->aging = std::chrono::seconds(env_positive_size("NRVNA_PRIORITY_AGING_SECONDS", 60));
+        schedulerConfig->shortestFirstWait = std::chrono::seconds(std::max(0, env_int("NRVNA_SJF_WAIT_SECONDS", 300)));
+        // Media jobs share one encoder thread but decode in parallel, so they
+        // are uncapped unless NRVNA_MEDIA_WORKERS says otherwise.
+        pool_ = std::make_unique<Pool>(workers_, std::move(*schedulerConfig),
+                                       std::max(0, env_int("NRVNA_MEDIA_WORKERS", 0)));
+        const char* durability = std::getenv("NRVNA_DURABILITY");
+        if (durability && !parseDurability(durability)) {
+            LOG_ERROR("Invalid NRVNA_DURABILITY value: " + std::string(durability) +
+                      " (expected none, rename, or full)");
+            return false;
+        }
+        if (Syncer::shared().mode() != Durability::None) {
+            LOG_INFO("Durability: " + std::string(durability));
+        }
+        // The index folds in the journal lines recovery just appended.
+        indexKeeper_ = std::make_unique<IndexKeeper>(
+            workspace_, std::chrono::seconds(env_positive_size("NRVNA_INDEX_SECONDS", 10)),
+            env_positive_size("NRVNA_JOURNAL_MAX_MB", 64) * 1024 * 1024);
+        if (!indexKeeper_->start()) {
+            LOG_WARN("Job index disabled; flw scans the state directories");
+        }
+        if (const int compactMinutes = env_int("NRVNA_COMPACT_MINUTES", 0); compactMinutes > 0) {
+            compactor_ = std::make_unique<Compactor>(
+                workspace_, std::chrono::minutes(compactMinutes),
+                env_positive_size("NRVNA_SEGMENT_MB", 256) * 1024 * 1024);
+            if (!compactor_->start()) {
+                compactor_.reset();
+            }
+        }
+        if (!retention->empty()) {
+            collector_ = std::make_unique<GarbageCollector>(
+                workspace_, std::move(*retention),
+                std::chrono::seconds(env_positive_size("NRVNA_GC_SECONDS", 300)),
+                env_positive_size("NRVNA_GC_BATCH", 100),
+                std::chrono::milliseconds(std::max(0, env_int("NRVNA_GC_PAUSE_MS", 1000))));
+            if (!collector_->start()) {
+                collector_.reset();
+            }
+        }
+        costModel_ = std::make_shared<CostModel>();
+        costModel_->seed(workspace_);
+        processor_ = std::make_unique<Processor>(workspace_, modelPath_, mmprojPath_, vocoderPath_, draftPath_);
+        processor_->setCostModel(costModel_);
 
         // Pre-initialize all Runners BEFORE starting worker threads
         LOG_DEBUG("Pre-initializing " + std::to_string(workers_) + " Runner instances...");
@@ -234,6 +299,10 @@ bool Server::start() {
             LOG_DEBUG("TTS runners initialized successfully");
         }
 
+        pool_->setLookahead(processor_->prefetchDepth(), [this](const std::vector<JobId>& jobIds) {
+            processor_->prefetch(jobIds);
+        });
+
         // Start pool with processor function
         LOG_DEBUG("Starting worker pool with " + std::to_string(workers_) + " threads...");
         if (!pool_->start([this](const JobId& jobId, int workerId) {
@@ -258,7 +327,11 @@ bool Server::start() {
         running_.store(false);
         if (pool_) pool_->stop();
         processor_.reset();
+        collector_.reset();
+        compactor_.reset();
+        indexKeeper_.reset();
         pool_.reset();
+        watcher_.reset();
         scanner_.reset();
         return false;
     }
@@ -275,6 +348,9 @@ void Server::shutdown() noexcept {
     running_.store(false);
 
     // Stop scanner thread
+    if (watcher_) {
+        watcher_->wake();
+    }
     if (scannerThread_.joinable()) {
         scannerThread_.join();
     }
@@ -284,9 +360,14 @@ void Server::shutdown() noexcept {
         pool_->stop();
     }
 
-    // Clean up components
+    // Clean up components. The index keeper goes after the processor so its
+    // last save includes the final publishes.
     processor_.reset();
+    collector_.reset();
+    compactor_.reset();
+    indexKeeper_.reset();
     pool_.reset();
+    watcher_.reset();
     scanner_.reset();
 
     LOG_INFO("Server shutdown complete");
@@ -323,52 +404,89 @@ bool Server::recoverOrphanedJobs() noexcept {
 void Server::scanLoop() {
     LOG_DEBUG("Scanner loop started");
 
-    const auto scanInterval = std::chrono::seconds(5);
+    // With a directory watch, arrivals are handed to the pool as they are
+    // published and the full scan is only a safety net for missed events.
+    const auto pollInterval = std::chrono::seconds(5);
+    const auto scanInterval = watcher_->active()
+        ? std::chrono::seconds(env_positive_size("NRVNA_RESCAN_SECONDS", 30))
+        : pollInterval;
     const auto retryInterval = std::chrono::seconds(30);
     std::unordered_map<JobId, std::chrono::steady_clock::time_point> submittedJobs;
+    auto nextScan = std::chrono::steady_clock::now();
+
+    auto offer = [&](const JobId& jobId, std::chrono::steady_clock::time_point now) {
+        if (!pool_->submit(jobId, scanner_->traits(jobId, costModel_.get()))) {
+            return false;
+        }
+        submittedJobs[jobId] = now;
+        return true;
+    };
 
     while (!shutdown_.load()) {
         try {
-            auto jobs = scanner_->scan();
-            int newCount = 0;
             auto now = std::chrono::steady_clock::now();
-            std::unordered_set<JobId> currentJobs(jobs.begin(), jobs.end());
+            if (now >= nextScan) {
+                // The scanner reports only arrivals and departures. Arrivals
+                // start unsubmitted; the pass below offers them and retries
+                // jobs that are still waiting after retryInterval, oldest
+                // first so each lane stays in submission order.
+                auto delta = scanner_->scanDelta();
+                int newCount = 0;
+                std::vector<JobId> due;
+                for (const auto& jobId : delta.removed) {
+                    submittedJobs.erase(jobId);
+                }
+                for (const auto& jobId : delta.added) {
+                    submittedJobs.emplace(jobId, now - retryInterval);
+                }
 
-            for (auto it = submittedJobs.begin(); it != submittedJobs.end();) {
-                if (currentJobs.find(it->first) == currentJobs.end()) {
-                    it = submittedJobs.erase(it);
-                } else {
+                for (auto it = submittedJobs.begin(); it != submittedJobs.end() && !shutdown_.load();) {
+                    // Watch arrivals already claimed before this scan are gone.
+                    if (!scanner_->listed(it->first)) {
+                        it = submittedJobs.erase(it);
+                        continue;
+                    }
+                    if ((now - it->second) >= retryInterval) {
+                        due.push_back(it->first);
+                    }
                     ++it;
                 }
-            }
-
-            for (const auto& jobId : jobs) {
-                if (shutdown_.load()) break;
-
-                auto it = submittedJobs.find(jobId);
-                if (it == submittedJobs.end() || (now - it->second) >= retryInterval) {
-                    if (pool_->submit(jobId)) {
-                        submittedJobs[jobId] = now;
+                std::sort(due.begin(), due.end());
+                for (const auto& jobId : due) {
+                    if (shutdown_.load()) break;
+                    if (offer(jobId, now)) {
                         newCount++;
                     }
                 }
-            }
 
-            if (newCount > 0) {
-                LOG_DEBUG("Submitted " + std::to_string(newCount) + " new jobs to pool");
+                if (newCount > 0) {
+                    LOG_DEBUG("Submitted " + std::to_string(newCount) + " new jobs to pool");
+                }
+                nextScan = now + scanInterval;
             }
 
-            auto sleepEnd = std::chrono::steady_clock::now() + scanInterval;
-            while (std::chrono::steady_clock::now() < sleepEnd && !shutdown_.load()) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            auto events = watcher_->wait(std::chrono::duration_cast<std::chrono::milliseconds>(
+                nextScan - std::chrono::steady_clock::now()));
+            if (events.rescan) {
+                nextScan = std::chrono::steady_clock::now();
+                continue;
+            }
+            now = std::chrono::steady_clock::now();
+            for (const auto& name : events.arrived) {
+                if (shutdown_.load()) break;
+                auto it = submittedJobs.find(name);
+                if (it != submittedJobs.end() && (now - it->second) < retryInterval) continue;
+                if (scanner_->isReady(name) && offer(name, now)) {
+                    LOG_TRACE("Submitted arriving job: " + name);
+                }
             }
 
         } catch (const std::exception& e) {
             LOG_ERROR("Scanner loop error: " + std::string(e.what()));
-            std::this_thread::sleep_for(scanInterval);
+            std::this_thread::sleep_for(pollInterval);
         } catch (...) {
             LOG_ERROR("Unknown scanner loop error");
-            std::this_thread::sleep_for(scanInterval);
+            std::this_thread::sleep_for(pollInterval);
         }
     }
 
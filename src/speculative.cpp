@@ -0,0 +1,128 @@
+/*
+ * nrvna - Speculative decoding drafters (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "speculative.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace nrvna {
+
+namespace {
+
+// Stop drafting once the draft model is this unsure of its next token.
+constexpr float kMinProbability = 0.5f;
+
+}
+
+NgramDrafter::NgramDrafter(size_t minNgram, size_t maxNgram) noexcept
+    : min_(std::max<size_t>(1, minNgram)), max_(std::max(maxNgram, std::max<size_t>(1, minNgram))) {}
+
+std::vector<llama_token> NgramDrafter::propose(const std::vector<llama_token>& history, size_t maxDraft) {
+    const size_t size = history.size();
+    for (size_t n = std::min(max_, size > 0 ? size - 1 : 0); n >= min_; --n) {
+        const llama_token* tail = history.data() + size - n;
+        // Latest match first: recent text predicts the continuation best.
+        for (size_t start = size - n; start-- > 0;) {
+            if (!std::equal(tail, tail + n, history.data() + start)) continue;
+            const size_t from = start + n;
+            const size_t count = std::min(maxDraft, size - from);
+            return {history.begin() + static_cast<std::ptrdiff_t>(from),
+                    history.begin() + static_cast<std::ptrdiff_t>(from + count)};
+        }
+    }
+    return {};
+}
+
+ModelDrafter::ModelDrafter(std::shared_ptr<llama_context> ctx) : ctx_(std::move(ctx)) {}
+
+bool vocabsCompatible(const llama_model* target, const llama_model* draft) {
+    const llama_vocab* a = llama_model_get_vocab(target);
+    const llama_vocab* b = llama_model_get_vocab(draft);
+    return llama_vocab_type(a) == llama_vocab_type(b) &&
+           llama_vocab_n_tokens(a) == llama_vocab_n_tokens(b) &&
+           llama_vocab_bos(a) == llama_vocab_bos(b) &&
+           llama_vocab_eos(a) == llama_vocab_eos(b);
+}
+
+bool ModelDrafter::greedy(llama_token& token) const {
+    const float* logits = llama_get_logits_ith(ctx_.get(), -1);
+    if (!logits) {
+        return false;
+    }
+    const int32_t n_vocab = llama_vocab_n_tokens(llama_model_get_vocab(llama_get_model(ctx_.get())));
+    const auto best = std::max_element(logits, logits + n_vocab);
+    double sum = 0.0;
+    for (int32_t i = 0; i < n_vocab; ++i) {
+        sum += std::exp(static_cast<double>(logits[i] - *best));
+    }
+    token = static_cast<llama_token>(best - logits);
+    return 1.0 / sum >= kMinProbability;
+}
+
+std::vector<llama_token> ModelDrafter::propose(const std::vector<llama_token>& history, size_t maxDraft) {
+    std::vector<llama_token> draft;
+    if (history.empty() || maxDraft == 0) {
+        return draft;
+    }
+
+    // Roll back to the common prefix; at least the last token is re-decoded
+    // so its logits are fresh.
+    size_t common = 0;
+    while (common < cached_.size() && common < history.size() && cached_[common] == history[common]) {
+        ++common;
+    }
+    common = std::min(common, history.size() - 1);
+    llama_memory_seq_rm(llama_get_memory(ctx_.get()), 0, static_cast<llama_pos>(common), -1);
+    cached_.resize(common);
+
+    const size_t n_ctx = llama_n_ctx(ctx_.get());
+    if (history.size() + maxDraft >= n_ctx) {
+        return draft;
+    }
+
+    const size_t n_batch = llama_n_batch(ctx_.get());
+    llama_batch batch = llama_batch_init(static_cast<int32_t>(std::max<size_t>(n_batch, 1)), 0, 1);
+    auto decode = [&](const llama_token* tokens, size_t count, size_t pos) {
+        for (size_t start = 0; start < count; start += n_batch) {
+            const size_t n = std::min(n_batch, count - start);
+            batch.n_tokens = 0;
+            for (size_t i = 0; i < n; ++i) {
+                const int k = batch.n_tokens++;
+                batch.token[k] = tokens[start + i];
+                batch.pos[k] = static_cast<llama_pos>(pos + start + i);
+                batch.n_seq_id[k] = 1;
+                batch.seq_id[k][0] = 0;
+                batch.logits[k] = start + i + 1 == count;
+            }
+            if (llama_decode(ctx_.get(), batch) != 0) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    bool ok = decode(history.data() + common, history.size() - common, common);
+    if (ok) {
+        cached_.assign(history.begin(), history.end());
+    }
+    llama_token token = 0;
+    while (ok && draft.size() < maxDraft && greedy(token)) {
+        draft.push_back(token);
+        if (draft.size() == maxDraft) break;
+        ok = decode(&token, 1, cached_.size());
+        if (ok) cached_.push_back(token);
+    }
+    llama_batch_free(batch);
+    if (!ok) {
+        // Leave the draft context empty so the next proposal starts clean.
+        llama_memory_seq_rm(llama_get_memory(ctx_.get()), 0, -1, -1);
+        cached_.clear();
+        return {};
+    }
+    return draft;
+}
+
+}
@@ -0,0 +1,63 @@
+/*
+ * nrvna - Speculative decoding drafters (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "llama.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace nrvna {
+
+// Proposes tokens that the target model then verifies in one batched decode.
+// history holds every token the drafter may condition on, ending with the
+// latest accepted token (which the target has not decoded yet).
+class Drafter {
+public:
+    virtual ~Drafter() = default;
+    [[nodiscard]] virtual std::vector<llama_token> propose(const std::vector<llama_token>& history,
+                                                           size_t maxDraft) = 0;
+};
+
+// Greedy proposals from a small draft model sharing the target's vocabulary.
+// The draft context keeps the tokens it has decoded and only rolls back to
+// the common prefix with the new history.
+class ModelDrafter final : public Drafter {
+public:
+    explicit ModelDrafter(std::shared_ptr<llama_context> ctx);
+
+    [[nodiscard]] std::vector<llama_token> propose(const std::vector<llama_token>& history,
+                                                   size_t maxDraft) override;
+
+private:
+    // Argmax of the last decoded logits; returns false below kMinProbability.
+    bool greedy(llama_token& token) const;
+
+    std::shared_ptr<llama_context> ctx_;
+    std::vector<llama_token> cached_;  // tokens in the draft KV memory
+};
+
+// Prompt lookup: find the latest earlier occurrence of the trailing n-gram
+// in the history (prompt and output so far) and propose what followed it.
+// Needs no model; pays off when the output copies spans of the input.
+class NgramDrafter final : public Drafter {
+public:
+    NgramDrafter(size_t minNgram, size_t maxNgram) noexcept;
+
+    [[nodiscard]] std::vector<llama_token> propose(const std::vector<llama_token>& history,
+                                                   size_t maxDraft) override;
+
+private:
+    size_t min_;
+    size_t max_;
+};
+
+// Same vocabulary means same token ids: compare sizes and special tokens.
+[[nodiscard]] bool vocabsCompatible(const llama_model* target, const llama_model* draft);
+
+}
@@ -0,0 +1,53 @@
+/*
+ * nrvna - Periodic flushing of generated text (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "nrvna/runner.hpp"
+#include "llama_util.hpp"
+#include <chrono>
+#include <string>
+
+namespace nrvna {
+
+// Batches generated pieces into TextSink calls: every NRVNA_STREAM_TOKENS
+// tokens or NRVNA_STREAM_MS milliseconds, whichever comes first. A null
+// sink makes every call a no-op.
+class TextStream {
+public:
+    explicit TextStream(TextSink sink)
+        : sink_(std::move(sink)),
+          tokens_(sink_ ? env_positive_int("NRVNA_STREAM_TOKENS", 16) : 0),
+          interval_(sink_ ? env_positive_int("NRVNA_STREAM_MS", 200) : 0),
+          last_(std::chrono::steady_clock::now()) {}
+
+    void append(const std::string& piece) {
+        if (!sink_) return;
+        pending_ += piece;
+        if (++count_ >= tokens_ ||
+            std::chrono::steady_clock::now() - last_ >= interval_) {
+            flush();
+        }
+    }
+
+    void flush() {
+        if (!sink_ || pending_.empty()) return;
+        sink_(pending_);
+        pending_.clear();
+        count_ = 0;
+        last_ = std::chrono::steady_clock::now();
+    }
+
+private:
+    TextSink sink_;
+    int tokens_;
+    std::chrono::milliseconds interval_;
+    std::chrono::steady_clock::time_point last_;
+    std::string pending_;
+    int count_ = 0;
+};
+
+}
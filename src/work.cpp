@@ -5,7 +5,10 @@
  */
 
 #include "nrvna/work.hpp"
+#include "nrvna/archive.hpp"
 #include "nrvna/contract.hpp"
+#include "nrvna/durability.hpp"
+#include "nrvna/job_index.hpp"
 #include "nrvna/meta.hpp"
 #include "nrvna/logger.hpp"
 #include <filesystem>
@@ -150,6 +153,19 @@ SubmitResult Work::submit(const std::string& prompt, JobType type, const std::ve
     if (!validStructuredOutput) {
         return {false, "", SubmissionError::InvalidContent, "Invalid structured output options"};
     }
+    if (!opts.speculate.empty() &&
+        (!contract::isValidSpeculation(opts.speculate) || (type != JobType::Text && type != JobType::Vision))) {
+        return {false, "", SubmissionError::InvalidContent, "Invalid speculation option"};
+    }
+    if (opts.continuation && type != JobType::Text) {
+        return {false, "", SubmissionError::InvalidContent, "Continuation requires a text job"};
+    }
+    if (!(opts.timeout_s >= 0.0)) {
+        return {false, "", SubmissionError::InvalidContent, "Invalid timeout"};
+    }
+    if (!opts.priority.empty() && !contract::isValidPriority(opts.priority)) {
+        return {false, "", SubmissionError::InvalidContent, "Invalid priority"};
+    }
 
     const bool allowEmptyPrompt = type == JobType::Embed && !imagePaths.empty();
     if ((!allowEmptyPrompt && !isValidPrompt(prompt)) || (allowEmptyPrompt && prompt.size() > maxBytes_)) {
@@ -235,6 +251,18 @@ SubmitResult Work::submitAudio(const std::string& prompt, const std::vector<std:
     if (!opts.output_format.empty() || !opts.schema.empty() || !opts.grammar.empty()) {
         return {false, "", SubmissionError::InvalidContent, "Structured output is not supported for audio jobs"};
     }
+    if (!opts.speculate.empty()) {
+        return {false, "", SubmissionError::InvalidContent, "Speculation is not supported for audio jobs"};
+    }
+    if (opts.continuation) {
+        return {false, "", SubmissionError::InvalidContent, "Continuation requires a text job"};
+    }
+    if (!(opts.timeout_s >= 0.0)) {
+        return {false, "", SubmissionError::InvalidContent, "Invalid timeout"};
+    }
+    if (!opts.priority.empty() && !contract::isValidPriority(opts.priority)) {
+        return {false, "", SubmissionError::InvalidContent, "Invalid priority"};
+    }
     if (prompt.size() > maxBytes_) {
         LOG_DEBUG("Prompt exceeds size limit: " + std::to_string(prompt.size()) + " > " + std::to_string(maxBytes_));
         return {false, "", SubmissionError::InvalidSize, "Prompt exceeds maximum size limit (" + std::to_string(maxBytes_) + " bytes)"};
@@ -295,6 +323,44 @@ SubmitResult Work::submitAudio(const std::string& prompt, const std::vector<std:
     return {true, jobId, SubmissionError::None, ""};
 }
 
+Status Work::cancel(const JobId& id) const noexcept {
+    if (!contract::isValidJobId(id)) {
+        return Status::Missing;
+    }
+    try {
+        // A worker can claim or finish the job between the checks. A file
+        // written before a rename moves with the directory; a failed open
+        // means the directory moved, so the lookup is repeated.
+        constexpr int kAttempts = 3;
+        for (int attempt = 0; attempt < kAttempts; ++attempt) {
+            for (Status state : {Status::Queued, Status::Running}) {
+                auto dir = contract::jobDir(workspace_, state, id);
+                if (!std::filesystem::is_directory(dir)) continue;
+                std::ofstream file(dir / contract::kCancelFile, std::ios::binary);
+                if (!file) continue;
+                file << formatTimestamp() << '\n';
+                file.flush();
+                if (file.good()) {
+                    LOG_INFO("Cancel requested: " + id);
+                    return state;
+                }
+            }
+            for (Status state : {Status::Done, Status::Failed}) {
+                if (std::filesystem::is_directory(contract::jobDir(workspace_, state, id))) {
+                    return state;
+                }
+            }
+        }
+        Archive archive(workspace_);
+        archive.refresh();
+        if (archive.contains(id)) {
+            return Status::Done;
+        }
+    } catch (...) {
+    }
+    return Status::Missing;
+}
+
 bool Work::createWorkspace(bool createIfMissing) noexcept {
     try {
         if (!std::filesystem::exists(workspace_)) {
@@ -472,6 +538,12 @@ bool Work::writeMetaFile(const JobId& jobId, JobType type, const SubmitOptions&
         meta.mode = contract::toString(type);
         meta.parent = opts.parent;
         meta.output_format = opts.output_format;
+        meta.speculate = opts.speculate;
+        meta.continuation = opts.continuation;
+        meta.timeout_s = opts.timeout_s;
+        if (opts.priority != "normal") {
+            meta.priority = opts.priority;
+        }
         for (const auto& tag : opts.tags) {
             if (isValidTag(tag)) {
                 meta.tags.push_back(tag);
@@ -490,7 +562,18 @@ bool Work::atomicPublish(const JobId& jobId) const noexcept {
         auto writingPath = workspace_ / contract::kWritingDir / jobId;
         auto readyPath = workspace_ / contract::kReadyDir / jobId;
 
+        // A job reported as submitted must survive a power loss in the
+        // configured durability mode.
+        auto& syncer = Syncer::shared();
+        if (!syncer.beforeRename(writingPath)) {
+            return false;
+        }
         std::filesystem::rename(writingPath, readyPath);
+        if (!syncer.afterRename(writingPath, readyPath)) {
+            // Already visible to the daemon, so it stays submitted.
+            LOG_WARN("Job published but not synced: " + jobId);
+        }
+        journal::append(workspace_, jobId, Status::Queued, readMetaJson(readyPath));
         return true;
     } catch (...) {
         return false;
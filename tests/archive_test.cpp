@@ -0,0 +1,95 @@
+#include "nrvna/archive.hpp"
+#include "nrvna/contract.hpp"
+#include "nrvna/flow.hpp"
+#include "nrvna/meta.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+using namespace nrvna;
+namespace fs = std::filesystem;
+
+namespace {
+
+void writeJob(const fs::path& ws, const JobId& id, const std::string& result) {
+    const auto dir = contract::jobDir(ws, Status::Done, id);
+    fs::create_directories(dir / contract::kImagesDir);
+    std::ofstream(dir / contract::kPromptFile) << "prompt " << id;
+    std::ofstream(dir / contract::kResultFile) << result;
+    std::ofstream(dir / contract::kImagesDir / "0.png", std::ios::binary) << std::string("p\0n\tg\n", 6);
+    JobMeta meta;
+    meta.submitted_at = formatTimestamp();
+    meta.mode = "vision";
+    meta.tags = {"nightly"};
+    meta.status = contract::toString(Status::Done);
+    writeMetaJson(dir, meta);
+}
+
+}
+
+int main() {
+    auto ws = fs::temp_directory_path() / "nrvna_archive_test";
+    fs::remove_all(ws);
+    for (Status s : {Status::Queued, Status::Running, Status::Done, Status::Failed}) {
+        fs::create_directories(contract::stateDir(ws, s));
+    }
+    writeJob(ws, "1_1_1", "first\n");
+    writeJob(ws, "2_1_1", "second");
+    writeJob(ws, "3_1_1", "third");
+    std::ofstream(contract::jobDir(ws, Status::Done, "3_1_1") / contract::kAudioFile) << "wav";
+
+    Flow flow(ws);
+    auto before = flow.get("1_1_1");
+    if (!before || before->content != "first") return 1;
+
+    // Old jobs move into segments; audio jobs stay directories.
+    Compactor compactor(ws, std::chrono::seconds(0), 1);
+    if (compactor.compact() != 2) return 2;
+    if (fs::exists(contract::jobDir(ws, Status::Done, "1_1_1")) ||
+        !fs::exists(contract::jobDir(ws, Status::Done, "3_1_1"))) return 3;
+
+    Archive archive(ws);
+    if (!archive.refresh() || archive.size() != 2 || !archive.contains("2_1_1")) return 4;
+    const auto files = archive.files("2_1_1");
+    if (files.size() != 4 || files.front() != "images/0.png") return 5;
+    if (archive.readFile("2_1_1", "images/0.png") != std::string("p\0n\tg\n", 6)) return 6;
+    if (archive.readFile("2_1_1", contract::kResultFile) != std::string("second")) return 7;
+    if (archive.readFile("2_1_1", "missing.txt")) return 8;
+    // A segment holds at least one record; past the limit the next starts.
+    if (!fs::exists(ws / contract::kArchiveDir / ("000002" + std::string(contract::kSegmentExtension)))) return 9;
+
+    // Flow reads archived jobs as it reads directories.
+    if (flow.status("1_1_1") != Status::Done) return 10;
+    auto after = flow.get("1_1_1");
+    if (!after || after->status != Status::Done || after->content != before->content) return 11;
+    auto meta = flow.meta("2_1_1");
+    if (!meta || meta->tags != std::vector<std::string>{"nightly"}) return 12;
+    auto artifact = flow.artifact("2_1_1");
+    if (!artifact || artifact->kind != contract::ArtifactKind::Result || !artifact->path.empty()) return 13;
+    if (flow.select("nightly", "").size() != 3 || flow.counts().done != 3) return 14;
+
+    // A directory left behind by an interrupted pass is removed, not packed twice.
+    writeJob(ws, "2_1_1", "second");
+    if (archive.pack({"2_1_1"}, 1) != 0 || fs::exists(contract::jobDir(ws, Status::Done, "2_1_1"))) return 15;
+    archive.refresh();
+    if (archive.size() != 2) return 16;
+
+    // Removing most of a sealed segment moves the rest to a new one.
+    const std::vector<JobId> batch{"4_1_1", "5_1_1", "6_1_1", "7_1_1", "8_1_1"};
+    for (const auto& id : batch) writeJob(ws, id, "kept " + id);
+    if (archive.pack(batch, 1 << 20) != 5) return 17;
+    writeJob(ws, "9_1_1", "ninth");
+    if (archive.pack({"9_1_1"}, 1) != 1) return 18;
+    const auto keptTime = archive.time("8_1_1");
+    const auto freed = archive.remove({"2_1_1", "4_1_1", "5_1_1", "6_1_1", "7_1_1"});
+    if (freed.bytes == 0 || freed.inodes != 0 ||
+        fs::exists(ws / contract::kArchiveDir / ("000002" + std::string(contract::kSegmentExtension)))) return 19;
+    Archive reopened(ws);
+    reopened.refresh();
+    if (reopened.size() != 3 || reopened.time("8_1_1") != keptTime ||
+        reopened.readFile("8_1_1", contract::kResultFile) != std::string("kept 8_1_1")) return 20;
+
+    fs::remove_all(ws);
+    std::puts("archive_test: all checks passed");
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include "nrvna/durability.hpp"
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace nrvna;
+namespace fs = std::filesystem;
+
+int main() {
+    if (parseDurability("") != Durability::None || parseDurability("none") != Durability::None) return 1;
+    if (parseDurability("rename") != Durability::Rename || parseDurability("full") != Durability::Full) return 2;
+    if (parseDurability("always")) return 3;
+
+    auto ws = fs::temp_directory_path() / "nrvna_durability_test";
+    fs::remove_all(ws);
+    fs::create_directories(ws / "writing" / "job" / "images");
+    fs::create_directories(ws / "ready");
+    std::ofstream(ws / "writing" / "job" / "prompt.txt") << "hello";
+    std::ofstream(ws / "writing" / "job" / "images" / "a.png") << "png";
+
+    // A job is synced before and after its rename; missing paths fail.
+    Syncer full(Durability::Full);
+    if (!full.beforeRename(ws / "writing" / "job")) return 4;
+    fs::rename(ws / "writing" / "job", ws / "ready" / "job");
+    if (!full.afterRename(ws / "writing" / "job", ws / "ready" / "job")) return 5;
+    if (full.sync({ws / "missing"})) return 6;
+    if (full.beforeRename(ws / "missing")) return 7;
+
+    // Concurrent callers share passes. The sync thread is held in open() on
+    // a FIFO, which cannot be fsynced, until every caller has queued.
+    const auto fifo = ws / "hold";
+    if (::mkfifo(fifo.c_str(), 0600) != 0) return 14;
+    const uint64_t before = full.passes();
+    bool held = true;
+    std::thread holder([&] { held = full.sync({fifo}); });
+    std::vector<std::thread> callers;
+    std::vector<char> ok(32, 0);
+    for (std::size_t i = 0; i < ok.size(); ++i) {
+        callers.emplace_back([&, i] { ok[i] = full.sync({ws / "ready", ws / "ready" / "job"}); });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    const int writer = ::open(fifo.c_str(), O_WRONLY);
+    holder.join();
+    for (auto& caller : callers) caller.join();
+    if (writer >= 0) ::close(writer);
+    if (writer < 0 || held) return 15;
+    for (char result : ok) {
+        if (!result) return 8;
+    }
+    const uint64_t passes = full.passes() - before;
+    if (passes == 0 || passes >= ok.size()) return 9;
+
+    // Lighter modes skip what they do not promise.
+    Syncer none(Durability::None);
+    if (!none.beforeRename(ws / "missing") || !none.afterRename(ws / "a" / "x", ws / "b" / "x")) return 10;
+    Syncer rename(Durability::Rename);
+    if (!rename.beforeRename(ws / "missing") || rename.passes() != 0) return 11;
+    if (!rename.afterRename(ws / "writing" / "job", ws / "ready" / "job") || rename.passes() != 1) return 12;
+
+    // After stop the caller syncs itself.
+    full.stop();
+    if (!full.sync({ws / "ready"})) return 13;
+
+    fs::remove_all(ws);
+    std::puts("durability_test: all checks passed");
+    return 0;
+}
@@ -0,0 +1,46 @@
+#include "nrvna/job_control.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+using namespace nrvna;
+namespace fs = std::filesystem;
+
+int main() {
+    auto dir = fs::temp_directory_path() / "nrvna_job_control_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    const auto cancelFile = dir / "cancel";
+
+    // No deadline and no cancel file: the job runs.
+    JobControl idle(cancelFile, 0.0);
+    if (idle.stopRequested() || JobControl::abortCallback(&idle)) return 1;
+    if (JobControl::abortCallback(nullptr)) return 2;
+
+    // A deadline expires, says so, and stays expired.
+    JobControl timed(cancelFile, 0.05);
+    if (timed.stopRequested()) return 3;
+    std::this_thread::sleep_for(std::chrono::milliseconds(80));
+    if (!timed.stopRequested() || !JobControl::abortCallback(&timed)) return 4;
+    if (timed.reason() != "Job exceeded its 0.05s deadline") return 5;
+
+    // The cancel file is looked at most once per 50ms.
+    JobControl cancelled(cancelFile, 0.0);
+    if (cancelled.stopRequested()) return 6;
+    std::ofstream(cancelFile).put('\n');
+    if (cancelled.stopRequested()) return 7;
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    if (!cancelled.stopRequested()) return 8;
+    fs::remove(cancelFile);
+    if (!cancelled.stopRequested() || cancelled.reason() != "Job cancelled") return 9;
+
+    // Cancellation wins over a deadline that has not passed.
+    std::ofstream(cancelFile).put('\n');
+    JobControl both(cancelFile, 60.0);
+    if (!both.stopRequested() || both.reason() != "Job cancelled") return 10;
+
+    fs::remove_all(dir);
+    std::puts("job_control_test: all checks passed");
+    return 0;
+}
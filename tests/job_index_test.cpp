@@ -0,0 +1,101 @@
+#include "nrvna/contract.hpp"
+#include "nrvna/flow.hpp"
+#include "nrvna/job_index.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+using namespace nrvna;
+namespace fs = std::filesystem;
+
+int main() {
+    // Lines round-trip; damaged ones are rejected.
+    JournalRecord record{"100_1_1", Status::Done, 42, "99_1_1", {"nightly", "a-b"}};
+    auto parsed = journal::parse(journal::format(record).substr(0, journal::format(record).size() - 1));
+    if (!parsed || parsed->id != record.id || parsed->state != Status::Done || parsed->time_us != 42 ||
+        parsed->parent != "99_1_1" || parsed->tags != record.tags) return 1;
+    if (journal::parse("42\tdone\tnot-an-id\t\t") || journal::parse("x\tdone\t1_1_1\t\t") ||
+        journal::parse("42\tdone\t1_1_1\t")) return 2;
+
+    auto ws = fs::temp_directory_path() / "nrvna_job_index_test";
+    fs::remove_all(ws);
+    for (Status s : {Status::Queued, Status::Running, Status::Done, Status::Failed}) {
+        fs::create_directories(contract::stateDir(ws, s));
+    }
+
+    // Transitions keep tags and parent; terminal states are final.
+    JobMeta meta;
+    meta.tags = {"nightly"};
+    meta.parent = "1_1_1";
+    if (!journal::append(ws, "2_1_1", Status::Queued, meta)) return 3;
+    journal::append(ws, "2_1_1", Status::Running);
+    journal::append(ws, "2_1_1", Status::Done);
+    journal::append(ws, "2_1_1", Status::Queued);  // a submitter's late line
+    journal::append(ws, "3_1_1", Status::Queued, meta);
+
+    JobIndex index(ws);
+    if (index.load()) return 4;  // no snapshot yet
+    if (!index.refresh() || index.size() != 2) return 5;
+    const auto* entry = index.find("2_1_1");
+    if (!entry || entry->state != Status::Done || entry->tags != meta.tags || entry->parent != "1_1_1") return 6;
+    if (index.tagged("nightly").size() != 2 || index.children("1_1_1").size() != 2) return 7;
+    if (index.count(Status::Done) != 1 || index.count(Status::Queued) != 1) return 8;
+    if (index.recent(1) != std::vector<JobId>{"3_1_1"}) return 9;
+
+    // A snapshot plus the journal after it restores the same index.
+    if (!index.save(0)) return 10;
+    journal::append(ws, "3_1_1", Status::Failed);
+    JobIndex reader(ws);
+    if (!reader.load() || reader.size() != 2 || reader.count(Status::Failed) != 1) return 11;
+    journal::append(ws, "4_1_1", Status::Queued);
+    if (!reader.refresh() || !reader.find("4_1_1") || reader.refresh()) return 12;
+
+    // A partial line waits for its newline.
+    std::ofstream(ws / contract::kJournalFile, std::ios::app) << "5\tqueued\t5_1_";
+    if (reader.refresh() || reader.find("5_1_1")) return 13;
+    std::ofstream(ws / contract::kJournalFile, std::ios::app) << "1\t\t\n";
+    if (!reader.refresh() || !reader.find("5_1_1")) return 14;
+
+    // Past the size limit the journal is folded into the snapshot.
+    index.refresh();
+    if (!index.save(1) || fs::exists(ws / contract::kJournalFile) || fs::exists(ws / contract::kRotatedJournalFile)) return 15;
+    journal::append(ws, "6_1_1", Status::Queued);
+    if (!reader.refresh() || reader.size() != 5) return 16;
+    JobIndex fresh(ws);
+    if (!fresh.load() || fresh.size() != 5 || fresh.find("3_1_1")->state != Status::Failed) return 17;
+
+    // Removal drops the job from every view.
+    journal::append(ws, "2_1_1", Status::Missing);
+    if (!fresh.refresh() || fresh.find("2_1_1") || fresh.tagged("nightly").size() != 1 ||
+        fresh.count(Status::Done) != 0) return 18;
+
+    // A rebuild reads the state directories and meta.json.
+    fs::create_directories(contract::jobDir(ws, Status::Done, "7_1_1"));
+    meta.tags = {"rebuilt"};
+    meta.submitted_at = formatTimestamp();
+    meta.mode = "text";
+    if (!writeMetaJson(contract::jobDir(ws, Status::Done, "7_1_1"), meta)) return 19;
+    JobIndex rebuilt(ws);
+    rebuilt.rebuild();
+    if (rebuilt.size() != 1 || rebuilt.tagged("rebuilt") != std::vector<JobId>{"7_1_1"}) return 20;
+
+    // Flow reads queued jobs the journal has not seen yet, and drops jobs
+    // deleted by hand while the index still holds them.
+    if (!rebuilt.save(1 << 20)) return 21;
+    fs::create_directories(contract::jobDir(ws, Status::Queued, "8_1_1"));
+    if (!writeMetaJson(contract::jobDir(ws, Status::Queued, "8_1_1"), meta)) return 22;
+    Flow flow(ws);
+    auto set = flow.select("rebuilt", "");
+    if (set.size() != 2 || set[0].id != "7_1_1" || set[0].status != Status::Done ||
+        set[1].id != "8_1_1" || set[1].status != Status::Queued) return 23;
+    fs::remove_all(contract::jobDir(ws, Status::Done, "7_1_1"));
+    set = flow.select("rebuilt", "");
+    if (set.size() != 1 || set[0].id != "8_1_1") return 24;
+    for (const auto& job : flow.list(10)) {
+        if (job.id == "7_1_1") return 25;
+    }
+
+    fs::remove_all(ws);
+    std::puts("job_index_test: all checks passed");
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include "nrvna/hash.hpp"
+#include "nrvna/media_cache.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+using namespace nrvna;
+namespace fs = std::filesystem;
+
+int main() {
+    auto dir = fs::temp_directory_path() / "nrvna_media_cache_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    // Keys follow file content, not path, and differ per chunk of a file.
+    std::ofstream(dir / "a.png") << "same bytes";
+    std::ofstream(dir / "b.png") << "same bytes";
+    std::ofstream(dir / "c.png") << "other bytes";
+    const auto a = MediaCache::hashFile(dir / "a.png");
+    if (a != sha256Hex("same bytes") || a != MediaCache::hashFile(dir / "b.png")) return 1;
+    if (a == MediaCache::hashFile(dir / "c.png")) return 2;
+    if (!MediaCache::hashFile(dir / "missing.png").empty()) return 3;
+    if (MediaCache::chunkKey(a, 0) == MediaCache::chunkKey(a, 1)) return 4;
+
+    // A remembered hash follows the file through a rename, as when a job
+    // is claimed, and is recomputed once the file changes.
+    MediaCache remembered(0);
+    if (remembered.contentHash(dir / "a.png") != a) return 18;
+    fs::rename(dir / "a.png", dir / "moved.png");
+    if (remembered.contentHash(dir / "moved.png") != a) return 19;
+    std::ofstream(dir / "moved.png") << "new bytes, new size";
+    if (remembered.contentHash(dir / "moved.png") == a) return 20;
+
+    auto key = [](char c) { return MediaCache::chunkKey(std::string(64, c), 0); };
+
+    // Two 16-byte entries fit; a third evicts the least recently used.
+    MediaCache cache(32);
+    if (cache.lookup(key('1'), 4) != nullptr) return 5;
+    if (!cache.insert(key('1'), {1, 2, 3, 4}) || !cache.insert(key('2'), {5, 6, 7, 8})) return 6;
+    auto hit = cache.lookup(key('1'), 4);
+    if (!hit || (*hit)[3] != 4) return 7;
+    if (cache.lookup(key('1'), 5) != nullptr) return 8;  // shape changed, such as another token budget
+    if (!cache.insert(key('3'), {9, 9, 9, 9})) return 9;
+    if (cache.size() != 2 || cache.bytes() > cache.budget()) return 10;
+    if (!cache.lookup(key('1'), 4) || cache.lookup(key('2'), 4)) return 11;
+    if (cache.insert(key('4'), std::vector<float>(16, 0.0f))) return 12;
+    if (cache.insert("../escape-0", {1}) || cache.insert(std::string(64, 'g') + "-0", {1})) return 21;
+
+    // Spilled entries are found by a fresh cache (a restart).
+    const auto spill = dir / "spill";
+    {
+        MediaCache warm(32);
+        warm.attachDirectory(spill, 1024);
+        if (!warm.insert(key('7'), {0.5f, 0.25f})) return 13;
+    }
+    {
+        MediaCache cold(32);
+        cold.attachDirectory(spill, 1024);
+        hit = cold.lookup(key('7'), 2);
+        if (!hit || (*hit)[1] != 0.25f || cold.size() != 1) return 14;
+        if (cold.lookup(key('7'), 3) != nullptr) return 15;
+    }
+    {
+        // A file holding another key is not trusted, whatever its name.
+        fs::copy_file(spill / (key('7') + ".emb"), spill / (key('9') + ".emb"));
+        MediaCache cold(32);
+        cold.attachDirectory(spill, 1024);
+        if (cold.lookup(key('9'), 2) != nullptr || !cold.lookup(key('7'), 2)) return 22;
+        fs::remove(spill / (key('9') + ".emb"));
+    }
+    {
+        // Oldest files go first once the disk budget is exceeded.
+        MediaCache small(1024);
+        small.attachDirectory(spill, 128);
+        if (!small.insert(key('8'), std::vector<float>(4, 1.0f))) return 16;
+        small.flush();
+        MediaCache cold(1024);
+        cold.attachDirectory(spill, 128);
+        if (cold.lookup(key('7'), 2) != nullptr || cold.lookup(key('8'), 4) == nullptr) return 17;
+    }
+    fs::remove_all(dir);
+
+    std::puts("media_cache_test: all checks passed");
+    return 0;
+}
@@ -34,20 +34,30 @@ int main() {
     in.parent = "123_456";
     in.tags = {"night", "quote\"slash\\line\n", "caf\u00e9"};
     in.output_format = "json_schema";
+    in.speculate = "ngram";
+    in.continuation = true;
+    in.timeout_s = 90.0;
+    in.priority = "low";
     in.recovery_attempts = 2;
     in.completed_at = "2026-07-11T00:00:01.000000Z";
     in.duration_s = 1.234;
     in.artifacts = {"result.txt"};
     in.status = "done";
+    in.metrics = {{"setup_s", 0.01234}};
+    in.cached_from = "122_456";
 
     if (!writeMetaJson(dir, in)) return 1;
     auto out = readMetaJson(dir);
     if (!out || out->submitted_at != in.submitted_at || out->mode != in.mode ||
         out->parent != in.parent || out->tags != in.tags ||
-        out->output_format != in.output_format ||
+        out->output_format != in.output_format || out->speculate != in.speculate ||
+        out->continuation != in.continuation || out->timeout_s != in.timeout_s ||
+        out->priority != in.priority ||
         out->recovery_attempts != in.recovery_attempts ||
         out->completed_at != in.completed_at || out->duration_s != 1.23 ||
-        out->artifacts != in.artifacts || out->status != in.status) return 2;
+        out->artifacts != in.artifacts || out->status != in.status ||
+        out->metrics.size() != 1 || out->metrics.at("setup_s") != 0.0123 ||
+        out->cached_from != in.cached_from) return 2;
 
     JobMeta minimal;
     minimal.submitted_at = in.submitted_at;
@@ -61,9 +71,13 @@ int main() {
 
     auto minimalOut = readMetaJson(dir);
     if (!minimalOut || !minimalOut->parent.empty() || !minimalOut->tags.empty() ||
-        !minimalOut->output_format.empty() || minimalOut->recovery_attempts != 0 ||
+        !minimalOut->output_format.empty() || !minimalOut->speculate.empty() ||
+        minimalOut->continuation || minimalOut->timeout_s != 0.0 ||
+        !minimalOut->priority.empty() ||
+        minimalOut->recovery_attempts != 0 ||
         !minimalOut->completed_at.empty() || minimalOut->duration_s != -1.0 ||
-        !minimalOut->artifacts.empty() || !minimalOut->status.empty()) return 5;
+        !minimalOut->artifacts.empty() || !minimalOut->status.empty() ||
+        !minimalOut->metrics.empty() || !minimalOut->cached_from.empty()) return 5;
 
     if (!writeText(dir / "meta.json",
                    R"({"submitted_at":"time","mode":"text","future":{"value":1}})")) return 6;
@@ -82,6 +96,8 @@ int main() {
     if (!rejects(dir, R"({"submitted_at":"time","mode":"text","duration_s":"fast"})")) return 16;
     if (!rejects(dir, R"({"submitted_at":"time","mode":"text","artifacts":[1]})")) return 17;
     if (!rejects(dir, R"(["not","metadata"])")) return 18;
+    if (!rejects(dir, R"({"submitted_at":"time","mode":"text","metrics":[1]})")) return 19;
+    if (!rejects(dir, R"({"submitted_at":"time","mode":"text","metrics":{"setup_s":"fast"}})")) return 20;
 
     fs::remove_all(dir);
     std::puts("meta_test: all checks passed");
@@ -0,0 +1,102 @@
+#include "nrvna/prefetcher.hpp"
+#include "nrvna/processor.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <mutex>
+#include <set>
+#include <thread>
+
+using namespace nrvna;
+
+namespace {
+
+// Polls until done() holds, for up to two seconds.
+template <typename Done>
+bool waitFor(Done done) {
+    for (int i = 0; i < 400 && !done(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return done();
+}
+
+}
+
+int main() {
+    std::atomic<int> loads{0};
+    std::mutex seenMutex;
+    std::set<JobId> seen;
+    std::atomic<bool> entered{false};
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+    std::atomic<bool> holding{false};
+    std::promise<void> hold;
+    std::shared_future<void> released = hold.get_future().share();
+
+    Prefetcher prefetcher(
+        [&](const JobId& id) -> std::shared_ptr<const JobInputs> {
+            if (id.rfind("slow", 0) == 0) {
+                entered = true;
+                opened.wait();
+            }
+            if (id.rfind("hold", 0) == 0) {
+                holding = true;
+                released.wait();
+            }
+            {
+                std::lock_guard<std::mutex> lock(seenMutex);
+                seen.insert(id);
+            }
+            ++loads;
+            if (id.rfind("skip", 0) == 0) return nullptr;  // not readable ahead
+            auto inputs = std::make_shared<JobInputs>();
+            inputs->prompt = {true, id, ""};
+            return inputs;
+        },
+        2);
+    if (prefetcher.take("1_1_1") != nullptr) return 1;
+    if (!prefetcher.start()) return 2;
+
+    // Hinted jobs are loaded once and handed to the first taker.
+    prefetcher.hint({"1_1_1", "2_1_1"});
+    if (!waitFor([&] { return prefetcher.size() == 2; })) return 3;
+    prefetcher.hint({"1_1_1"});
+    auto inputs = prefetcher.take("1_1_1");
+    if (!inputs || inputs->prompt.content != "1_1_1" || prefetcher.take("1_1_1") != nullptr) return 4;
+    if (prefetcher.size() != 1 || loads != 2) return 5;
+
+    // Past capacity the oldest loaded job is dropped. A load the thread
+    // starts after another proves that one was stored.
+    prefetcher.hint({"3_1_1", "4_1_1"});
+    if (!waitFor([&] { return loads == 4; })) return 6;
+    prefetcher.hint({"skip_1"});
+    if (!waitFor([&] { return loads == 5; })) return 7;
+    if (prefetcher.size() != 2 || prefetcher.take("2_1_1") != nullptr) return 8;
+    inputs = prefetcher.take("4_1_1");
+    if (!inputs || inputs->prompt.content != "4_1_1") return 9;
+
+    // A job taken while it loads is left to the worker, and its load is dropped.
+    prefetcher.hint({"slow_1"});
+    if (!waitFor([&] { return entered.load(); })) return 10;
+    if (prefetcher.take("slow_1") != nullptr) return 11;
+    gate.set_value();
+    prefetcher.hint({"skip_2"});
+    if (!waitFor([&] { return loads == 7; })) return 12;
+    if (prefetcher.size() != 1 || prefetcher.take("slow_1") != nullptr) return 13;
+
+    // stop() waits for the load in progress, drops what is still queued,
+    // and ignores later hints.
+    prefetcher.hint({"hold_1", "5_1_1"});
+    if (!waitFor([&] { return holding.load(); })) return 14;
+    std::thread stopper([&] { prefetcher.stop(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    hold.set_value();
+    stopper.join();
+    prefetcher.hint({"6_1_1"});
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    if (loads != 8 || seen.count("5_1_1") > 0 || seen.count("6_1_1") > 0) return 15;
+
+    std::puts("prefetcher_test: all checks passed");
+    return 0;
+}
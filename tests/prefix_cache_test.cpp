@@ -0,0 +1,81 @@
+#include "nrvna/kv_store.hpp"
+#include "nrvna/prefix_cache.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+using namespace nrvna;
+namespace fs = std::filesystem;
+
+int main() {
+    const std::vector<int32_t> prompt = {1, 2, 3, 4, 5, 6, 7, 8};
+    PrefixCache cache(96);
+
+    if (cache.lookup(prompt, {2, 4}) != nullptr) return 1;
+    if (!cache.insert({1, 2}, std::vector<uint8_t>(8, 0xa))) return 2;
+    if (!cache.insert({1, 2, 3, 4}, std::vector<uint8_t>(8, 0xb))) return 3;
+
+    // Longest matching candidate wins; lengths outside the prompt are ignored.
+    auto hit = cache.lookup(prompt, {2, 4, 100});
+    if (!hit || hit->tokens.size() != 4 || hit->state.front() != 0xb) return 4;
+    hit = cache.lookup(prompt, {2, 3});
+    if (!hit || hit->tokens.size() != 2) return 5;
+    if (cache.lookup({1, 2, 9, 9}, {4}) != nullptr) return 6;
+    if (!cache.contains(prompt, 4) || cache.contains(prompt, 3)) return 7;
+
+    // Entries over budget are evicted least-recently-used; pinned entries stay.
+    if (!cache.insert({9}, std::vector<uint8_t>(40, 0), true)) return 8;
+    if (!cache.insert({1, 2, 3, 4, 5, 6}, std::vector<uint8_t>(8, 0xc))) return 9;
+    if (cache.bytes() > cache.budget()) return 10;
+    if (!cache.contains({9}, 1) || !cache.contains(prompt, 6)) return 11;
+    if (cache.contains(prompt, 4)) return 12;
+    if (cache.insert({7}, std::vector<uint8_t>(128, 0))) return 13;
+
+    if (cache.noteSighting(prompt, 4) != 1 || cache.noteSighting(prompt, 4) != 2) return 14;
+    if (cache.noteSighting(prompt, 0) != 0) return 15;
+
+    // Snapshots written through to disk are found by a fresh cache (a restart).
+    auto dir = fs::temp_directory_path() / "nrvna_prefix_cache_test";
+    fs::remove_all(dir);
+    {
+        // Writes happen on the store's thread; a queued one is still found.
+        PrefixCache warm(96);
+        auto store = std::make_shared<KvSnapshotStore>(dir, 1024);
+        warm.attachStore(store);
+        if (!warm.insert({1, 2, 3, 4}, std::vector<uint8_t>(8, 0xd))) return 16;
+        if (!store->contains(PrefixCache::hashTokens(prompt.data(), 4))) return 22;
+        store->flush();
+        if (fs::is_empty(dir)) return 23;
+    }
+    {
+        PrefixCache cold(96);
+        cold.attachStore(std::make_shared<KvSnapshotStore>(dir, 1024));
+        if (!cold.contains(prompt, 4) || cold.size() != 0) return 17;
+        hit = cold.lookup(prompt, {2, 4});
+        if (!hit || hit->tokens.size() != 4 || hit->state.back() != 0xd || cold.size() != 1) return 18;
+        if (cold.lookup({1, 2, 3, 9}, {4}) != nullptr) return 19;
+    }
+    {
+        // Oldest snapshots go first once the disk budget is exceeded.
+        KvSnapshotStore small(dir, 90);
+        PrefixEntry entry;
+        entry.tokens = {5, 6};
+        entry.state = std::vector<uint8_t>(40, 1);
+        if (!small.save(PrefixCache::hashTokens(entry.tokens.data(), 2), entry)) return 20;
+        if (small.contains(PrefixCache::hashTokens(prompt.data(), 4))) return 21;
+    }
+    {
+        // Conversation state files record the model that produced them.
+        PrefixEntry entry;
+        entry.tokens = {1, 2};
+        entry.state = std::vector<uint8_t>(4, 2);
+        entry.model = "0123456789abcdef";
+        if (!KvSnapshotStore::writeFile(dir / "state.kv", entry)) return 24;
+        auto read = KvSnapshotStore::readFile(dir / "state.kv", true);
+        if (!read || read->model != entry.model || read->tokens != entry.tokens || !read->state.empty()) return 25;
+    }
+    fs::remove_all(dir);
+
+    std::puts("prefix_cache_test: all checks passed");
+    return 0;
+}
@@ -0,0 +1,49 @@
+#include "nrvna/hash.hpp"
+#include "nrvna/result_cache.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+using namespace nrvna;
+namespace fs = std::filesystem;
+
+int main() {
+    auto dir = fs::temp_directory_path() / "nrvna_result_cache_test";
+    fs::remove_all(dir);
+
+    if (fnv1a("a", 1) == fnv1a("b", 1) || hex64(0xab) != "00000000000000ab") return 1;
+
+    // Entries round-trip; another key misses.
+    ResultCache cache(dir, 150);
+    if (cache.lookup("k1")) return 2;
+    if (!cache.insert("k1", {"1_1_1", "result.txt", "aaaa", {}}) ||
+        !cache.insert("k2", {"2_1_1", "embedding.json", "", {0.5f}})) return 3;
+    auto hit = cache.lookup("k1");
+    if (!hit || hit->source != "1_1_1" || hit->artifact != "result.txt" || hit->text != "aaaa" ||
+        !hit->values.empty()) return 4;
+    hit = cache.lookup("k2");
+    if (!hit || hit->values != std::vector<float>{0.5f}) return 5;
+
+    // Past the budget the least recently used entry goes, file and all.
+    if (!cache.lookup("k1")) return 6;
+    if (!cache.insert("k3", {"3_1_1", "result.txt", "cccc", {}})) return 7;
+    if (cache.size() != 2 || cache.bytes() > 150 || cache.lookup("k2") || !cache.lookup("k1")) return 8;
+    if (cache.insert("k4", {"4_1_1", "result.txt", std::string(200, 'x'), {}})) return 9;
+    std::size_t files = 0;
+    for (const auto& entry : fs::directory_iterator(dir)) files += entry.path().extension() == ".res";
+    if (files != 2) return 10;
+
+    // A restart finds the entries, and a damaged one is a miss.
+    {
+        ResultCache restarted(dir, 150);
+        if (restarted.size() != 2 || !restarted.lookup("k3")) return 11;
+        for (const auto& entry : fs::directory_iterator(dir)) {
+            std::ofstream(entry.path(), std::ios::trunc) << "junk";
+        }
+        if (restarted.lookup("k1") || restarted.size() != 1) return 12;
+    }
+
+    fs::remove_all(dir);
+    std::puts("result_cache_test: all checks passed");
+    return 0;
+}
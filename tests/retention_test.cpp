@@ -0,0 +1,104 @@
+#include "nrvna/archive.hpp"
+#include "nrvna/contract.hpp"
+#include "nrvna/job_index.hpp"
+#include "nrvna/retention.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+using namespace nrvna;
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr int64_t kHour = 3600LL * 1'000'000;
+
+void writeJob(const fs::path& ws, Status state, const JobId& id) {
+    const auto dir = contract::jobDir(ws, state, id);
+    fs::create_directories(dir);
+    std::ofstream(dir / contract::kPromptFile) << "prompt " << id;
+    std::ofstream(dir / contract::kResultFile) << "result " << id;
+}
+
+}
+
+int main() {
+    auto ws = fs::temp_directory_path() / "nrvna_retention_test";
+    fs::remove_all(ws);
+    for (Status s : {Status::Queued, Status::Running, Status::Done, Status::Failed}) {
+        fs::create_directories(contract::stateDir(ws, s));
+    }
+
+    // No nrvna.json, or no section, keeps everything.
+    auto policy = loadRetentionPolicy(ws);
+    if (!policy || !policy->empty()) return 1;
+    std::ofstream(ws / contract::kConfigFile) << R"({"retention": {"max_age_hours": 24, "max_count": 3,
+        "keep_failed_hours": 1, "tag_ttl_hours": {"scratch": 0.5, "keep": 0}}})";
+    policy = loadRetentionPolicy(ws);
+    if (!policy || policy->maxAge != std::chrono::hours(24) || policy->maxCount != 3 ||
+        policy->keepFailed != std::chrono::hours(1) || policy->tagTtl.at("scratch") != std::chrono::minutes(30)) return 2;
+    std::ofstream(ws / contract::kConfigFile) << R"({"retention": {"max_age": 24}})";
+    if (loadRetentionPolicy(ws)) return 3;
+    std::ofstream(ws / contract::kConfigFile) << R"({"retention": {"max_count": -1}})";
+    if (loadRetentionPolicy(ws)) return 4;
+    fs::remove(ws / contract::kConfigFile);
+
+    // Age, failed age, tag TTLs, the count (tags do not escape it), and the
+    // parent of a running continuation.
+    const int64_t now = 100 * kHour;
+    JobIndex index(ws);
+    index.apply({"1_1_1", Status::Done, now - 30 * kHour, "", {}});
+    index.apply({"2_1_1", Status::Done, now - 30 * kHour, "", {"keep"}});
+    index.apply({"3_1_1", Status::Failed, now - 2 * kHour, "", {}});
+    index.apply({"4_1_1", Status::Done, now - 2 * kHour, "", {"scratch", "keep"}});
+    index.apply({"5_1_1", Status::Done, now - 40 * kHour, "", {}});
+    index.apply({"6_1_1", Status::Running, now, "5_1_1", {}});
+    index.apply({"7_1_1", Status::Done, now - kHour, "", {}});
+    if (expiredJobs(index, *policy, now) != std::vector<JobId>{"1_1_1", "2_1_1", "3_1_1", "4_1_1"}) return 5;
+    RetentionPolicy countOnly;
+    countOnly.maxCount = 2;
+    if (expiredJobs(index, countOnly, now) != std::vector<JobId>{"1_1_1", "2_1_1", "3_1_1"}) return 6;
+    if (!expiredJobs(index, RetentionPolicy{}, now).empty()) return 7;
+
+    // The collector waits for the index nrvnad writes.
+    writeJob(ws, Status::Failed, "13_1_1");
+    journal::append(ws, "13_1_1", Status::Failed);
+    for (const JobId id : {"10_1_1", "11_1_1", "12_1_1", "14_1_1"}) {
+        writeJob(ws, Status::Done, id);
+        journal::append(ws, id, Status::Done);
+    }
+    Archive archive(ws);
+    if (archive.pack({"10_1_1", "14_1_1"}, 1) != 2) return 8;
+
+    RetentionPolicy keepOne;
+    keepOne.maxCount = 1;
+    GarbageCollector collector(ws, keepOne, std::chrono::seconds(60), 1, std::chrono::milliseconds(0));
+    if (collector.collect().jobs != 0 || readReclaimStats(ws)) return 9;
+
+    JobIndex keeper(ws);
+    if (!keeper.refresh() || keeper.size() != 5 || !keeper.save(0)) return 10;
+    const auto pass = collector.collect();
+    if (pass.jobs != 4 || pass.inodes == 0 || pass.bytes == 0) return 11;
+    if (fs::exists(contract::jobDir(ws, Status::Done, "11_1_1")) ||
+        fs::exists(contract::jobDir(ws, Status::Done, "12_1_1")) ||
+        fs::exists(contract::jobDir(ws, Status::Failed, "13_1_1"))) return 12;
+
+    // Archived jobs leave the index; a segment goes once none of its jobs
+    // is kept, unless it is the one being appended to.
+    archive.refresh();
+    if (archive.contains("10_1_1") || !archive.contains("14_1_1") ||
+        fs::exists(ws / contract::kArchiveDir / "000001.seg") ||
+        !fs::exists(ws / contract::kArchiveDir / "000002.seg")) return 13;
+    if (!keeper.refresh() || keeper.size() != 1 || !keeper.find("14_1_1")) return 14;
+
+    auto stats = readReclaimStats(ws);
+    if (!stats || stats->jobs != 4 || stats->inodes != pass.inodes || stats->last_run.empty()) return 15;
+    if (collector.collect().jobs != 0 || readReclaimStats(ws)->jobs != 4) return 16;
+
+    std::ofstream(ws / contract::kConfigFile) << R"({"retention": {"tag_ttl_hours": {"x": 1e300}}})";
+    if (loadRetentionPolicy(ws)) return 17;
+
+    fs::remove_all(ws);
+    std::puts("retention_test: all checks passed");
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include "nrvna/cost_model.hpp"
+#include "nrvna/scheduler.hpp"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <vector>
+
+using namespace nrvna;
+using namespace std::chrono_literals;
+namespace fs = std::filesystem;
+
+namespace {
+JobId next(Scheduler& scheduler, Scheduler::Clock::time_point now, bool allowMedia = true) {
+    auto job = scheduler.pop(now, allowMedia);
+    return job ? job->id : JobId();
+}
+}
+
+int main() {
+    const auto t0 = Scheduler::Clock::time_point{} + 1h;
+    SchedulerConfig aging;
+    aging.aging = 60s;
+    Scheduler scheduler(aging);
+
+    if (scheduler.pop(t0)) return 1;
+    if (!scheduler.push("1_batch", {Priority::Low, ""}, t0)) return 2;
+    if (!scheduler.push("2_batch", {Priority::Low, ""}, t0)) return 3;
+    if (!scheduler.push("3_normal", {Priority::Normal, ""}, t0 + 1s)) return 4;
+    if (!scheduler.push("4_chat", {Priority::High, ""}, t0 + 2s)) return 5;
+    if (scheduler.push("4_chat", {Priority::High, ""}, t0 + 3s)) return 6;
+    if (scheduler.size() != 4 || !scheduler.contains("2_batch")) return 7;
+
+    // Strict lanes: a later interactive job overtakes the backlog.
+    if (next(scheduler, t0 + 3s) != "4_chat") return 8;
+    if (next(scheduler, t0 + 3s) != "3_normal") return 9;
+    if (next(scheduler, t0 + 3s) != "1_batch") return 10;
+
+    // After two aging intervals the low job ranks with high ones; the older wins.
+    if (!scheduler.push("5_chat", {Priority::High, ""}, t0 + 100s)) return 11;
+    if (next(scheduler, t0 + 119s) != "5_chat") return 12;
+    if (!scheduler.push("6_chat", {Priority::High, ""}, t0 + 110s)) return 13;
+    if (next(scheduler, t0 + 120s) != "2_batch") return 14;
+    if (next(scheduler, t0 + 120s) != "6_chat") return 15;
+    if (!scheduler.empty() || scheduler.pop(t0 + 120s)) return 16;
+
+    // Without aging, lanes are strict forever.
+    SchedulerConfig strictConfig;
+    strictConfig.aging = Scheduler::Clock::duration::zero();
+    Scheduler strict(strictConfig);
+    strict.push("7_batch", {Priority::Low, ""}, t0);
+    strict.push("8_normal", {Priority::Normal, ""}, t0 + 24h);
+    if (next(strict, t0 + 48h) != "8_normal") return 17;
+    strict.clear();
+    if (!strict.empty() || strict.contains("7_batch")) return 18;
+
+    // Within a lane, groups share by weight: a 1000-job backlog from one
+    // tenant does not hold back a tenant that submitted later.
+    strictConfig.weights = {{"heavy", 2.0}};
+    Scheduler fair(strictConfig);
+    for (int i = 0; i < 1000; ++i) fair.push("1_" + std::to_string(i), {Priority::Normal, "bulk"}, t0);
+    for (int i = 0; i < 10; ++i) fair.push("2_" + std::to_string(i), {Priority::Normal, "heavy"}, t0 + 1s);
+    for (int i = 0; i < 10; ++i) fair.push("3_" + std::to_string(i), {Priority::Normal, ""}, t0 + 2s);
+    std::map<char, int> served;
+    for (int i = 0; i < 20; ++i) served[next(fair, t0 + 3s).front()]++;
+    if (served['1'] != 5 || served['2'] != 10 || served['3'] != 5) return 19;
+    if (next(fair, t0 + 3s) != "1_5") return 20;
+
+    // Cheapest first, until the oldest job has waited shortestFirstWait.
+    SchedulerConfig sjfConfig;
+    sjfConfig.shortestFirstWait = 300s;
+    Scheduler sjf(sjfConfig);
+    JobTraits big, small;
+    big.cost = 600.0;
+    small.cost = 2.0;
+    sjf.push("1_big", big, t0);
+    sjf.push("2_small", small, t0 + 1s);
+    sjf.push("3_small", small, t0 + 2s);
+    if (next(sjf, t0 + 10s) != "2_small") return 26;
+    sjf.push("4_small", small, t0 + 20s);
+    if (next(sjf, t0 + 299s) != "3_small") return 27;
+    if (next(sjf, t0 + 300s) != "1_big") return 28;
+    if (next(sjf, t0 + 300s) != "4_small") return 29;
+
+    // A caller at its media-encoder cap skips media jobs but still finds others.
+    Scheduler media(strictConfig);
+    JobTraits image;
+    image.priority = Priority::High;
+    image.media = true;
+    media.push("1_image", image, t0);
+    media.push("2_text", {Priority::Low, ""}, t0 + 1s);
+    if (!media.runnable(false) || next(media, t0 + 2s, false) != "2_text") return 33;
+    if (media.runnable(false) || !media.runnable(true) || !next(media, t0 + 2s, false).empty()) return 34;
+    auto job = media.pop(t0 + 2s, true);
+    if (!job || job->id != "1_image" || !job->media || media.runnable(true)) return 35;
+
+    // upcoming() previews the next pops without taking them.
+    Scheduler preview(strictConfig);
+    preview.push("1_low", {Priority::Low, ""}, t0);
+    preview.push("2_high", {Priority::High, ""}, t0 + 1s);
+    preview.push("3_normal", {Priority::Normal, ""}, t0 + 2s);
+    if (preview.upcoming(2, t0 + 3s) != std::vector<JobId>{"2_high", "3_normal"} || preview.size() != 3) return 36;
+    if (next(preview, t0 + 3s) != "2_high" || preview.upcoming(5, t0 + 3s).size() != 2) return 37;
+    Scheduler turns(strictConfig);
+    turns.push("1_a", {Priority::Normal, "a"}, t0);
+    turns.push("2_a", {Priority::Normal, "a"}, t0 + 1s);
+    turns.push("3_b", {Priority::Normal, "b"}, t0 + 2s);
+    if (turns.upcoming(3, t0 + 3s) != std::vector<JobId>{"1_a", "3_b", "2_a"}) return 38;
+    if (next(turns, t0 + 3s) != "1_a" || next(turns, t0 + 3s) != "3_b" || next(turns, t0 + 3s) != "2_a") return 39;
+
+    // Weights come from the workspace's nrvna.json; a missing file is the default.
+    auto ws = fs::temp_directory_path() / "nrvna_scheduler_test";
+    fs::remove_all(ws);
+    fs::create_directories(ws);
+    auto config = loadSchedulerConfig(ws);
+    if (!config || !config->weights.empty()) return 21;
+    std::ofstream(ws / "nrvna.json") << R"({"scheduler":{"weights":{"tenant-a":3,"tenant-b":0.5}}})";
+    config = loadSchedulerConfig(ws);
+    if (!config || config->weights.size() != 2 || config->weights.at("tenant-b") != 0.5) return 22;
+    std::ofstream(ws / "nrvna.json") << R"({"scheduler":{"weights":{"tenant-a":0}}})";
+    if (loadSchedulerConfig(ws)) return 23;
+
+    JobMeta meta;
+    meta.parent = "123_456";
+    if (fairShareGroup(meta) != "parent:123_456") return 24;
+    meta.tags = {"tenant-a", "nightly"};
+    meta.priority = "low";
+    auto traits = jobTraits(meta);
+    if (traits.group != "tenant-a" || traits.priority != Priority::Low) return 25;
+
+    // Costs grow with the prompt and attachments, and follow observed times.
+    fs::create_directories(ws / "job" / "images");
+    std::ofstream(ws / "job" / "prompt.txt") << std::string(4096, 'x');
+    std::ofstream(ws / "job" / "type.txt") << "vision\n";
+    std::ofstream(ws / "job" / "images" / "a.png") << "png";
+    auto shape = CostModel::inspect(ws / "job");
+    if (shape.type != JobType::Vision || shape.promptBytes != 4096 || shape.images != 1 || shape.audio != 0) return 30;
+    CostModel costs;
+    JobShape shortText{JobType::Text, 100, 0, 0};
+    JobShape longText{JobType::Text, 1'000'000, 0, 0};
+    if (!(costs.estimate(shortText) < costs.estimate(longText))) return 31;
+    const double before = costs.estimate(shape);
+    for (int i = 0; i < 50; ++i) costs.observe(shape, 1.0);
+    if (!(costs.estimate(shape) < before) || costs.estimate(shape) < 0.9) return 32;
+
+    fs::remove_all(ws);
+    std::puts("scheduler_test: all checks passed");
+    return 0;
+}